@@ -0,0 +1,523 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Microbenchmarks for the per-turn kernels, built and run with: make bench
+// Each case is timed over several repetitions after a warmup, and reported as ns/op with its spread across repetitions.
+// Console output of the log functions is sent to /dev/null while a case runs, file logging is stubbed or real per case.
+
+#define BENCH_REPS 10
+#define BENCH_WARMUP_OPS 2000
+#define BENCH_FIRST_ID 9001
+#define BENCH_MAX_THREADS 8
+#define BENCH_MAX_CASES 32
+
+typedef void (*BenchOp)(void *context);
+
+// Results of one benchmark case
+typedef struct BenchResult {
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+} BenchResult;
+
+// State shared by every case, rebuilt for each one
+typedef struct BenchHouse {
+    House house;
+    Hunter *hunters[BENCH_MAX_THREADS];
+    int hunter_count;
+} BenchHouse;
+
+// Arguments for one thread of the hunter_move contention case
+typedef struct MoveThreadArgs {
+    Hunter *hunter;
+    long ops;
+    pthread_barrier_t *barrier;
+    double elapsed_ns;
+} MoveThreadArgs;
+
+// Samples of one finished case, kept for the JSON report
+typedef struct BenchRecord {
+    char name[64];
+    long ops;
+    double samples[BENCH_REPS];
+} BenchRecord;
+
+static int saved_stdout = -1;
+static long bench_ops = 20000;
+static const char *bench_filter = NULL;
+static BenchRecord bench_records[BENCH_MAX_CASES];
+static int bench_record_count = 0;
+
+// CONSOLE REDIRECTION
+
+static void bench_silence_stdout(void) {
+
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void bench_restore_stdout(void) {
+
+    log_flush();            // console lines are batched per thread, writes them out while stdout is still silenced
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+// TIMING
+
+static double bench_now_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static BenchResult bench_summarize(const double samples[], int count) {
+
+    BenchResult result = {0.0, 0.0, samples[0]};
+
+    for (int i = 0; i < count; i++) {
+        result.mean_ns += samples[i];
+        if (samples[i] < result.min_ns) {
+            result.min_ns = samples[i];
+        }
+    }
+    result.mean_ns /= count;
+
+    for (int i = 0; i < count; i++) {
+        result.stddev_ns += (samples[i] - result.mean_ns) * (samples[i] - result.mean_ns);
+    }
+    result.stddev_ns = sqrt(result.stddev_ns / count);
+
+    return result;
+}
+
+static void bench_print(const char *name, BenchResult result) {
+
+    printf("%-44s %12.1f ns/op   +/- %8.1f   min %10.1f\n", name, result.mean_ns, result.stddev_ns, result.min_ns);
+}
+
+// Prints the case and keeps its samples for the JSON report
+static void bench_report(const char *name, const double samples[]) {
+
+    bench_print(name, bench_summarize(samples, BENCH_REPS));
+
+    if (bench_record_count < BENCH_MAX_CASES) {
+
+        BenchRecord *record = bench_records + bench_record_count;
+
+        snprintf(record->name, sizeof(record->name), "%s", name);
+        record->ops = bench_ops;
+        memcpy(record->samples, samples, sizeof(record->samples));
+
+        bench_record_count++;
+    }
+}
+
+/*
+    Purpose:
+        Writes every finished case to a JSON report in the same format as bench_scenarios.py, one run per repetition.
+        bench_compare.py compares two such reports.
+    Parameters:
+        - path (in): report file path
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+static int bench_write_json(const char *path) {
+
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        printf("\nERROR: Benchmark report %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    fprintf(file, "{\n  \"format\": \"ghost-hunt-scenario-report\",\n  \"version\": 1,\n");
+    fprintf(file, "  \"kind\": \"microbench\",\n  \"reps\": %d,\n  \"scenarios\": [", BENCH_REPS);
+
+    for (int i = 0; i < bench_record_count; i++) {
+
+        const BenchRecord *record = bench_records + i;
+
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"ops\": %ld, \"runs\": [", (i > 0) ? "," : "", record->name, record->ops);
+
+        for (int rep = 0; rep < BENCH_REPS; rep++) {
+            fprintf(file, "%s{\"ok\": true, \"ns_per_op\": %.3f}", (rep > 0) ? ", " : "", record->samples[rep]);
+        }
+
+        fprintf(file, "]}");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+
+    return C_OK;
+}
+
+// Checks if case should run based on --filter
+static bool bench_selected(const char *name) {
+
+    return (bench_filter == NULL) || (strstr(name, bench_filter) != NULL);
+}
+
+/*
+    Purpose:
+        Times op over BENCH_REPS repetitions of bench_ops calls each, after a warmup.
+    Parameters:
+        - name (in): case name printed in the report
+        - op (in): operation to time
+        - context (in/out): state passed to op
+*/
+static void bench_run(const char *name, BenchOp op, void *context) {
+
+    if (!bench_selected(name)) {
+        return;
+    }
+
+    double samples[BENCH_REPS];
+
+    bench_silence_stdout();
+
+    for (long i = 0; i < BENCH_WARMUP_OPS; i++) {
+        op(context);
+    }
+
+    for (int rep = 0; rep < BENCH_REPS; rep++) {
+
+        double start = bench_now_ns();
+
+        for (long i = 0; i < bench_ops; i++) {
+            op(context);
+        }
+
+        samples[rep] = (bench_now_ns() - start) / (double)bench_ops;
+    }
+
+    bench_restore_stdout();
+
+    bench_report(name, samples);
+}
+
+// HOUSE SETUP
+
+static void bench_house_create(BenchHouse *bench, int hunter_count) {
+
+    house_create_stack(&(bench->house));
+    house_populate_rooms(&(bench->house));
+    house_load_data(&(bench->house));
+
+    bench->hunter_count = hunter_count;
+
+    for (int i = 0; i < hunter_count; i++) {
+
+        char name[MAX_HUNTER_NAME];
+        snprintf(name, sizeof(name), "bench%d", i);
+
+        hunter_init(bench->hunters + i, name, BENCH_FIRST_ID + i, true, i % 7);
+        house_add_hunter(&(bench->house), bench->hunters[i]);
+    }
+}
+
+static void bench_house_destroy(BenchHouse *bench) {
+
+    for (int i = 0; i < bench->hunter_count; i++) {
+        if (bench->hunters[i]->rooms_path.head != NULL) {
+            roomstack_cleanup(&(bench->hunters[i]->rooms_path), true);
+        }
+    }
+
+    house_cleanup_stack(&(bench->house));
+}
+
+// Keeps a hunter in the simulation and exploring so that its turns can be repeated
+static void bench_hunter_refresh(Hunter *hunter) {
+
+    hunter->boredom = 0;
+    hunter->fear = 0;
+    hunter->return_to_van = false;
+    hunter->case_file->collected = 0;
+    hunter->case_file->solved = false;
+
+    // Trims path back to the van once it gets long, a real hunter would have returned by now
+    if ((hunter->room->is_exit) && (hunter->rooms_path.head->next != NULL)) {
+        roomstack_cleanup(&(hunter->rooms_path), false);
+    }
+}
+
+// KERNEL OPERATIONS
+
+static void op_ghost_take_turn(void *context) {
+
+    Ghost *ghost = &(((BenchHouse*)context)->house.ghost);
+
+    ghost->boredom = 0;             // ghost would exit after ENTITY_BOREDOM_MAX turns alone
+    ghost_take_turn(ghost);
+}
+
+static void op_hunter_take_turn(void *context) {
+
+    Hunter *hunter = ((BenchHouse*)context)->hunters[0];
+
+    bench_hunter_refresh(hunter);
+    hunter_take_turn(hunter);
+}
+
+static void op_hunter_gather_evidence_hit(void *context) {
+
+    Hunter *hunter = ((BenchHouse*)context)->hunters[0];
+
+    hunter->room->evidence = evidence_byte_set_type(hunter->room->evidence, hunter->device_type);
+    hunter_gather_evidence(hunter);
+    bench_hunter_refresh(hunter);
+}
+
+static void op_hunter_gather_evidence_miss(void *context) {
+
+    Hunter *hunter = ((BenchHouse*)context)->hunters[0];
+
+    hunter->room->evidence = 0;
+    hunter_gather_evidence(hunter);
+    bench_hunter_refresh(hunter);
+}
+
+static void op_roomstack_push_pop(void *context) {
+
+    RoomStack *stack = (RoomStack*)context;
+    static Room room;
+
+    roomstack_push(stack, &room);
+    roomstack_pop(stack);
+}
+
+static void op_casefile_check_victory_solvable(void *context) {
+
+    CaseFile *case_file = (CaseFile*)context;
+
+    case_file->solved = false;
+    case_file->collected = (EvidenceByte)GH_BANSHEE;
+    casefile_check_victory(case_file);
+}
+
+static void op_casefile_check_victory_partial(void *context) {
+
+    CaseFile *case_file = (CaseFile*)context;
+
+    case_file->solved = false;
+    case_file->collected = EV_EMF | EV_ORBS;
+    casefile_check_victory(case_file);
+}
+
+static void op_log_move(void *context) {
+
+    (void)context;
+    log_move(BENCH_FIRST_ID, 1, 2, "Hallway", "Kitchen", EV_EMF);
+}
+
+// HUNTER MOVE CONTENTION
+
+static void *move_thread(void *arg) {
+
+    MoveThreadArgs *args = (MoveThreadArgs*)arg;
+    Hunter *hunter = args->hunter;
+
+    rand_bind_seed(&(hunter->rand_seed));
+
+    for (long i = 0; i < BENCH_WARMUP_OPS; i++) {
+        hunter_move(hunter);
+        bench_hunter_refresh(hunter);
+    }
+
+    pthread_barrier_wait(args->barrier);
+
+    double start = bench_now_ns();
+
+    for (long i = 0; i < args->ops; i++) {
+        hunter_move(hunter);
+        bench_hunter_refresh(hunter);
+    }
+
+    args->elapsed_ns = bench_now_ns() - start;
+
+    log_flush();            // writes out console lines still batched by this thread
+
+    return NULL;
+}
+
+/*
+    Purpose:
+        Times hunter_move with several hunter threads moving around the same house at once.
+    Parameters:
+        - thread_count (in): number of hunters moving concurrently
+*/
+static void bench_hunter_move_contention(int thread_count) {
+
+    char name[64];
+    snprintf(name, sizeof(name), "hunter_move (%d thread%s)", thread_count, thread_count == 1 ? "" : "s");
+
+    if (!bench_selected(name)) {
+        return;
+    }
+
+    double samples[BENCH_REPS];
+
+    bench_silence_stdout();
+
+    for (int rep = 0; rep < BENCH_REPS; rep++) {
+
+        BenchHouse bench;
+        bench_house_create(&bench, thread_count);
+
+        pthread_t threads[BENCH_MAX_THREADS];
+        MoveThreadArgs args[BENCH_MAX_THREADS];
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, (unsigned)thread_count);
+
+        for (int i = 0; i < thread_count; i++) {
+            args[i] = (MoveThreadArgs){bench.hunters[i], bench_ops, &barrier, 0.0};
+            pthread_create(threads + i, NULL, move_thread, args + i);
+        }
+
+        double total_ns = 0.0;
+
+        for (int i = 0; i < thread_count; i++) {
+            pthread_join(threads[i], NULL);
+            total_ns += args[i].elapsed_ns;
+        }
+
+        samples[rep] = total_ns / ((double)bench_ops * thread_count);
+
+        pthread_barrier_destroy(&barrier);
+        bench_house_destroy(&bench);
+    }
+
+    bench_restore_stdout();
+
+    bench_report(name, samples);
+}
+
+// Runs case on a freshly built house with one hunter
+static void bench_run_house_case(const char *name, BenchOp op) {
+
+    if (!bench_selected(name)) {
+        return;
+    }
+
+    BenchHouse bench;
+
+    bench_silence_stdout();
+    bench_house_create(&bench, 1);
+    bench_restore_stdout();
+
+    rand_bind_seed(&(bench.hunters[0]->rand_seed));
+    bench_run(name, op, &bench);
+    rand_bind_seed(NULL);
+
+    bench_house_destroy(&bench);
+}
+
+int main(int argc, char *argv[]) {
+
+    const char *json_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+
+        if ((strcmp(argv[i], "--ops") == 0) && (i + 1 < argc)) {
+            bench_ops = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--filter") == 0) && (i + 1 < argc)) {
+            bench_filter = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--json") == 0) && (i + 1 < argc)) {
+            json_path = argv[++i];
+        }
+        else {
+            printf("Usage: %s [--ops N] [--filter SUBSTRING] [--json FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (bench_ops <= 0) {
+        bench_ops = 1;
+    }
+
+    rand_set_base_seed(12345);
+    log_set_record_pause(false);        // the 2 ms pause would swamp every logging case
+
+    printf("Per-turn kernel microbenchmarks: %d reps x %ld ops, %d warmup ops\n\n", BENCH_REPS, bench_ops, BENCH_WARMUP_OPS);
+
+    // Kernels with file logging stubbed out
+    log_set_file_output(false);
+
+    bench_run_house_case("ghost_take_turn (no file log)", op_ghost_take_turn);
+    bench_run_house_case("hunter_take_turn (no file log)", op_hunter_take_turn);
+    bench_run_house_case("hunter_gather_evidence hit (no file log)", op_hunter_gather_evidence_hit);
+    bench_run_house_case("hunter_gather_evidence miss (no file log)", op_hunter_gather_evidence_miss);
+
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        bench_hunter_move_contention(threads);
+    }
+
+    RoomStack stack;
+    roomstack_init(&stack);
+    bench_run("roomstack_push + roomstack_pop", op_roomstack_push_pop, &stack);
+
+    CaseFile case_file;
+    casefile_init(&case_file);
+    bench_run("casefile_check_victory (solvable)", op_casefile_check_victory_solvable, &case_file);
+    bench_run("casefile_check_victory (2 bits)", op_casefile_check_victory_partial, &case_file);
+    sem_destroy(&(case_file.mutex));
+
+    bench_run("log_move (no file log)", op_log_move, NULL);
+
+    // Same kernels with real file logging, written to a scratch directory so real run logs are never touched
+    char scratch_dir[] = "/tmp/ghost_bench_XXXXXX";
+    char original_dir[512];
+
+    if ((mkdtemp(scratch_dir) == NULL) || (getcwd(original_dir, sizeof(original_dir)) == NULL) || (chdir(scratch_dir) != 0)) {
+        printf("\nERROR: Scratch directory for file logging cases could not be created...\n");
+        return 1;
+    }
+
+    log_set_file_output(true);
+
+    // Fewer ops per case so each entity stays well under the default per-entity line cap: past it (or past a total cap)
+    // records are dropped and the run carries on, so the cases would time the cap check instead of the file writes
+    bench_ops = (bench_ops / 20 > 0) ? bench_ops / 20 : 1;
+
+    bench_run_house_case("ghost_take_turn (file log)", op_ghost_take_turn);
+    bench_run_house_case("hunter_take_turn (file log)", op_hunter_take_turn);
+    bench_run("log_move / write_log_record (file log)", op_log_move, NULL);
+
+    // Removes log files written by the file logging cases
+    char filename[64];
+    snprintf(filename, sizeof(filename), "log_%d.csv", DEFAULT_GHOST_ID);
+    remove(filename);
+    for (int i = 0; i < BENCH_MAX_THREADS; i++) {
+        snprintf(filename, sizeof(filename), "log_%d.csv", BENCH_FIRST_ID + i);
+        remove(filename);
+    }
+
+    if ((chdir(original_dir) != 0) || (rmdir(scratch_dir) != 0)) {
+        printf("\nERROR: Scratch directory %s could not be removed...\n", scratch_dir);
+    }
+
+    if ((json_path != NULL) && !bench_write_json(json_path)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+"""
+Benchmark regression comparator for ghost hunt benchmark reports.
+
+Usage:
+- python3 bench_compare.py <baseline report> <current report>
+- Exits with status 1 when any metric regressed, any current run failed (crash or timeout) or a baseline scenario is
+  missing from the current report, 0 otherwise, so it can gate a deploy or CI step
+
+Report format (written by bench_scenarios.py, and by ./microbench --json):
+- a JSON object with "format": "ghost-hunt-scenario-report" and "version": 1
+- "scenarios": a list of objects with a unique "name" and a "runs" list
+- each run is an object with "ok" and any numeric metrics, one run per repetition
+Scenarios are matched by name. Only runs with ok set are compared; failed runs count as regressions.
+
+Metrics compared when both reports have them:
+- turns_per_s (higher is better)
+- wall_s, ns_per_op, allocations, lock_wait_ns (lower is better)
+
+A metric regresses when its median moved the wrong way by more than the threshold and the move is
+statistically significant across the repeated runs:
+- mannwhitney (default): one-sided Mann-Whitney U test, exact for small samples without ties
+- bootstrap: the one-sided bootstrap confidence interval of the relative median change excludes zero
+With a single run on either side no test is possible and the threshold alone decides.
+
+Command Line Arguments:
+- --threshold <percent> smallest relative change flagged (default 5)
+- --metric-threshold <metric>=<percent> overrides the threshold for one metric, may be repeated
+- --alpha <number> significance level (default 0.05)
+- --method mannwhitney|bootstrap statistical test to use
+- --metrics <list> comma separated metrics to compare (default all of the above)
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import math
+import random
+import statistics
+import sys
+from typing import Dict, List, Optional, Tuple
+
+
+REPORT_FORMAT = "ghost-hunt-scenario-report"
+REPORT_VERSION = 1
+
+# True when a higher value is better
+METRICS: Dict[str, bool] = {
+    "turns_per_s": True,
+    "wall_s": False,
+    "ns_per_op": False,
+    "allocations": False,
+    "lock_wait_ns": False,
+}
+
+BOOTSTRAP_RESAMPLES = 2000
+EXACT_LIMIT = 400           # largest n1 * n2 for the exact Mann-Whitney distribution
+
+
+def load_report(path: str) -> Tuple[Dict[str, List[Dict[str, object]]], Dict[str, int]]:
+    """Loads a report and returns the ok runs and the number of failed runs of each scenario, keyed by scenario name."""
+    try:
+        with open(path) as handle:
+            report = json.load(handle)
+    except (OSError, ValueError) as error:
+        sys.exit(f"{path}: {error}")
+
+    if report.get("format") != REPORT_FORMAT or report.get("version") != REPORT_VERSION:
+        sys.exit(f"{path}: not a {REPORT_FORMAT} v{REPORT_VERSION} file")
+
+    scenarios = report.get("scenarios", [])
+    runs = {scenario["name"]: [run for run in scenario.get("runs", []) if run.get("ok")] for scenario in scenarios}
+    failed = {scenario["name"]: sum(1 for run in scenario.get("runs", []) if not run.get("ok")) for scenario in scenarios}
+    return runs, failed
+
+
+def samples_of(runs: List[Dict[str, object]], metric: str) -> List[float]:
+    return [float(run[metric]) for run in runs if isinstance(run.get(metric), (int, float))]
+
+
+def relative_change(baseline: float, current: float, higher_is_better: bool) -> float:
+    """Relative change of current against baseline, positive when current is worse."""
+    if baseline == 0:
+        return 0.0 if current == 0 else math.inf
+    change = (current - baseline) / abs(baseline)
+    return -change if higher_is_better else change
+
+
+def mann_whitney_worse(baseline: List[float], current: List[float], higher_is_better: bool) -> float:
+    """One-sided Mann-Whitney U test, returns the p-value of current being worse than baseline."""
+    # Orients the samples so that a larger value is always worse
+    sign = -1.0 if higher_is_better else 1.0
+    base = [sign * value for value in baseline]
+    cur = [sign * value for value in current]
+    n1, n2 = len(cur), len(base)
+
+    u = sum(1.0 if c > b else 0.5 if c == b else 0.0 for c in cur for b in base)
+
+    ranked = sorted(base + cur)
+    has_ties = len(set(ranked)) != len(ranked)
+
+    if not has_ties and n1 * n2 <= EXACT_LIMIT:
+        # counts[k] is the number of orderings with U = k, built one sample at a time
+        counts = exact_u_counts(n1, n2)
+        total = sum(counts)
+        return sum(counts[math.ceil(u):]) / total
+
+    # Normal approximation with tie and continuity corrections
+    n = n1 + n2
+    tie_term = 0.0
+    for value in set(ranked):
+        t = ranked.count(value)
+        tie_term += t ** 3 - t
+    variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - n1 * n2 / 2.0 - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def exact_u_counts(n1: int, n2: int) -> List[int]:
+    """Number of arrangements of n1 + n2 distinct samples giving each value of U."""
+    # table[i][j] holds the counts for i current and j baseline samples
+    table: List[List[List[int]]] = [[[1] if i == 0 or j == 0 else [] for j in range(n2 + 1)] for i in range(n1 + 1)]
+
+    for i in range(1, n1 + 1):
+        for j in range(1, n2 + 1):
+            # Largest sample is a current one (beats all j baseline samples) or a baseline one
+            with_current = [0] * j + table[i - 1][j]
+            with_baseline = table[i][j - 1]
+            size = max(len(with_current), len(with_baseline))
+            table[i][j] = [
+                (with_current[k] if k < len(with_current) else 0) + (with_baseline[k] if k < len(with_baseline) else 0)
+                for k in range(size)
+            ]
+
+    return table[n1][n2]
+
+
+def bootstrap_worse(baseline: List[float], current: List[float], higher_is_better: bool,
+                    alpha: float) -> Tuple[float, float]:
+    """One-sided bootstrap interval of the relative median change, returns (lower bound, upper bound)."""
+    rng = random.Random(1)
+    changes = []
+
+    for _ in range(BOOTSTRAP_RESAMPLES):
+        base = statistics.median(rng.choices(baseline, k=len(baseline)))
+        cur = statistics.median(rng.choices(current, k=len(current)))
+        changes.append(relative_change(base, cur, higher_is_better))
+
+    changes.sort()
+    lower = changes[int(alpha * (len(changes) - 1))]
+    upper = changes[int((1.0 - alpha) * (len(changes) - 1))]
+    return lower, upper
+
+
+def compare_metric(baseline: List[float], current: List[float], higher_is_better: bool,
+                   threshold: float, alpha: float, method: str) -> Tuple[str, float, str]:
+    """Returns (verdict, relative change, test detail) for one metric of one scenario."""
+    change = relative_change(statistics.median(baseline), statistics.median(current), higher_is_better)
+
+    if len(baseline) < 2 or len(current) < 2:
+        return ("REGRESSION" if change > threshold else "ok"), change, "no test (single run)"
+
+    if method == "bootstrap":
+        lower, upper = bootstrap_worse(baseline, current, higher_is_better, alpha)
+        detail = f"CI [{lower * 100:+.1f}%, {upper * 100:+.1f}%]"
+        significant = lower > 0
+    else:
+        p_value = mann_whitney_worse(baseline, current, higher_is_better)
+        detail = f"p={p_value:.3f}"
+        significant = p_value <= alpha
+
+    if change > threshold:
+        return ("REGRESSION" if significant else "not significant"), change, detail
+    if change < -threshold:
+        return "improved", change, detail
+    return "ok", change, detail
+
+
+def parse_metric_thresholds(values: List[str]) -> Dict[str, float]:
+    thresholds = {}
+    for value in values:
+        metric, _, percent = value.partition("=")
+        try:
+            thresholds[metric] = float(percent) / 100.0
+        except ValueError:
+            sys.exit(f"Bad --metric-threshold {value}, expected metric=percent")
+    return thresholds
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compare a benchmark report against a baseline report.")
+    parser.add_argument("baseline", type=str, help="Baseline report.")
+    parser.add_argument("current", type=str, help="Current report.")
+    parser.add_argument("--threshold", type=float, default=5.0, help="Smallest relative change flagged, in percent.")
+    parser.add_argument("--metric-threshold", action="append", default=[],
+                        help="Per-metric threshold override, metric=percent.")
+    parser.add_argument("--alpha", type=float, default=0.05, help="Significance level.")
+    parser.add_argument("--method", choices=("mannwhitney", "bootstrap"), default="mannwhitney",
+                        help="Statistical test across repeated runs.")
+    parser.add_argument("--metrics", type=str, default=",".join(METRICS), help="Metrics to compare.")
+    args = parser.parse_args()
+
+    metrics = [metric.strip() for metric in args.metrics.split(",") if metric.strip()]
+    for metric in metrics:
+        if metric not in METRICS:
+            sys.exit(f"Unknown metric {metric}, known metrics: {', '.join(METRICS)}")
+
+    metric_thresholds = parse_metric_thresholds(args.metric_threshold)
+    baseline, _ = load_report(args.baseline)
+    current, current_failed = load_report(args.current)
+
+    regressions = 0
+    compared = 0
+
+    print(f"{'scenario':<44} {'metric':<14} {'baseline':>14} {'current':>14} {'change':>9}  {'test':<24} verdict")
+    print("-" * 134)
+
+    for name, current_runs in current.items():
+        # A run that crashed or timed out has no metrics to compare, so the failure itself is the regression
+        if current_failed[name]:
+            regressions += 1
+            failures = f"{current_failed[name]} of {current_failed[name] + len(current_runs)} runs failed"
+            print(f"{name:<44} {failures:<80} REGRESSION")
+
+        baseline_runs: Optional[List[Dict[str, object]]] = baseline.get(name)
+        if baseline_runs is None:
+            print(f"{name:<44} not in baseline, skipped")
+            continue
+
+        for metric in metrics:
+            base_samples = samples_of(baseline_runs, metric)
+            cur_samples = samples_of(current_runs, metric)
+            if not base_samples or not cur_samples:
+                continue
+
+            threshold = metric_thresholds.get(metric, args.threshold / 100.0)
+            verdict, change, detail = compare_metric(base_samples, cur_samples, METRICS[metric],
+                                                     threshold, args.alpha, args.method)
+            compared += 1
+            if verdict == "REGRESSION":
+                regressions += 1
+
+            # Change is printed as the raw direction of the median, verdict already accounts for which way is better
+            shown = -change if METRICS[metric] else change
+            print(f"{name:<44} {metric:<14} {statistics.median(base_samples):14.4g} {statistics.median(cur_samples):14.4g} "
+                  f"{shown * 100:+8.1f}%  {detail:<24} {verdict}")
+
+    for name in baseline:
+        if name not in current:
+            regressions += 1
+            print(f"{name:<44} {'missing from current report':<80} REGRESSION")
+
+    print(f"\n{compared} comparisons, {regressions} regression{'s' if regressions != 1 else ''}")
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,255 @@
+"""
+End-to-end scenario benchmark driver for the ghost hunt simulation.
+
+Usage:
+- Build the project first (make), then run from the code directory: python3 bench_scenarios.py
+- Every run is a separate ./project process in its own scratch directory, so log files never mix
+  and the process resource usage (peak RSS, context switches) belongs to that run alone
+
+Scenarios are the cartesian product of:
+- hunters: 1, 4, 8, 64, 1024 and 10000 hunters, created with --hunters instead of interactive input
+- layout: Willow House, or a generated layout with --rooms (256 rooms by default)
+- logging: on (log file opened per record), buffered (--log-buffered) or off (--no-log)
+- threads: one thread per entity, or a worker pool of each --threads count in the sweep
+
+Command Line Arguments:
+- --project <path> simulation executable (default ./project)
+- --reps <number> repeated runs per scenario (default 3)
+- --seed <number> base seed every run uses, so repeated runs simulate the same workload
+- --hunters, --layouts, --logging, --threads comma separated lists narrowing the matrix
+- --rooms <number> room count of the generated layout
+- --keep-pause runs with legacy millisecond log timestamps and their 2 ms pause after each log record
+  (nanosecond timestamps need no pause, and the pause would dominate every logged run)
+- --timeout <seconds> kills runs that take longer, they are reported as failed
+- --output <filename> JSON report (default scenario_report.json)
+
+Runs that fail (for example when killed at the timeout) are kept in the report with ok set to false.
+"""
+
+from __future__ import annotations
+
+import argparse
+import itertools
+import json
+import os
+import platform
+import re
+import shutil
+import signal
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from typing import Dict, List
+
+
+REPORT_FORMAT = "ghost-hunt-scenario-report"
+REPORT_VERSION = 1
+
+DEFAULT_HUNTERS = "1,4,8,64,1024,10000"
+DEFAULT_LAYOUTS = "willow,generated"
+DEFAULT_LOGGING = "on,buffered,off"
+DEFAULT_THREADS = "entity,1,2,4,8"
+
+# --stats line, key=value pairs (turns, rounds, hunters, rooms, run_ns, allocs, ...)
+STATS_PATTERN = re.compile(r"^SIM_STATS (.*)$", re.MULTILINE)
+
+# SIM_STATS keys stored in each run under a different name, all other keys are stored as given
+STATS_RENAMES = {"allocs": "allocations"}
+
+
+def parse_list(text: str) -> List[str]:
+    return [item.strip() for item in text.split(",") if item.strip()]
+
+
+def scenario_name(hunters: int, layout: str, logging: str, threads: str) -> str:
+    thread_text = "entity" if threads == "entity" else f"t{threads}"
+    return f"h{hunters}-{layout}-log_{logging}-{thread_text}"
+
+
+def scenario_args(args: argparse.Namespace, hunters: int, layout: str, logging: str, threads: str) -> List[str]:
+    command = [os.path.abspath(args.project), "--seed", str(args.seed), "--hunters", str(hunters), "--stats"]
+
+    if layout == "generated":
+        command += ["--rooms", str(args.rooms)]
+
+    if logging == "off":
+        command.append("--no-log")
+    elif logging == "buffered":
+        command.append("--log-buffered")
+
+    if logging != "off" and args.keep_pause:
+        command += ["--log-timestamps", "ms"]
+
+    if threads != "entity":
+        command += ["--threads", threads]
+
+    return command
+
+
+def run_once(command: List[str], timeout: float) -> Dict[str, object]:
+    """Runs one simulation process in a scratch directory and collects its measurements."""
+    scratch = tempfile.mkdtemp(prefix="ghost_scenario_")
+    stderr_path = os.path.join(scratch, "stderr.txt")
+
+    try:
+        with open(stderr_path, "w") as stderr_file:
+            start = time.perf_counter()
+            process = subprocess.Popen(command, cwd=scratch, stdin=subprocess.DEVNULL,
+                                       stdout=subprocess.DEVNULL, stderr=stderr_file)
+
+            # wait4 hands back the resource usage of this child only, the timer kills runs that hang
+            killer = threading.Timer(timeout, process.kill)
+            killer.start()
+            pid, status, usage = os.wait4(process.pid, 0)
+            killer.cancel()
+            timed_out = os.WIFSIGNALED(status) and os.WTERMSIG(status) == signal.SIGKILL
+            wall = time.perf_counter() - start
+            process.returncode = os.waitstatus_to_exitcode(status)
+
+        with open(stderr_path) as stderr_file:
+            stderr_text = stderr_file.read()
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+
+    result: Dict[str, object] = {
+        "ok": process.returncode == 0 and not timed_out,
+        "exit_code": process.returncode,
+        "timed_out": timed_out,
+        "wall_s": wall,
+        "peak_rss_kb": usage.ru_maxrss,
+        "voluntary_ctx_switches": usage.ru_nvcsw,
+        "involuntary_ctx_switches": usage.ru_nivcsw,
+        "user_s": usage.ru_utime,
+        "system_s": usage.ru_stime,
+    }
+
+    match = STATS_PATTERN.search(stderr_text)
+    if match:
+        stats = dict(pair.split("=", 1) for pair in match.group(1).split() if "=" in pair)
+        for key, value in stats.items():
+            if key in ("hunters", "rooms", "run_ns"):
+                continue
+            result[STATS_RENAMES.get(key, key)] = int(value)
+        turns = int(stats.get("turns", 0))
+        run_s = int(stats.get("run_ns", 0)) / 1e9
+        result["run_s"] = run_s
+        # Simulation time only, wall also counts process startup, house setup and teardown
+        result["turns_per_s"] = turns / run_s if run_s > 0 else 0.0
+    elif not result["ok"]:
+        result["error"] = stderr_text.strip().splitlines()[-1] if stderr_text.strip() else "no output"
+
+    return result
+
+
+def summarize(runs: List[Dict[str, object]]) -> Dict[str, object]:
+    ok_runs = [run for run in runs if run["ok"]]
+    summary: Dict[str, object] = {"ok_runs": len(ok_runs), "failed_runs": len(runs) - len(ok_runs)}
+
+    if not ok_runs:
+        return summary
+
+    walls = [float(run["wall_s"]) for run in ok_runs]
+    rates = [float(run.get("turns_per_s", 0.0)) for run in ok_runs]
+    switches = [int(run["voluntary_ctx_switches"]) + int(run["involuntary_ctx_switches"]) for run in ok_runs]
+
+    summary.update({
+        "wall_s_median": statistics.median(walls),
+        "wall_s_min": min(walls),
+        "turns_median": statistics.median(int(run.get("turns", 0)) for run in ok_runs),
+        "allocations_median": statistics.median(int(run.get("allocations", 0)) for run in ok_runs),
+        "turns_per_s_median": statistics.median(rates),
+        "sims_per_s": len(ok_runs) / sum(walls) if sum(walls) > 0 else 0.0,
+        "peak_rss_kb_max": max(int(run["peak_rss_kb"]) for run in ok_runs),
+        "ctx_switches_median": statistics.median(switches),
+    })
+
+    return summary
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Run the end-to-end scenario benchmarks and write a JSON report.")
+    parser.add_argument("--project", type=str, default="./project", help="Simulation executable.")
+    parser.add_argument("--reps", type=int, default=3, help="Repeated runs per scenario.")
+    parser.add_argument("--seed", type=int, default=1, help="Base seed used by every run.")
+    parser.add_argument("--hunters", type=str, default=DEFAULT_HUNTERS, help="Hunter counts to run.")
+    parser.add_argument("--layouts", type=str, default=DEFAULT_LAYOUTS, help="Layouts to run: willow, generated.")
+    parser.add_argument("--rooms", type=int, default=256, help="Room count of the generated layout.")
+    parser.add_argument("--logging", type=str, default=DEFAULT_LOGGING, help="Logging modes to run: on, buffered, off.")
+    parser.add_argument("--threads", type=str, default=DEFAULT_THREADS,
+                        help="Thread settings to sweep: entity (one thread per entity) or worker pool sizes.")
+    parser.add_argument("--keep-pause", action="store_true", help="Log millisecond timestamps with the pause after each record.")
+    parser.add_argument("--timeout", type=float, default=600.0, help="Seconds before a run is killed.")
+    parser.add_argument("--output", type=str, default="scenario_report.json", help="JSON report file.")
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.project):
+        sys.exit(f"{args.project} not found, build it with make first")
+
+    hunter_counts = [int(value) for value in parse_list(args.hunters)]
+    layouts = parse_list(args.layouts)
+    logging_modes = parse_list(args.logging)
+    thread_settings = parse_list(args.threads)
+
+    for layout in layouts:
+        if layout not in ("willow", "generated"):
+            sys.exit(f"Unknown layout {layout}")
+    for mode in logging_modes:
+        if mode not in ("on", "buffered", "off"):
+            sys.exit(f"Unknown logging mode {mode}")
+    for threads in thread_settings:
+        if threads != "entity" and not threads.isdigit():
+            sys.exit(f"Unknown thread setting {threads}")
+
+    scenarios = []
+    matrix = list(itertools.product(hunter_counts, layouts, logging_modes, thread_settings))
+
+    for index, (hunters, layout, logging, threads) in enumerate(matrix, start=1):
+        name = scenario_name(hunters, layout, logging, threads)
+        command = scenario_args(args, hunters, layout, logging, threads)
+
+        runs = [run_once(command, args.timeout) for _ in range(args.reps)]
+        summary = summarize(runs)
+
+        scenarios.append({
+            "name": name,
+            "hunters": hunters,
+            "layout": layout,
+            "rooms": args.rooms if layout == "generated" else 13,
+            "logging": logging,
+            "threads": threads,
+            "command": command[1:],
+            "runs": runs,
+            "summary": summary,
+        })
+
+        if summary["ok_runs"]:
+            print(f"[{index}/{len(matrix)}] {name:<40} {summary['wall_s_median'] * 1000:10.2f} ms "
+                  f"{summary['turns_per_s_median']:14.0f} turns/s {summary['peak_rss_kb_max']:8d} KB")
+        else:
+            print(f"[{index}/{len(matrix)}] {name:<40} FAILED ({runs[-1].get('error', 'exit ' + str(runs[-1]['exit_code']))})")
+
+    report = {
+        "format": REPORT_FORMAT,
+        "version": REPORT_VERSION,
+        "created": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "host": {
+            "platform": platform.platform(),
+            "cpus": os.cpu_count(),
+        },
+        "seed": args.seed,
+        "reps": args.reps,
+        "log_pause": args.keep_pause,
+        "scenarios": scenarios,
+    }
+
+    with open(args.output, "w") as handle:
+        json.dump(report, handle, indent=2)
+
+    print(f"\nWrote {len(scenarios)} scenarios to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,499 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Binary checkpoint layout (host byte order, all integers 32-bit unless noted):
+//   magic "GHCK", version, base seed, round count (64-bit)
+//   room count, starting room index, then per room:
+//       name, is_exit, connection count + room indices, evidence byte, occupant count + hunter indices
+//   ghost: id, type, room index, boredom, running, exited, PRNG state
+//   case file: collected, solved
+//   hunter count, then per hunter:
+//       name, id, room index, device, boredom, fear, exit reason, flags, PRNG state, path depth + room indices (top first)
+// Pointers are stored as indices into House.rooms and House.hunter_arr, -1 for NULL.
+
+#define CHECKPOINT_MAGIC "GHCK"
+#define CHECKPOINT_VERSION 1
+
+// WRITE HELPERS
+
+static int ckpt_write_i32(FILE *file, int32_t value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static int ckpt_write_i64(FILE *file, int64_t value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static int ckpt_write_bytes(FILE *file, const void *bytes, size_t size) {
+    return fwrite(bytes, 1, size, file) == size;
+}
+
+// READ HELPERS
+
+static int ckpt_read_i32(FILE *file, int32_t *value) {
+    return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+static int ckpt_read_i64(FILE *file, int64_t *value) {
+    return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+static int ckpt_read_bytes(FILE *file, void *bytes, size_t size) {
+    return fread(bytes, 1, size, file) == size;
+}
+
+// INDEX HELPERS
+
+// Gets index of room in house room array, -1 if room is NULL
+static int32_t ckpt_room_index(const House *house, const Room *room) {
+
+    if (room == NULL) {
+        return -1;
+    }
+
+    return (int32_t)(room - house->rooms);
+}
+
+// Gets index of hunter in house dynamic hunter array, -1 if not found
+static int32_t ckpt_hunter_index(const House *house, const Hunter *hunter) {
+
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+        if (house->hunter_arr.hunters[i] == hunter) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Gets room pointer from a stored room index, false if index is out of range
+static bool ckpt_room_from_index(House *house, int32_t index, Room **room) {
+
+    if (index == -1) {
+        *room = NULL;
+        return true;
+    }
+
+    if ((index < 0) || (index >= house->room_count)) {
+        return false;
+    }
+
+    *room = house->rooms + index;
+    return true;
+}
+
+// SAVE
+
+static int ckpt_write_room(FILE *file, const House *house, const Room *room) {
+
+    int ok = ckpt_write_bytes(file, room->name, MAX_ROOM_NAME);
+    ok = ok && ckpt_write_i32(file, room->is_exit);
+    ok = ok && ckpt_write_i32(file, room->connect_count);
+
+    for (int i = 0; ok && (i < room->connect_count); i++) {
+        ok = ckpt_write_i32(file, ckpt_room_index(house, room->rooms_connected[i]));
+    }
+
+    ok = ok && ckpt_write_i32(file, room->evidence);
+    ok = ok && ckpt_write_i32(file, room->hunter_arr.hunter_count);
+
+    for (int i = 0; ok && (i < room->hunter_arr.hunter_count); i++) {
+        ok = ckpt_write_i32(file, ckpt_hunter_index(house, room->hunter_arr.hunters[i]));
+    }
+
+    return ok;
+}
+
+static int ckpt_write_hunter(FILE *file, const House *house, const Hunter *hunter) {
+
+    int ok = ckpt_write_bytes(file, hunter->name, MAX_HUNTER_NAME);
+    ok = ok && ckpt_write_i32(file, hunter->id);
+    ok = ok && ckpt_write_i32(file, ckpt_room_index(house, hunter->room));
+    ok = ok && ckpt_write_i32(file, hunter->device_type);
+    ok = ok && ckpt_write_i32(file, hunter->boredom);
+    ok = ok && ckpt_write_i32(file, hunter->fear);
+    ok = ok && ckpt_write_i32(file, hunter->exited_reason);
+    ok = ok && ckpt_write_i32(file, hunter->init_first_room);
+    ok = ok && ckpt_write_i32(file, hunter->init_added_to_van);
+    ok = ok && ckpt_write_i32(file, hunter->return_to_van);
+    ok = ok && ckpt_write_i32(file, hunter->running);
+    ok = ok && ckpt_write_i32(file, hunter->exited);
+    ok = ok && ckpt_write_i32(file, (int32_t)hunter->rand_seed);
+
+    // Counts room path stack depth before writing its rooms
+    int32_t depth = 0;
+    for (RoomNode *node = hunter->rooms_path.head; node != NULL; node = node->next) {
+        depth++;
+    }
+
+    ok = ok && ckpt_write_i32(file, depth);
+
+    for (RoomNode *node = hunter->rooms_path.head; ok && (node != NULL); node = node->next) {
+        ok = ckpt_write_i32(file, ckpt_room_index(house, node->room));
+    }
+
+    return ok;
+}
+
+/*
+    Purpose:
+        Writes the full simulation state of the house to a versioned binary checkpoint file.
+        Must be called while no entity is mid-turn (before threads start, between single-threaded rounds or after threads join).
+        The file is written next to the destination and renamed over it, so a crash never leaves a half-written checkpoint.
+    Parameters:
+        - house (in): house structure
+        - path (in): checkpoint file path
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int house_checkpoint_save(const House *house, const char *path) {
+
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    FILE *file = fopen(temp_path, "wb");
+
+    if (file == NULL) {
+        printf("\nERROR: Checkpoint file %s could not be opened for writing...\n", temp_path);
+        return C_ERR;
+    }
+
+    // Header
+    int ok = ckpt_write_bytes(file, CHECKPOINT_MAGIC, 4);
+    ok = ok && ckpt_write_i32(file, CHECKPOINT_VERSION);
+    ok = ok && ckpt_write_i32(file, (int32_t)rand_get_base_seed());
+    ok = ok && ckpt_write_i64(file, house->round_count);
+
+    // Rooms
+    ok = ok && ckpt_write_i32(file, house->room_count);
+    ok = ok && ckpt_write_i32(file, ckpt_room_index(house, house->starting_room));
+
+    for (int i = 0; ok && (i < house->room_count); i++) {
+        ok = ckpt_write_room(file, house, house->rooms + i);
+    }
+
+    // Ghost
+    const Ghost *ghost = &(house->ghost);
+    ok = ok && ckpt_write_i32(file, ghost->id);
+    ok = ok && ckpt_write_i32(file, ghost->type);
+    ok = ok && ckpt_write_i32(file, ckpt_room_index(house, ghost->room));
+    ok = ok && ckpt_write_i32(file, ghost->boredom);
+    ok = ok && ckpt_write_i32(file, ghost->running);
+    ok = ok && ckpt_write_i32(file, ghost->exited);
+    ok = ok && ckpt_write_i32(file, (int32_t)ghost->rand_seed);
+
+    // Case file
+    ok = ok && ckpt_write_i32(file, house->case_file.collected);
+    ok = ok && ckpt_write_i32(file, house->case_file.solved);
+
+    // Hunters
+    ok = ok && ckpt_write_i32(file, house->hunter_arr.hunter_count);
+
+    for (int i = 0; ok && (i < house->hunter_arr.hunter_count); i++) {
+        ok = ckpt_write_hunter(file, house, house->hunter_arr.hunters[i]);
+    }
+
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+
+    if (!ok) {
+        printf("\nERROR: Checkpoint could not be written to %s...\n", temp_path);
+        remove(temp_path);
+        return C_ERR;
+    }
+
+    if (rename(temp_path, path) != 0) {
+        printf("\nERROR: Checkpoint could not be moved to %s...\n", path);
+        remove(temp_path);
+        return C_ERR;
+    }
+
+    return C_OK;
+}
+
+// LOAD
+
+static int ckpt_read_room(FILE *file, House *house, Room *room) {
+
+    char name[MAX_ROOM_NAME];
+    int32_t is_exit, connect_count, evidence, hunter_count;
+
+    if (!ckpt_read_bytes(file, name, MAX_ROOM_NAME) || !ckpt_read_i32(file, &is_exit) || !ckpt_read_i32(file, &connect_count)) {
+        return C_ERR;
+    }
+
+    name[MAX_ROOM_NAME - 1] = '\0';
+    room_init(room, name, is_exit);             // rebuilds room semaphores
+
+    if ((connect_count < 0) || (connect_count > MAX_CONNECTIONS)) {
+        return C_ERR;
+    }
+
+    // Connections are restored directly, room_connect would connect both rooms twice
+    for (int i = 0; i < connect_count; i++) {
+
+        int32_t index;
+        Room *connected;
+
+        if (!ckpt_read_i32(file, &index) || !ckpt_room_from_index(house, index, &connected) || (connected == NULL)) {
+            return C_ERR;
+        }
+
+        room->rooms_connected[i] = connected;
+    }
+
+    room->connect_count = connect_count;
+
+    if (!ckpt_read_i32(file, &evidence) || !ckpt_read_i32(file, &hunter_count)) {
+        return C_ERR;
+    }
+
+    room->evidence = (EvidenceByte)evidence;
+
+    if ((hunter_count < 0) || (hunter_count > MAX_ROOM_OCCUPANCY)) {
+        return C_ERR;
+    }
+
+    // Occupant hunter indices are resolved once all hunters are loaded, stored as pointer-sized indices until then
+    for (int i = 0; i < hunter_count; i++) {
+
+        int32_t index;
+
+        if (!ckpt_read_i32(file, &index)) {
+            return C_ERR;
+        }
+
+        room->hunter_arr.hunters[i] = (Hunter*)(intptr_t)index;
+    }
+
+    room->hunter_arr.hunter_count = hunter_count;
+
+    return C_OK;
+}
+
+static int ckpt_read_hunter(FILE *file, House *house, Hunter **loaded) {
+
+    char name[MAX_HUNTER_NAME];
+    int32_t id, room_index, device, boredom, fear, exited_reason;
+    int32_t init_first_room, init_added_to_van, return_to_van, running, exited, rand_seed, depth;
+
+    if (!ckpt_read_bytes(file, name, MAX_HUNTER_NAME)) {
+        return C_ERR;
+    }
+
+    name[MAX_HUNTER_NAME - 1] = '\0';
+
+    int ok = ckpt_read_i32(file, &id) && ckpt_read_i32(file, &room_index) && ckpt_read_i32(file, &device);
+    ok = ok && ckpt_read_i32(file, &boredom) && ckpt_read_i32(file, &fear) && ckpt_read_i32(file, &exited_reason);
+    ok = ok && ckpt_read_i32(file, &init_first_room) && ckpt_read_i32(file, &init_added_to_van);
+    ok = ok && ckpt_read_i32(file, &return_to_van) && ckpt_read_i32(file, &running) && ckpt_read_i32(file, &exited);
+    ok = ok && ckpt_read_i32(file, &rand_seed) && ckpt_read_i32(file, &depth);
+
+    if (!ok) {
+        return C_ERR;
+    }
+
+    Hunter *hunter;
+    Room *room;
+
+    if (!ckpt_room_from_index(house, room_index, &room) || (depth < 0)) {
+        return C_ERR;
+    }
+
+    // Device index 0 is requested only so that hunter_init does not draw from the PRNG, device is overwritten below
+    if (!hunter_init(&hunter, name, id, true, 0)) {
+        return C_ERR;
+    }
+
+    hunter->room = room;
+    hunter->case_file = &(house->case_file);
+    hunter->device_type = (enum EvidenceType)device;
+    hunter->chosen_device = -1;
+    hunter->boredom = boredom;
+    hunter->fear = fear;
+    hunter->exited_reason = (enum LogReason)exited_reason;
+    hunter->init_first_room = init_first_room;
+    hunter->init_added_to_van = init_added_to_van;
+    hunter->return_to_van = return_to_van;
+    hunter->running = running;
+    hunter->exited = exited;
+    hunter->rand_seed = (unsigned)rand_seed;
+
+    *loaded = hunter;
+
+    // Stack is stored top first, reads it into a temporary array to push it back bottom first
+    if (depth == 0) {
+        return C_OK;
+    }
+
+    int32_t *indices = (int32_t*)malloc((size_t)depth * sizeof(int32_t));
+
+    if (indices == NULL) {
+        printf("\nERROR: Memory allocation error... \n");
+        return C_ERR;
+    }
+
+    for (int i = 0; i < depth; i++) {
+        if (!ckpt_read_i32(file, indices + i)) {
+            free(indices);
+            return C_ERR;
+        }
+    }
+
+    for (int i = depth - 1; i >= 0; i--) {
+
+        Room *path_room;
+
+        if (!ckpt_room_from_index(house, indices[i], &path_room) || (path_room == NULL)) {
+            free(indices);
+            return C_ERR;
+        }
+
+        roomstack_push(&(hunter->rooms_path), path_room);
+    }
+
+    free(indices);
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Restores the full simulation state of a house from a binary checkpoint file.
+        Rebuilds all room and case file semaphores, hunters are allocated on the heap as with hunter_init.
+        Entity threads (or the single-threaded engine) can be started on the house afterwards to resume the run.
+    Parameters:
+        - house (out): house structure, initialized with house_create_stack and not yet populated
+        - path (in): checkpoint file path
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int house_checkpoint_load(House *house, const char *path) {
+
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        printf("\nERROR: Checkpoint file %s could not be opened...\n", path);
+        return C_ERR;
+    }
+
+    char magic[4];
+    int32_t version, base_seed, room_count, start_index;
+    int64_t round_count;
+
+    int ok = ckpt_read_bytes(file, magic, 4) && (memcmp(magic, CHECKPOINT_MAGIC, 4) == 0);
+    ok = ok && ckpt_read_i32(file, &version);
+
+    if (!ok || (version != CHECKPOINT_VERSION)) {
+        printf("\nERROR: %s is not a version %d checkpoint file...\n", path, CHECKPOINT_VERSION);
+        fclose(file);
+        return C_ERR;
+    }
+
+    ok = ckpt_read_i32(file, &base_seed) && ckpt_read_i64(file, &round_count);
+    ok = ok && ckpt_read_i32(file, &room_count) && ckpt_read_i32(file, &start_index);
+    ok = ok && (room_count > 0) && (room_count <= MAX_ROOMS);
+
+    if (ok) {
+        rand_set_base_seed((unsigned)base_seed);
+        house->round_count = round_count;
+        house->room_count = room_count;
+        ok = ckpt_room_from_index(house, start_index, &(house->starting_room));
+    }
+
+    // Rooms
+    for (int i = 0; ok && (i < room_count); i++) {
+        ok = ckpt_read_room(file, house, house->rooms + i);
+    }
+
+    // Ghost
+    Ghost *ghost = &(house->ghost);
+    int32_t ghost_id, ghost_type, ghost_room, ghost_boredom, ghost_running, ghost_exited, ghost_seed;
+
+    ok = ok && ckpt_read_i32(file, &ghost_id) && ckpt_read_i32(file, &ghost_type) && ckpt_read_i32(file, &ghost_room);
+    ok = ok && ckpt_read_i32(file, &ghost_boredom) && ckpt_read_i32(file, &ghost_running) && ckpt_read_i32(file, &ghost_exited);
+    ok = ok && ckpt_read_i32(file, &ghost_seed);
+
+    if (ok) {
+        ghost->id = ghost_id;
+        ghost->type = (enum GhostType)ghost_type;
+        ghost->boredom = ghost_boredom;
+        ghost->running = ghost_running;
+        ghost->exited = ghost_exited;
+        ghost->rand_seed = (unsigned)ghost_seed;
+        ghost->room = NULL;
+
+        Room *room;
+        ok = ckpt_room_from_index(house, ghost_room, &room);
+
+        if (ok && (room != NULL)) {
+            room_add_ghost(room, ghost);
+        }
+    }
+
+    // Case file
+    int32_t collected, solved;
+
+    ok = ok && ckpt_read_i32(file, &collected) && ckpt_read_i32(file, &solved);
+
+    if (ok) {
+        casefile_init(&(house->case_file));     // rebuilds case file semaphore
+        house->case_file.collected = (EvidenceByte)collected;
+        house->case_file.solved = solved;
+    }
+
+    // Hunters
+    int32_t hunter_count;
+
+    ok = ok && dynamic_hunterarr_init(&(house->hunter_arr));
+    ok = ok && ckpt_read_i32(file, &hunter_count) && (hunter_count >= 0);
+
+    for (int i = 0; ok && (i < hunter_count); i++) {
+
+        Hunter *hunter = NULL;
+        ok = ckpt_read_hunter(file, house, &hunter);
+
+        if (hunter != NULL) {
+            dynamic_hunterarr_add(&(house->hunter_arr), hunter);
+        }
+    }
+
+    // Resolves room occupant indices to hunter pointers now that every hunter exists
+    for (int i = 0; ok && (i < room_count); i++) {
+
+        FixedHunterArray *occupants = &(house->rooms[i].hunter_arr);
+
+        for (int j = 0; ok && (j < occupants->hunter_count); j++) {
+
+            intptr_t index = (intptr_t)occupants->hunters[j];
+
+            if ((index < 0) || (index >= hunter_count)) {
+                ok = 0;
+            }
+            else {
+                occupants->hunters[j] = house->hunter_arr.hunters[index];
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (!ok) {
+        // Occupants of any room may still be indices rather than hunters, cleanup must not treat them as pointers
+        for (int i = 0; i < house->room_count; i++) {
+            house->rooms[i].hunter_arr.hunter_count = 0;
+        }
+
+        printf("\nERROR: Checkpoint file %s is truncated or corrupt...\n", path);
+        return C_ERR;
+    }
+
+    house_check_entities_running(house);
+
+    return C_OK;
+}
@@ -8,12 +8,13 @@
 #define MAX_ROOM_NAME 64
 #define MAX_HUNTER_NAME 64
 #define MAX_INPUT_STRING 64
-#define MAX_ROOMS 24
+#define MAX_ROOMS 256                  // Willow uses 13, generated layouts can use the rest
 #define MAX_ROOM_OCCUPANCY 8
 #define MAX_CONNECTIONS 8
 #define ENTITY_BOREDOM_MAX 15
 #define HUNTER_FEAR_MAX 15
 #define DEFAULT_GHOST_ID 68057
+#define DECISION_NO_ENTITY -1
 
 #define C_NOT_FOUND -3
 #define C_ROOM_FULL -2
@@ -35,6 +36,8 @@ typedef struct Room Room;
 typedef struct RoomNode RoomNode;
 typedef struct RoomStack RoomStack;
 
+typedef struct LatencyHistogram LatencyHistogram;     // defined in latency.c
+
 enum LogReason {
     LR_EVIDENCE = 0,
     LR_BORED = 1,
@@ -42,6 +45,58 @@ enum LogReason {
     LR_NOT_YET_EXIT = -1,       // acts as placeholder, never want it to actually appear on logs
 };
 
+// Kinds of random decisions captured by a decision trace
+enum DecisionType {
+    DEC_GHOST_TYPE = 0,
+    DEC_START_ROOM = 1,
+    DEC_GHOST_ACTION = 2,
+    DEC_MOVE_TARGET = 3,
+    DEC_HAUNT_EVIDENCE = 4,
+    DEC_DEVICE = 5,
+    DEC_RETURN_ROLL = 6,
+};
+
+enum DecisionMode {
+    DECISION_OFF = 0,
+    DECISION_RECORD = 1,
+    DECISION_REPLAY = 2,
+};
+
+// Invariants checked live by the invariant checker (make CHECKS=1)
+enum InvariantType {
+    INV_EDGE = 0,
+    INV_RETURN_PATH = 1,
+    INV_EVIDENCE = 2,
+    INV_BOREDOM = 3,
+    INV_OCCUPANCY = 4,
+    INV_TYPE_COUNT = 5,
+};
+
+// Formats the results writer appends a run's results in (--results)
+enum ResultsFormat {
+    RESULTS_JSON = 0,       // one JSON object per run, one run per line
+    RESULTS_CSV = 1,        // one row per hunter, run columns repeated on every row
+};
+
+// How buffered log batches reach the log files (--log-writer)
+enum LogWriterBackend {
+    LOG_WRITER_STDIO = 0,   // each logging thread writes its own batches through stdio
+    LOG_WRITER_WRITEV = 1,  // a writer thread writes batches with writev
+    LOG_WRITER_URING = 2,   // a writer thread submits batches to io_uring
+};
+
+// What a turn did, for turn latency histograms (a turn doing several things counts as the highest)
+enum LatencyAction {
+    LAT_MOVE = 0,
+    LAT_RETURN = 1,
+    LAT_IDLE = 2,
+    LAT_HAUNT = 3,
+    LAT_EVIDENCE = 4,
+    LAT_SWAP = 5,
+    LAT_EXIT = 6,
+    LAT_ACTION_COUNT = 7,
+};
+
 enum EvidenceType {
     EV_EMF          = 1 << 0,
     EV_ORBS         = 1 << 1,
@@ -118,6 +173,9 @@ struct Ghost {
 	int boredom;
 	bool running;       
 	bool exited;   
+    unsigned rand_seed;         // PRNG state the ghost draws its decisions from
+    long turn_count;            // turns taken in this process (not checkpointed)
+    LatencyHistogram *turn_latency;     // turn times when run with --latency, NULL otherwise
     pthread_t thread;         
 };
 
@@ -128,6 +186,7 @@ struct Hunter {
     Room *room;
     CaseFile *case_file;
     enum EvidenceType device_type;
+    int chosen_device;                  // device index the user picked, -1 when the device was drawn at random
     RoomStack rooms_path;              
     int boredom;
     int fear;
@@ -137,6 +196,10 @@ struct Hunter {
     bool return_to_van;
     bool running;
     bool exited;
+    unsigned rand_seed;                 // PRNG state the hunter draws its decisions from
+    long turn_count;                    // turns taken in this process (not checkpointed)
+    int evidence_found;                 // evidence collected in this process (not checkpointed)
+    LatencyHistogram *turn_latency;     // turn times when run with --latency, NULL otherwise
     pthread_t thread;        
 };
 
@@ -161,6 +224,7 @@ struct House {
     DynamicHunterArray hunter_arr;
     CaseFile case_file;
     bool entities_running;
+    long round_count;               // rounds completed by the single-threaded engine
     int room_count;  
     Room rooms[MAX_ROOMS];           
 };
@@ -171,6 +235,26 @@ void house_cleanup_stack(House *house);
 int house_load_data(House *house);
 int house_add_hunter(House *house, Hunter *hunter);
 void house_check_entities_running(House *house);               // for single threading, do not think I will need for multi-threading
+void house_run_single_thread(House *house, long checkpoint_every, const char *checkpoint_path);
+void house_run_workers(House *house, int worker_count);
+int house_generate_rooms(House *house, int room_count);
+int house_write_room_graph(const House *house);
+long house_turn_count(const House *house);
+
+// Checkpoint Functions
+int house_checkpoint_save(const House *house, const char *path);
+int house_checkpoint_load(House *house, const char *path);
+
+// Decision Trace Functions
+int decision_trace_record(const char *path);
+int decision_trace_replay(const char *path);
+enum DecisionMode decision_trace_mode(void);
+void decision_bind_entity(int entity_id);
+int decision_bound_entity(void);
+int decision_rand(enum DecisionType type, int lower_inclusive, int upper_exclusive);
+void decision_trace_add_hunter(const Hunter *hunter);
+int decision_trace_create_hunters(House *house);
+void decision_trace_close(void);
 
 // Room Functions
 int room_init(Room* room, const char* name, bool is_exit);
@@ -285,6 +369,123 @@ void hunter_result_print(const Hunter *hunter);
 void hunters_all_result_print(const DynamicHunterArray *hunter_arr);
 int hunters_win_count(const DynamicHunterArray *hunter_arr);
 
+// Invariant Checker Functions (only called through the CHECK_* macros below)
+int invariant_path_depth(const RoomStack *room_stack);
+void invariant_check_hunter_move(const Hunter *hunter, const Room *from, const Room *to, bool returning, int depth_before);
+void invariant_check_ghost_move(const Ghost *ghost, const Room *from, const Room *to);
+void invariant_check_return_complete(const Hunter *hunter);
+void invariant_check_evidence_collect(const Hunter *hunter);
+void invariant_check_evidence_drop(const Ghost *ghost, enum EvidenceType evidence);
+void invariant_check_boredom(int entity_id, int previous, int boredom, bool shares_room);
+void invariant_check_hunter_exit(const Hunter *hunter, const Room *room);
+unsigned long invariants_report(void);
+
+// Invariant checks compile to nothing unless built with make CHECKS=1
+#ifdef SIM_CHECKS
+#define CHECK_PATH_DEPTH(room_stack) invariant_path_depth(room_stack)
+#define CHECK_HUNTER_MOVE(hunter, from, to, returning, depth_before) invariant_check_hunter_move(hunter, from, to, returning, depth_before)
+#define CHECK_GHOST_MOVE(ghost, from, to) invariant_check_ghost_move(ghost, from, to)
+#define CHECK_RETURN_COMPLETE(hunter) invariant_check_return_complete(hunter)
+#define CHECK_EVIDENCE_COLLECT(hunter) invariant_check_evidence_collect(hunter)
+#define CHECK_EVIDENCE_DROP(ghost, evidence) invariant_check_evidence_drop(ghost, evidence)
+#define CHECK_BOREDOM(entity_id, previous, boredom, shares_room) invariant_check_boredom(entity_id, previous, boredom, shares_room)
+#define CHECK_HUNTER_EXIT(hunter, room) invariant_check_hunter_exit(hunter, room)
+#define CHECK_REPORT() invariants_report()
+#else
+#define CHECK_PATH_DEPTH(room_stack) 0
+#define CHECK_HUNTER_MOVE(hunter, from, to, returning, depth_before) ((void)(returning), (void)(depth_before))
+#define CHECK_GHOST_MOVE(ghost, from, to) ((void)0)
+#define CHECK_RETURN_COMPLETE(hunter) ((void)0)
+#define CHECK_EVIDENCE_COLLECT(hunter) ((void)0)
+#define CHECK_EVIDENCE_DROP(ghost, evidence) ((void)0)
+#define CHECK_BOREDOM(entity_id, previous, boredom, shares_room) ((void)(previous))
+#define CHECK_HUNTER_EXIT(hunter, room) ((void)0)
+#define CHECK_REPORT() ((void)0)
+#endif
+
+// Turn Latency Functions
+void latency_set_enabled(bool enabled);
+void latency_mark_action(enum LatencyAction action);
+long long latency_turn_begin(void);
+void latency_turn_end(LatencyHistogram **entity_hist, long long start_ns);
+enum LatencyAction latency_turn_action(void);
+const char* latency_action_to_string(enum LatencyAction action);
+void latency_thread_flush(void);
+void latency_report(const House *house);
+
+// Trace Event Functions (--trace-events FILE, every function is a no-op while tracing is off)
+extern bool trace_events_enabled;
+int trace_events_open(const char *path, const House *house);
+long long trace_begin(void);
+void trace_turn(int entity_id, const char *room, long long start_ns);
+void trace_move(int entity_id, const char *from, const char *to, long long start_ns);
+void trace_log_write(int entity_id, const char *room, long long start_ns, long long end_ns);
+void trace_lock_event(const sem_t *sem, long long start_ns, long long end_ns);
+int trace_lock_wait(sem_t *sem);
+void trace_thread_flush(void);
+void trace_events_close(void);
+
+// Results Export Functions
+bool house_hunters_win(const House *house);
+int results_write(const char *path, enum ResultsFormat format, const House *house, long long run_ns, const char *run_id);
+
+// Live Metrics Functions (--metrics-socket PATH)
+int metrics_server_start(const char *path, const House *house);
+void metrics_server_stop(void);
+
+// Flight Recorder Functions (every function is a no-op while the recorder is off)
+struct LogRecord;
+int flight_recorder_start(int records_per_thread, const char *dump_path);
+int flight_watchdog_start(const House *house, long stall_ms);
+void flight_record(const struct LogRecord *record);
+void flight_thread_release(void);
+int flight_recorder_dump(const char *reason);
+void flight_recorder_stop(void);
+
+// Memory-Mapped Log Functions (--log-mmap, records of every entity go into shared events_<n>.csv segments)
+extern bool mmap_log_enabled;
+int mmap_log_open(size_t segment_bytes);
+int mmap_log_append(const char *line, size_t length);
+void mmap_log_close(void);
+
+// Merged Timeline Functions (--timeline, every entity's records in one globally ordered timeline.csv)
+extern bool timeline_enabled;
+int timeline_open(void);
+unsigned long timeline_reserve(void);
+void timeline_publish(unsigned long seq, const char *line, size_t length);
+void timeline_close(void);
+
+// Log Writer Functions (--log-writer, batches come from the buffered logging in helpers.c)
+const char* log_writer_backend_to_string(enum LogWriterBackend backend);
+bool log_writer_set_compression(int level);
+enum LogWriterBackend log_writer_start(enum LogWriterBackend requested);
+bool log_writer_running(void);
+void log_writer_append_begin(void);
+bool log_writer_append(int entity_id, unsigned segment, const char *line, size_t length);
+void log_writer_append_end(void);
+void log_writer_stop(void);
+
+// Lock Contention Functions (only called through the LOCK_* macros below)
+void lockstats_register(sem_t *sem);
+int lockstats_wait(sem_t *sem);
+int lockstats_post(sem_t *sem);
+long long lockstats_total_wait_ns(void);
+void lockstats_report(const House *house);
+
+// Room and case file locks are taken through these, they are plain sem_wait/sem_post unless built with make LOCKSTATS=1
+// (waits go through trace_lock_wait while --trace-events is on, so contended waits show up in the trace)
+#ifdef SIM_LOCK_STATS
+#define LOCK_REGISTER(sem) lockstats_register(sem)
+#define LOCK_WAIT(sem) lockstats_wait(sem)
+#define LOCK_POST(sem) lockstats_post(sem)
+#define LOCK_STATS_REPORT(house) lockstats_report(house)
+#else
+#define LOCK_REGISTER(sem) ((void)0)
+#define LOCK_WAIT(sem) (trace_events_enabled ? trace_lock_wait(sem) : sem_wait(sem))
+#define LOCK_POST(sem) sem_post(sem)
+#define LOCK_STATS_REPORT(house) ((void)0)
+#endif
+
 // Testing Functions
 void house_print_rooms(const House *house);
 void house_print_ghost(const House *house);
@@ -24,6 +24,8 @@ int casefile_init(CaseFile *case_file) {
         exit(1);
     }
 
+    LOCK_REGISTER(&(case_file->mutex));         // starts contention counters (make LOCKSTATS=1 only)
+
     // Initializes case file fields to simulation starting values
     case_file->collected = 0;
     case_file->solved = false;
@@ -40,7 +42,8 @@ int casefile_init(CaseFile *case_file) {
 */
 void casefile_evidence_add(CaseFile *case_file, enum EvidenceType evidence) {
 
-    case_file->collected = evidence_byte_set_type(case_file->collected, evidence);
+    // Written under the case file mutex, stored atomically for the metrics thread that reads it without the mutex
+    __atomic_store_n(&(case_file->collected), evidence_byte_set_type(case_file->collected, evidence), __ATOMIC_RELAXED);
 }
 
 /*
@@ -76,7 +79,7 @@ bool casefile_check_victory(const CaseFile *case_file) {
 */
 void casefile_solved(CaseFile *case_file) {
     
-    case_file->solved = true;
+    __atomic_store_n(&(case_file->solved), true, __ATOMIC_RELAXED);      // read by the metrics thread without the mutex
 }
 
 /*
@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Flight recorder: the last log records of every thread, kept in memory whether or not log files are written.
+// Each thread appends to its own fixed-size ring with plain stores (no locks, no system calls besides the clock),
+// and the rings are written to a CSV file only when something goes wrong:
+// - a fatal or terminating signal (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM, SIGINT)
+// - exit() during the run, e.g. a log cap with --log-cap-policy exit
+// - the watchdog seeing no turns for --watchdog-ms
+// The dump can run inside a signal handler, so it formats with its own helpers and only calls open/write/close.
+
+#define FLIGHT_LINE_MAX 512
+#define FLIGHT_EXTRA_MAX 64                     // room and hunter names fit (MAX_ROOM_NAME, MAX_HUNTER_NAME)
+
+// Compact copy of a LogRecord. Room, device and action point at text that lives for the whole run (room names,
+// static strings); extra is copied, since SWAP formats it on the logger's stack and INIT names a hunter freed at cleanup
+struct FlightRecord {
+    long long timestamp_ns;
+    const char *room;
+    const char *device;
+    const char *action;
+    char extra[FLIGHT_EXTRA_MAX];
+    int entity_id;
+    int boredom;
+    int fear;
+    enum LogEntityType entity_type;
+};
+
+// One thread's ring, rings are never freed: a finished thread hands its ring to the next thread that records
+struct FlightRing {
+    struct FlightRing *next;        // registry link, rings are only ever pushed
+    bool claimed;                   // a live thread is recording into the ring
+    unsigned long head;             // records written since the ring was created, the newest is head - 1
+    struct FlightRecord records[];  // flight_capacity records
+};
+
+static unsigned long flight_capacity = 0;      // records per ring (a power of two), 0 while the recorder is off
+static struct FlightRing *flight_rings = NULL;
+static char flight_dump_path[512];
+static bool flight_armed = false;               // abnormal exits dump until flight_recorder_stop
+static bool flight_dumping = false;             // one dump at a time
+
+static _Thread_local struct FlightRing *flight_ring = NULL;
+
+static const int flight_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM, SIGINT};
+static const char *flight_signal_names[] = {"SIGSEGV", "SIGBUS", "SIGFPE", "SIGILL", "SIGABRT", "SIGTERM", "SIGINT"};
+#define FLIGHT_SIGNAL_COUNT ((int)(sizeof(flight_signals) / sizeof(flight_signals[0])))
+
+// Watchdog state
+static const House *flight_house = NULL;
+static long flight_stall_ms = 0;
+static bool flight_watchdog_running = false;
+static pthread_t flight_watchdog_thread;
+
+// Claims a released ring or creates a new one for the calling thread
+static struct FlightRing *flight_ring_claim(void) {
+
+    for (struct FlightRing *ring = __atomic_load_n(&flight_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+
+        bool expected = false;
+
+        if (!__atomic_load_n(&(ring->claimed), __ATOMIC_RELAXED) &&
+            __atomic_compare_exchange_n(&(ring->claimed), &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return ring;
+        }
+    }
+
+    struct FlightRing *ring = (struct FlightRing*)calloc(1, sizeof(struct FlightRing) + flight_capacity * sizeof(struct FlightRecord));
+    alloc_count_add();
+
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    ring->claimed = true;
+    ring->next = __atomic_load_n(&flight_rings, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&flight_rings, &(ring->next), ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        // ring->next was reloaded with the current head, try again
+    }
+
+    return ring;
+}
+
+/*
+    Purpose:
+        Copies a log record into the calling thread's ring, overwriting the oldest record once the ring is full.
+    Parameters:
+        - record (in): record being logged
+*/
+void flight_record(const struct LogRecord *record) {
+
+    unsigned long capacity = flight_capacity;
+
+    if (capacity == 0) {
+        return;
+    }
+
+    if (flight_ring == NULL) {
+
+        flight_ring = flight_ring_claim();
+
+        if (flight_ring == NULL) {
+            return;
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    struct FlightRing *ring = flight_ring;
+    unsigned long head = ring->head;
+    struct FlightRecord *slot = ring->records + (head & (capacity - 1));
+
+    slot->timestamp_ns = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    slot->entity_type = record->entity_type;
+    slot->entity_id = record->entity_id;
+    slot->room = record->room;
+    slot->device = record->device;
+    slot->boredom = record->boredom;
+    slot->fear = record->fear;
+    slot->action = record->action;
+
+    // Bounded copy, longer text is cut short
+    size_t length = 0;
+    if (record->extra != NULL) {
+        while ((length < FLIGHT_EXTRA_MAX - 1) && (record->extra[length] != '\0')) {
+            length++;
+        }
+        memcpy(slot->extra, record->extra, length);
+    }
+    slot->extra[length] = '\0';
+
+    // Publishes the record to a dump running on another thread
+    __atomic_store_n(&(ring->head), head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+    Purpose:
+        Hands the calling thread's ring over to the next thread that records, its records stay until they are overwritten.
+        Called from log_flush, which every logging thread calls before it exits.
+*/
+void flight_thread_release(void) {
+
+    if (flight_ring == NULL) {
+        return;
+    }
+
+    __atomic_store_n(&(flight_ring->claimed), false, __ATOMIC_RELEASE);
+    flight_ring = NULL;
+}
+
+// ---- Dump formatting, async-signal-safe: fixed buffers and write() only ----
+
+struct FlightLine {
+    char text[FLIGHT_LINE_MAX];
+    size_t used;
+};
+
+static void flight_put_text(struct FlightLine *line, const char *text) {
+
+    for (const char *c = (text != NULL) ? text : ""; (*c != '\0') && (line->used < FLIGHT_LINE_MAX - 1); c++) {
+        line->text[line->used++] = *c;
+    }
+}
+
+static void flight_put_number(struct FlightLine *line, long long value) {
+
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude = (value < 0) ? -(unsigned long long)value : (unsigned long long)value;
+
+    do {
+        digits[count++] = (char)('0' + (magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if ((value < 0) && (line->used < FLIGHT_LINE_MAX - 1)) {
+        line->text[line->used++] = '-';
+    }
+
+    while ((count > 0) && (line->used < FLIGHT_LINE_MAX - 1)) {
+        line->text[line->used++] = digits[--count];
+    }
+}
+
+// Writes the line out (ending it with a newline) and empties it
+static void flight_write_line(int fd, struct FlightLine *line) {
+
+    line->text[line->used++] = '\n';
+
+    size_t written = 0;
+
+    while (written < line->used) {
+
+        ssize_t result = write(fd, line->text + written, line->used - written);
+
+        if (result <= 0) {
+            break;
+        }
+
+        written += (size_t)result;
+    }
+
+    line->used = 0;
+}
+
+// Writes one record in the log file column order
+static void flight_write_record(int fd, struct FlightLine *line, const struct FlightRecord *record) {
+
+    flight_put_number(line, record->timestamp_ns);
+    flight_put_text(line, ",");
+    flight_put_text(line, log_entity_type_to_string(record->entity_type));
+    flight_put_text(line, ",");
+    flight_put_number(line, record->entity_id);
+    flight_put_text(line, ",");
+    flight_put_text(line, record->room);
+    flight_put_text(line, ",");
+    flight_put_text(line, record->device);
+    flight_put_text(line, ",");
+    flight_put_number(line, record->boredom);
+    flight_put_text(line, ",");
+    flight_put_number(line, record->fear);
+    flight_put_text(line, ",");
+    flight_put_text(line, record->action);
+    flight_put_text(line, ",");
+    flight_put_text(line, record->extra);
+
+    flight_write_line(fd, line);
+}
+
+/*
+    Purpose:
+        Writes every ring to the dump file, oldest record first within each ring. Safe to call from a signal handler.
+        Rings are read while their threads may still be recording, so a record being overwritten during the dump can come out torn.
+    Parameters:
+        - reason (in): why the dump was taken, written on the first line
+    Returns:
+        C_OK if the dump was written, C_ERR if the recorder is off, another dump is running or the file could not be opened.
+*/
+int flight_recorder_dump(const char *reason) {
+
+    unsigned long capacity = flight_capacity;
+
+    if ((capacity == 0) || __atomic_exchange_n(&flight_dumping, true, __ATOMIC_ACQUIRE)) {
+        return C_ERR;
+    }
+
+    int fd = open(flight_dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        __atomic_store_n(&flight_dumping, false, __ATOMIC_RELEASE);
+        return C_ERR;
+    }
+
+    struct FlightLine line = {.used = 0};
+
+    flight_put_text(&line, "# flight recorder dump reason=");
+    flight_put_text(&line, reason);
+    flight_write_line(fd, &line);
+
+    flight_put_text(&line, "# clock=monotonic_ns records_per_thread=");
+    flight_put_number(&line, (long long)capacity);
+    flight_write_line(fd, &line);
+
+    flight_put_text(&line, "timestamp,type,id,room,device,boredom,fear,action,extra");
+    flight_write_line(fd, &line);
+
+    int ring_index = 0;
+
+    for (struct FlightRing *ring = __atomic_load_n(&flight_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next, ring_index++) {
+
+        unsigned long head = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+        unsigned long first = (head > capacity) ? head - capacity : 0;
+
+        flight_put_text(&line, "# ring ");
+        flight_put_number(&line, ring_index);
+        flight_put_text(&line, " records=");
+        flight_put_number(&line, (long long)(head - first));
+        flight_put_text(&line, __atomic_load_n(&(ring->claimed), __ATOMIC_RELAXED) ? " thread=running" : " thread=finished");
+        flight_write_line(fd, &line);
+
+        for (unsigned long i = first; i < head; i++) {
+            flight_write_record(fd, &line, ring->records + (i & (capacity - 1)));
+        }
+    }
+
+    close(fd);
+    __atomic_store_n(&flight_dumping, false, __ATOMIC_RELEASE);
+
+    return C_OK;
+}
+
+// Dumps on a fatal or terminating signal, then lets the signal take its default action (SA_RESETHAND restored it)
+static void flight_signal_handler(int signal_number) {
+
+    if (__atomic_load_n(&flight_armed, __ATOMIC_ACQUIRE)) {
+
+        char reason[32] = "signal ";
+        struct FlightLine name = {.used = 0};
+
+        for (int i = 0; i < FLIGHT_SIGNAL_COUNT; i++) {
+            if (flight_signals[i] == signal_number) {
+                flight_put_text(&name, flight_signal_names[i]);
+            }
+        }
+
+        memcpy(reason + 7, name.text, name.used);
+        reason[7 + name.used] = '\0';
+
+        if (flight_recorder_dump(reason)) {
+            static const char message[] = "\nFlight recorder dumped after a signal\n";
+            ssize_t ignored = write(STDERR_FILENO, message, sizeof(message) - 1);
+            (void)ignored;
+        }
+    }
+
+    raise(signal_number);
+}
+
+// Dumps when the process exits before flight_recorder_stop
+static void flight_exit_handler(void) {
+
+    if (__atomic_load_n(&flight_armed, __ATOMIC_ACQUIRE) && flight_recorder_dump("exit")) {
+        fprintf(stderr, "Flight recorder dumped to %s after an exit during the run\n", flight_dump_path);
+    }
+}
+
+/*
+    Purpose:
+        Turns the flight recorder on and installs the signal and exit handlers that dump it.
+    Parameters:
+        - records_per_thread (in): ring size per thread, rounded up to a power of two, 0 leaves the recorder off
+        - dump_path (in): file the rings are dumped to
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int flight_recorder_start(int records_per_thread, const char *dump_path) {
+
+    if (records_per_thread <= 0) {
+        return C_OK;
+    }
+
+    if (strlen(dump_path) >= sizeof(flight_dump_path)) {
+        printf("\nERROR: Flight recorder dump path %s is too long...\n", dump_path);
+        return C_ERR;
+    }
+
+    strcpy(flight_dump_path, dump_path);
+
+    unsigned long capacity = 1;
+    while (capacity < (unsigned long)records_per_thread) {
+        capacity <<= 1;
+    }
+
+    flight_capacity = capacity;
+    __atomic_store_n(&flight_armed, true, __ATOMIC_RELEASE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flight_signal_handler;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    for (int i = 0; i < FLIGHT_SIGNAL_COUNT; i++) {
+        sigaction(flight_signals[i], &action, NULL);
+    }
+
+    atexit(flight_exit_handler);
+
+    return C_OK;
+}
+
+// Total turns taken so far, read without locks like the metrics server does
+static long flight_turn_count(const House *house) {
+
+    long turns = __atomic_load_n(&(house->ghost.turn_count), __ATOMIC_RELAXED);
+
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+        turns += __atomic_load_n(&(house->hunter_arr.hunters[i]->turn_count), __ATOMIC_RELAXED);
+    }
+
+    return turns;
+}
+
+// Dumps once per stall when no entity took a turn for flight_stall_ms, re-arms when turns resume
+static void *flight_watchdog(void *arg) {
+
+    (void)arg;
+
+    long last_turns = flight_turn_count(flight_house);
+    bool tripped = false;
+    long slept_ms = 0;
+
+    while (__atomic_load_n(&flight_watchdog_running, __ATOMIC_ACQUIRE)) {
+
+        // Sleeps in short steps so flight_recorder_stop does not wait out a long stall interval
+        struct timespec step = {0, 10 * 1000 * 1000};
+        nanosleep(&step, NULL);
+        slept_ms += 10;
+
+        if (slept_ms < flight_stall_ms) {
+            continue;
+        }
+
+        slept_ms = 0;
+        long turns = flight_turn_count(flight_house);
+
+        if (turns != last_turns) {
+            last_turns = turns;
+            tripped = false;
+        }
+        else if (!tripped) {
+            tripped = true;
+
+            if (flight_recorder_dump("watchdog")) {
+                fprintf(stderr, "Watchdog: no turns for %ld ms, flight recorder dumped to %s\n", flight_stall_ms, flight_dump_path);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+    Purpose:
+        Starts the watchdog thread that dumps the flight recorder when the simulation stops taking turns.
+    Parameters:
+        - house (in): house being simulated, must outlive flight_recorder_stop
+        - stall_ms (in): milliseconds without a turn that count as a stall, 0 for no watchdog
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int flight_watchdog_start(const House *house, long stall_ms) {
+
+    if ((stall_ms <= 0) || (flight_capacity == 0)) {
+        return C_OK;
+    }
+
+    flight_house = house;
+    flight_stall_ms = stall_ms;
+    flight_watchdog_running = true;
+
+    if (pthread_create(&flight_watchdog_thread, NULL, flight_watchdog, NULL) != 0) {
+        printf("\nERROR: Watchdog thread could not be started...\n");
+        flight_watchdog_running = false;
+        return C_ERR;
+    }
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Stops the watchdog and disarms the exit and signal dumps once the run has ended normally.
+        The rings stay allocated until the process exits.
+*/
+void flight_recorder_stop(void) {
+
+    if (flight_watchdog_running) {
+        __atomic_store_n(&flight_watchdog_running, false, __ATOMIC_RELEASE);
+        pthread_join(flight_watchdog_thread, NULL);
+    }
+
+    __atomic_store_n(&flight_armed, false, __ATOMIC_RELEASE);
+}
@@ -26,6 +26,9 @@ int ghost_init(Ghost *ghost) {
     ghost->running = true;
     ghost->exited = false;
     ghost->room = NULL;
+    ghost->rand_seed = rand_seed_for_entity(ghost->id);
+    ghost->turn_count = 0;
+    ghost->turn_latency = NULL;
 
     return C_OK;
 }
@@ -42,7 +45,7 @@ enum GhostType ghost_choose_rand_ghosttype() {
     const enum GhostType* ghost_types = NULL;
     int ghost_count = get_all_ghost_types(&ghost_types);
 
-    int rand_index = rand_int_threadsafe(0, ghost_count);       // generates random integer to choose ghost at that index
+    int rand_index = decision_rand(DEC_GHOST_TYPE, 0, ghost_count);       // generates random integer to choose ghost at that index
 
     return ghost_types[rand_index];
 }
@@ -59,12 +62,20 @@ void *ghost_thread(void *arg) {
     // Types casts the provided argument appropriately
     Ghost *ghost = (Ghost*)arg;
 
+    // Ghost draws all of its decisions from its own PRNG state
+    rand_bind_seed(&(ghost->rand_seed));
+    decision_bind_entity(ghost->id);
+
     // Ghost behaviour loop
     while (ghost->running) {
         
         ghost_take_turn(ghost);
     }
 
+    log_flush();            // writes out records still held by buffered logging
+    latency_thread_flush();
+    trace_thread_flush();
+
     return 0;
 }
 
@@ -77,18 +88,25 @@ void *ghost_thread(void *arg) {
 */
 void ghost_take_turn(Ghost *ghost) {
 
+    long long turn_start = latency_turn_begin();       // times the turn when run with --latency
+    long long trace_start = trace_begin();             // and for the trace when run with --trace-events
+    const char *turn_room = ghost->room->name;
+
+    __atomic_store_n(&(ghost->turn_count), ghost->turn_count + 1, __ATOMIC_RELAXED);       // read by the metrics thread
+
     // Update ghost's stats
     bool can_move = ghost_stats_update(ghost);      // stores return value indicating if ghost can move
 
     // Checks if ghost should exit, ghost exits if true
     bool ghost_exited = ghost_condition_check(ghost);
 
-    if (ghost_exited) {
-        return;             // ends turn if ghost exited simulation
+    // Makes ghost take an action if it is still in the house
+    if (!ghost_exited) {
+        ghost_take_action(ghost, can_move);
     }
 
-    // Makes ghost take an action
-    ghost_take_action(ghost, can_move);
+    latency_turn_end(&(ghost->turn_latency), turn_start);
+    trace_turn(ghost->id, turn_room, trace_start);
 }
 
 // GHOST STATS FUNCTIONS
@@ -102,14 +120,16 @@ void ghost_take_turn(Ghost *ghost) {
 */
 bool ghost_stats_update(Ghost *ghost) {
 
+    int boredom_before = ghost->boredom;           // for invariant checks
+
     // Waits for room hunter occupancy lock
-    sem_wait(&(ghost->room->hunter_occupancy_lock));
+    LOCK_WAIT(&(ghost->room->hunter_occupancy_lock));
 
     // Checks if there are hunters currently in room with ghost
     bool hunters_in_room = ghost_check_hunters(ghost->room);      
     
     // Releases room hunter occupancy lock
-    sem_post(&(ghost->room->hunter_occupancy_lock));
+    LOCK_POST(&(ghost->room->hunter_occupancy_lock));
 
     if (hunters_in_room) {
         ghost_boredom_reset(ghost);  
@@ -118,6 +138,8 @@ bool ghost_stats_update(Ghost *ghost) {
         ghost_boredom_inc(ghost);
     }
 
+    CHECK_BOREDOM(ghost->id, boredom_before, ghost->boredom, hunters_in_room);
+
     return !hunters_in_room;
 }
 
@@ -191,18 +213,20 @@ void ghost_exit(Ghost *ghost) {
     Room *room = ghost->room;                                   // stores pointer to room ghost is exiting from for logs
 
     // Waits for room ghost presence lock
-    sem_wait(&(room->ghost_presence_lock));
+    LOCK_WAIT(&(room->ghost_presence_lock));
 
     room_remove_ghost(ghost->room, ghost);                      // removes ghost from room
 
     log_ghost_exit(ghost->id, ghost->boredom, room->name);       // logs ghost exiting the simulation
 
     // Releases room ghost presence lock
-    sem_post(&(room->ghost_presence_lock));
+    LOCK_POST(&(room->ghost_presence_lock));
 
     // Updates ghost simulation stat fields
-    ghost->running = false;
-    ghost->exited = true;
+    __atomic_store_n(&(ghost->running), false, __ATOMIC_RELAXED);
+    __atomic_store_n(&(ghost->exited), true, __ATOMIC_RELAXED);
+
+    latency_mark_action(LAT_EXIT);
 }
 
 // BEHAVIOUR FUNCTIONS
@@ -225,10 +249,10 @@ int ghost_take_action(Ghost *ghost, bool ghost_can_move) {
 
     // Checks if ghost can move to determine range of actions ghost can take
     if (ghost_can_move) {
-        rand_index = rand_int_threadsafe(0, 3);
+        rand_index = decision_rand(DEC_GHOST_ACTION, 0, 3);
     }
     else {
-        rand_index = rand_int_threadsafe(0, 2);
+        rand_index = decision_rand(DEC_GHOST_ACTION, 0, 2);
     }
 
     // Calls randomly chosen ghost action function
@@ -248,6 +272,8 @@ void ghost_idle(Ghost *ghost) {
     // Logs ghost's action
     log_ghost_idle(ghost->id, ghost->boredom, ghost->room->name);
 
+    latency_mark_action(LAT_IDLE);
+
     return; 
 }
 
@@ -264,11 +290,13 @@ void ghost_haunt(Ghost *ghost) {
     ghost_to_evidence_types(ghost, ghost_evidence_types);                   // careful, not passing const ghost, may need to remove from function signatures
 
     // Randomly choose evidence for ghost to leave behind in room
-    int rand_index = rand_int_threadsafe(0, 3);                             // generates random integer to choose evidence type at that index
+    int rand_index = decision_rand(DEC_HAUNT_EVIDENCE, 0, 3);                 // generates random integer to choose evidence type at that index
     enum EvidenceType evidence_piece = ghost_evidence_types[rand_index];
 
     // Waits for room evidence lock
-    sem_wait(&(ghost->room->evidence_lock));
+    LOCK_WAIT(&(ghost->room->evidence_lock));
+
+    CHECK_EVIDENCE_DROP(ghost, evidence_piece);
 
     // Adds evidence to room
     room_evidence_add(ghost->room, evidence_piece);
@@ -277,7 +305,9 @@ void ghost_haunt(Ghost *ghost) {
     log_ghost_evidence(ghost->id, ghost->boredom, ghost->room->name, evidence_piece);
 
     // Releases room evidence lock
-    sem_post(&(ghost->room->evidence_lock));
+    LOCK_POST(&(ghost->room->evidence_lock));
+
+    latency_mark_action(LAT_HAUNT);
 
     return;
 }
@@ -292,30 +322,37 @@ void ghost_move(Ghost *ghost) {
 
     Room *current_room = ghost->room;                                   // stores pointer to ghost's current room for logs
     Room *next_room = room_choose_rand_connection(ghost->room);         // gets randomly chosen connected room for ghost to move to
+    long long move_start = trace_begin();
+
+    latency_mark_action(LAT_MOVE);
 
     // will need to be careful about this function with multi-threading later on...need to follow entity room locking requirement
 
     // Waits for room ghost prescence locks (locks in order of memory addresses)
     if (current_room < next_room) {
 
-        sem_wait(&(current_room->ghost_presence_lock));
-        sem_wait(&(next_room->ghost_presence_lock));
+        LOCK_WAIT(&(current_room->ghost_presence_lock));
+        LOCK_WAIT(&(next_room->ghost_presence_lock));
     }
     else {
-        sem_wait(&(next_room->ghost_presence_lock));
-        sem_wait(&(current_room->ghost_presence_lock));
+        LOCK_WAIT(&(next_room->ghost_presence_lock));
+        LOCK_WAIT(&(current_room->ghost_presence_lock));
     }
 
     // Removes ghost from current room and adds ghost to next room
     room_remove_ghost(ghost->room, ghost);
     room_add_ghost(next_room, ghost);
 
+    CHECK_GHOST_MOVE(ghost, current_room, next_room);
+
     // Logs ghost's actions
     log_ghost_move(ghost->id, ghost->boredom, current_room->name, next_room->name);
 
     // Releases room ghost prescence locks 
-    sem_post(&(current_room->ghost_presence_lock));
-    sem_post(&(next_room->ghost_presence_lock));
+    LOCK_POST(&(current_room->ghost_presence_lock));
+    LOCK_POST(&(next_room->ghost_presence_lock));
+
+    trace_move(ghost->id, current_room->name, next_room->name, move_start);
 }
 
 // TESTING FUNCTIONS
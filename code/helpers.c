@@ -1,3 +1,4 @@
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -196,6 +197,38 @@ int get_all_ghost_types(const enum GhostType** list) {
 }
 
 // ---- Thread-safe random number generation ----
+
+// Base seed for the whole run, 0 means seed from the clock
+static unsigned rand_base_seed = 0;
+
+// Entity state the calling thread currently draws from, NULL falls back to the thread's own seed
+static _Thread_local unsigned* rand_bound_seed = NULL;
+
+void rand_set_base_seed(unsigned seed) {
+    rand_base_seed = seed;
+}
+
+unsigned rand_get_base_seed(void) {
+    return rand_base_seed;
+}
+
+unsigned rand_seed_for_entity(int entity_id) {
+
+    unsigned seed = rand_base_seed ? rand_base_seed : (unsigned)time(NULL);
+
+    // Mixes the entity id in so every entity gets its own stream
+    seed ^= (unsigned)entity_id * 0x9E3779B9u;
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6Bu;
+    seed ^= seed >> 13;
+
+    return seed ? seed : 0xA5A5A5A5u;
+}
+
+void rand_bind_seed(unsigned* seed) {
+    rand_bound_seed = seed;
+}
+
 int rand_int_threadsafe(int lower_inclusive, int upper_exclusive) {
 
     static _Thread_local unsigned seed = 0;
@@ -204,18 +237,39 @@ int rand_int_threadsafe(int lower_inclusive, int upper_exclusive) {
         return lower_inclusive;
     }
 
-    if (seed == 0) {
-        seed = (unsigned)time(NULL) ^ (unsigned)(uintptr_t)pthread_self();
+    unsigned* state = rand_bound_seed;
+
+    if (state == NULL) {
         if (seed == 0) {
-            seed = 0xA5A5A5A5u;
+            if (rand_base_seed) {
+                seed = rand_base_seed;
+            } else {
+                seed = (unsigned)time(NULL) ^ (unsigned)(uintptr_t)pthread_self();
+            }
+            if (seed == 0) {
+                seed = 0xA5A5A5A5u;
+            }
         }
+        state = &seed;
     }
 
     unsigned span = (unsigned)(upper_exclusive - lower_inclusive);
-    unsigned value = (unsigned)rand_r(&seed) % span;
+    unsigned value = (unsigned)rand_r(state) % span;
     return lower_inclusive + (int)value;
 }
 
+// ---- Allocation counting (reported by --stats for the benchmark comparator) ----
+
+static long alloc_count = 0;
+
+void alloc_count_add(void) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+}
+
+long alloc_count_get(void) {
+    return __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+}
+
 // ---- Evidence helpers ----
 bool evidence_is_valid_ghost(EvidenceByte mask) {
 
@@ -248,26 +302,12 @@ bool evidence_has_three_unique(EvidenceByte mask) {
     return false;        
 }
 
-// ---- Logging (Writes CSV logs, DO NOT MODIFY the file outputs: timestamp,type,id,room,device,boredom,fear,action,extra) ----
-
-// These enums are just for logging purposes, not needed elsewhere
-enum LogEntityType {
-    LOG_ENTITY_HUNTER = 0,
-    LOG_ENTITY_GHOST = 1
-};
-
-struct LogRecord {
-    enum LogEntityType entity_type;
-    int                entity_id;
-    const char*        room;
-    const char*        device;
-    int                boredom;
-    int                fear;
-    const char*        action;
-    const char*        extra;
-};
+// ---- Logging (Writes CSV logs: timestamp,type,id,room,device,boredom,fear,action,extra) ----
+// Timestamps are CLOCK_MONOTONIC nanoseconds, and each file starts with a "# clock=monotonic_ns epoch_offset_ns=N" line.
+// With --log-timestamps ms they are wall-clock milliseconds with no header line, the original format.
+// validate_logs.py reads both, so keep the columns in this order.
 
-static const char* log_entity_type_to_string(enum LogEntityType type) {
+const char* log_entity_type_to_string(enum LogEntityType type) {
     switch (type) {
         case LOG_ENTITY_HUNTER:
             return "hunter";
@@ -278,26 +318,894 @@ static const char* log_entity_type_to_string(enum LogEntityType type) {
     }
 }
 
-static void write_log_record(const struct LogRecord* record) {
-    static _Thread_local unsigned line_count = 0;
+#define LOG_DIRECTORY_MAX 448
+#define LOG_PATH_MAX (LOG_DIRECTORY_MAX + 64)
+
+// Pause after each record so successive records get distinct millisecond timestamps
+static bool log_record_pause = true;
+
+// Directory log files are written to, empty for the current directory
+static char log_directory[LOG_DIRECTORY_MAX] = "";
+
+// Legacy wall-clock millisecond timestamps instead of CLOCK_MONOTONIC nanoseconds
+static bool log_ms_timestamps = false;
+
+// Writes log_<id>.csv files, turned off for runs that only need the results (and live invariant checks)
+static bool log_file_output = true;
+
+// Writes each entity's records to its own log file (or the --log-mmap segments), off when only the timeline is wanted
+static bool log_entity_output = true;
+
+// Collects records in a per-thread buffer and appends them to the log files in batches
+static bool log_buffered = false;
+
+// Console output level of the log_* functions, independent of the log files
+static enum LogVerbosity log_verbosity = LOG_VERBOSITY_FULL;
+
+#define LOG_CONSOLE_BYTES (16 * 1024)
+#define LOG_CONSOLE_FLUSH_BYTES (LOG_CONSOLE_BYTES - LOG_LINE_MAX)
+
+// At full verbosity console lines are collected per thread and written to stdout in batches, so threads rarely contend on stdout's lock
+static _Thread_local char* log_console_buffer = NULL;
+static _Thread_local size_t log_console_used = 0;
+
+// Records held in per-thread log buffers and not yet written out, read by the live metrics server
+static long log_queued = 0;
+
+// Called after each record is written, NULL unless trace event export is on
+static LogWriteHook log_write_hook = NULL;
+
+#define LOG_LINE_MAX 512
+#define LOG_BUFFER_BYTES (64 * 1024)
+#define LOG_BUFFER_INITIAL_BYTES 4096
+
+struct LogBufferEntry {
+    int      entity_id;
+    unsigned segment;           // log file segment of the entity the line goes to
+    unsigned offset;            // start of the line in the buffer data
+    unsigned length;
+};
+
+// Logged actions, bit and index of the --log-filter masks and sampling counts
+enum LogAction {
+    LOG_ACTION_INIT,
+    LOG_ACTION_MOVE,
+    LOG_ACTION_EVIDENCE,
+    LOG_ACTION_SWAP,
+    LOG_ACTION_EXIT,
+    LOG_ACTION_RETURN_START,
+    LOG_ACTION_RETURN_COMPLETE,
+    LOG_ACTION_IDLE,
+    LOG_ACTION_COUNT
+};
+
+// ---- Log volume caps and rotation ----
+
+#define LOG_ENTITY_SLOTS (1 << 15)     // power of two, entities past this many are only held to the total cap
+
+// Per-entity volume, an entity only ever logs from one thread at a time so only the slot claim needs to be atomic
+struct LogEntityVolume {
+    long long key;              // entity ID + LOG_ENTITY_KEY_BIAS, 0 for a free slot
+    long      lines;            // lines written (or queued) so far
+    long      segment_lines;    // lines in the current segment
+    long      segment_bytes;    // bytes in the current segment
+    unsigned  segment;          // current segment, 0 is log_<id>.csv and n is log_<id>.<n>.csv
+    bool      capped;           // reached the per-entity cap, later lines are dropped
+    unsigned  sample_counts[LOG_ACTION_COUNT];     // --log-filter sampling counts of the entity's records
+};
+
+#define LOG_ENTITY_KEY_BIAS (1LL << 32)
+
+static long log_max_entity_lines = 100000;     // per-entity cap, 0 for none
+static long log_max_total_lines = 0;           // cap on all entities together, 0 for none
+static bool log_exit_on_cap = false;           // old behaviour: exit(1) when a cap is reached
+static long log_rotate_lines = 0;              // starts a new segment after this many lines, 0 for none
+static long log_rotate_bytes = 0;              // or after this many bytes, 0 for none
+
+static struct LogEntityVolume log_volumes[LOG_ENTITY_SLOTS];
+static long log_total_lines = 0;
+static long log_dropped_lines = 0;
+static int log_capped_entities = 0;
+static bool log_total_capped = false;
+
+struct LogBuffer {
+    char*                  data;
+    size_t                 used;
+    size_t                 capacity;
+    struct LogBufferEntry* entries;
+    int                    count;
+    int                    entry_capacity;
+};
+
+// Allocated on the thread's first buffered record, so threads that never log cost nothing
+static _Thread_local struct LogBuffer log_buffer = {0};
+
+void log_set_record_pause(bool enabled) {
+    log_record_pause = enabled;
+}
+
+void log_set_limits(long max_entity_lines, long max_total_lines, bool exit_on_cap) {
+    log_max_entity_lines = max_entity_lines;
+    log_max_total_lines = max_total_lines;
+    log_exit_on_cap = exit_on_cap;
+}
+
+void log_set_rotation(long segment_lines, long segment_bytes) {
+    log_rotate_lines = segment_lines;
+    log_rotate_bytes = segment_bytes;
+}
+
+long log_dropped_line_count(void) {
+    return __atomic_load_n(&log_dropped_lines, __ATOMIC_RELAXED);
+}
+
+int log_capped_entity_count(void) {
+    return __atomic_load_n(&log_capped_entities, __ATOMIC_RELAXED);
+}
+
+bool log_total_cap_reached(void) {
+    return __atomic_load_n(&log_total_capped, __ATOMIC_RELAXED);
+}
+
+// Gets the volume slot of an entity, claiming a free one on its first record, NULL when the table is full
+static struct LogEntityVolume* log_entity_volume(int entity_id) {
+
+    long long key = (long long)entity_id + LOG_ENTITY_KEY_BIAS;
+    size_t index = (size_t)(((unsigned long long)key * 0x9E3779B97F4A7C15ull) >> 49) & (LOG_ENTITY_SLOTS - 1);
+
+    for (int probe = 0; probe < LOG_ENTITY_SLOTS; probe++) {
+
+        struct LogEntityVolume* volume = log_volumes + ((index + probe) & (LOG_ENTITY_SLOTS - 1));
+        long long current = __atomic_load_n(&volume->key, __ATOMIC_ACQUIRE);
+
+        if (current == key) {
+            return volume;
+        }
+
+        if ((current == 0) && __atomic_compare_exchange_n(&volume->key, &current, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return volume;
+        }
+
+        // Another thread may have claimed this slot for the same entity
+        if (current == key) {
+            return volume;
+        }
+    }
+
+    return NULL;
+}
+
+// Stops the run like the old hard cap did, for --log-cap-policy exit
+static void log_cap_exit(const char* reason, int entity_id);
+
+// Checks the caps before a record is written, counts the record as dropped when a cap was reached
+static bool log_within_caps(int entity_id, struct LogEntityVolume* volume) {
+
+    if ((volume != NULL) && volume->capped) {
+        __atomic_add_fetch(&log_dropped_lines, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if ((log_max_entity_lines > 0) && (volume != NULL) && (volume->lines >= log_max_entity_lines)) {
+
+        if (log_exit_on_cap) {
+            log_cap_exit("entity", entity_id);
+        }
+
+        volume->capped = true;
+        __atomic_add_fetch(&log_capped_entities, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&log_dropped_lines, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    // The shared counter is only touched when there is a total cap to enforce
+    if ((log_max_total_lines > 0) && (__atomic_add_fetch(&log_total_lines, 1, __ATOMIC_RELAXED) > log_max_total_lines)) {
+
+        if (log_exit_on_cap) {
+            log_cap_exit("total", entity_id);
+        }
+
+        __atomic_store_n(&log_total_capped, true, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&log_dropped_lines, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    return true;
+}
+
+// ---- Log filtering and sampling (--log-filter) ----
+
+static const char* const log_action_names[LOG_ACTION_COUNT] = {
+    "INIT", "MOVE", "EVIDENCE", "SWAP", "EXIT", "RETURN_START", "RETURN_COMPLETE", "IDLE"
+};
+
+#define LOG_FILTER_IDS_MAX 64
+#define LOG_FILTER_SPEC_MAX 512
+
+// Checked by write_log_record right after the flight recorder keeps the record; dropped records return before the
+// caps, timestamp and log line, only the small extra text some log_* functions build for the flight recorder is formatted
+static bool log_filter_active = false;
+static unsigned log_filter_actions = (1u << LOG_ACTION_COUNT) - 1;     // bit per action kept
+static unsigned log_filter_types = (1u << LOG_ENTITY_HUNTER) | (1u << LOG_ENTITY_GHOST);
+static int log_filter_ids[LOG_FILTER_IDS_MAX];                          // entities kept, empty for every entity
+static int log_filter_id_count = 0;
+static unsigned log_sample_every[LOG_ACTION_COUNT];                     // 1 in N records kept, 0 or 1 keeps all
+
+// Sampling counts of entities past the volume table's size, per thread since those have no slot of their own
+static _Thread_local unsigned log_sample_counts[LOG_ACTION_COUNT];
+
+// Actions matching a name, or every action starting with the prefix before a trailing '*' (RETURN_*), 0 for none
+static unsigned log_action_mask(const char* name) {
+
+    size_t length = strlen(name);
+    bool prefix = (length > 0) && (name[length - 1] == '*');
+    unsigned mask = 0;
+
+    for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+        if (prefix ? (strncmp(log_action_names[action], name, length - 1) == 0) : (strcmp(log_action_names[action], name) == 0)) {
+            mask |= 1u << action;
+        }
+    }
+
+    return mask;
+}
+
+// Parses the comma-separated values of one filter clause, values is modified in place
+static bool log_filter_clause(const char* key, char* values) {
+
+    bool actions = (strcmp(key, "actions") == 0);
+    bool entities = (strcmp(key, "entities") == 0);
+    bool sample = (strcmp(key, "sample") == 0);
+
+    if (!actions && !entities && !sample) {
+        printf("ERROR: --log-filter clause '%s' must be actions=, entities= or sample=\n", key);
+        return false;
+    }
+
+    if (actions) {
+        log_filter_actions = 0;
+    }
+    if (entities) {
+        log_filter_types = 0;
+    }
+
+    char* save = NULL;
+    for (char* term = strtok_r(values, ",", &save); term != NULL; term = strtok_r(NULL, ",", &save)) {
+
+        if (actions) {
+            unsigned mask = log_action_mask(term);
+            if (mask == 0) {
+                printf("ERROR: --log-filter has unknown action '%s'\n", term);
+                return false;
+            }
+            log_filter_actions |= mask;
+        }
+        else if (entities) {
+            char* end = NULL;
+            long id = strtol(term, &end, 10);
+
+            if (strcmp(term, "hunter") == 0) {
+                log_filter_types |= 1u << LOG_ENTITY_HUNTER;
+            }
+            else if (strcmp(term, "ghost") == 0) {
+                log_filter_types |= 1u << LOG_ENTITY_GHOST;
+            }
+            else if ((end != term) && (*end == '\0') && (log_filter_id_count < LOG_FILTER_IDS_MAX)) {
+                log_filter_ids[log_filter_id_count++] = (int)id;
+            }
+            else {
+                printf("ERROR: --log-filter entities must be hunter, ghost or at most %d entity IDs, not '%s'\n", LOG_FILTER_IDS_MAX, term);
+                return false;
+            }
+        }
+        else {
+            // ACTION:N keeps one record in N
+            char* colon = strchr(term, ':');
+            long every = (colon != NULL) ? strtol(colon + 1, NULL, 10) : 0;
+
+            if (colon != NULL) {
+                *colon = '\0';
+            }
+
+            unsigned mask = log_action_mask(term);
+            if ((mask == 0) || (every < 1) || (every > 1000000000L)) {
+                if (colon != NULL) {
+                    *colon = ':';
+                }
+                printf("ERROR: --log-filter samples are ACTION:N with N at least 1, not '%s'\n", term);
+                return false;
+            }
+
+            for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+                if (mask & (1u << action)) {
+                    log_sample_every[action] = (unsigned)every;
+                }
+            }
+        }
+    }
+
+    // Entity IDs alone keep those entities whatever their type
+    if (entities && (log_filter_types == 0) && (log_filter_id_count == 0)) {
+        printf("ERROR: --log-filter entities= needs at least one entity\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool log_set_filter(const char* spec) {
+
+    char copy[LOG_FILTER_SPEC_MAX];
+
+    if (strlen(spec) >= sizeof(copy)) {
+        printf("ERROR: --log-filter spec is too long\n");
+        return false;
+    }
+
+    strcpy(copy, spec);
+
+    char* save = NULL;
+    for (char* clause = strtok_r(copy, ";", &save); clause != NULL; clause = strtok_r(NULL, ";", &save)) {
+
+        char* equals = strchr(clause, '=');
+
+        if (equals == NULL) {
+            printf("ERROR: --log-filter clause '%s' must be key=values\n", clause);
+            return false;
+        }
+
+        *equals = '\0';
+
+        if (!log_filter_clause(clause, equals + 1)) {
+            return false;
+        }
+    }
+
+    log_filter_active = true;
+    return true;
+}
+
+// Decides whether a record is written to the log files, sampling counts only the records the filter lets through
+static inline bool log_filter_keep(enum LogAction action, enum LogEntityType type, int entity_id) {
+
+    if (!log_filter_active) {
+        return true;
+    }
+
+    if (!(log_filter_actions & (1u << action))) {
+        return false;
+    }
+
+    if (!(log_filter_types & (1u << type))) {
+
+        bool listed = false;
+        for (int i = 0; i < log_filter_id_count; i++) {
+            if (log_filter_ids[i] == entity_id) {
+                listed = true;
+                break;
+            }
+        }
+
+        if (!listed) {
+            return false;
+        }
+    }
+
+    unsigned every = log_sample_every[action];
+    if (every <= 1) {
+        return true;
+    }
+
+    // Counted per entity, so the engines that run many entities on one thread keep 1 in N of each entity's records
+    struct LogEntityVolume* volume = log_entity_volume(entity_id);
+    unsigned* counts = (volume != NULL) ? volume->sample_counts : log_sample_counts;
+
+    return (counts[action]++ % every) == 0;
+}
+
+int log_write_filter_note(void) {
+
+    if (!log_filter_active) {
+        return C_OK;
+    }
+
+    char path[LOG_PATH_MAX];
+    snprintf(path, sizeof(path), "%s%slog_filter.txt", log_directory, (log_directory[0] != '\0') ? "/" : "");
+
+    FILE* file = fopen(path, "w");
+
+    if (file == NULL) {
+        printf("\nERROR: Log filter note %s could not be written...\n", path);
+        return C_ERR;
+    }
+
+    // Actions with some records missing, so validators skip the checks that need every one of them
+    fputs("# Records left out by --log-filter\nfiltered_actions=", file);
+    const char* separator = "";
+    for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+        if (!(log_filter_actions & (1u << action))) {
+            fprintf(file, "%s%s", separator, log_action_names[action]);
+            separator = ",";
+        }
+    }
+
+    fputs("\nsampled_actions=", file);
+    separator = "";
+    for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+        if ((log_filter_actions & (1u << action)) && (log_sample_every[action] > 1)) {
+            fprintf(file, "%s%s:%u", separator, log_action_names[action], log_sample_every[action]);
+            separator = ",";
+        }
+    }
+
+    fputs("\nentities=", file);
+    separator = "";
+    if (log_filter_types & (1u << LOG_ENTITY_HUNTER)) {
+        fputs("hunter", file);
+        separator = ",";
+    }
+    if (log_filter_types & (1u << LOG_ENTITY_GHOST)) {
+        fprintf(file, "%sghost", separator);
+        separator = ",";
+    }
+    for (int i = 0; i < log_filter_id_count; i++) {
+        fprintf(file, "%s%d", separator, log_filter_ids[i]);
+        separator = ",";
+    }
+    fputs("\n", file);
+
+    fclose(file);
+    return C_OK;
+}
+
+// ---- Sparse log index (--log-index) ----
+
+// Writes an index entry every this many records of a log file, 0 for no index
+static long log_index_every = 0;
+
+// Indexes the per-entity log files too, off when they are compressed (gzip streams cannot be seeked into)
+static bool log_index_entity_files = false;
+
+void log_set_index(long every, bool entity_files) {
+    log_index_every = every;
+    log_index_entity_files = entity_files && (every > 0);
+}
+
+long log_index_interval(void) {
+    return log_index_every;
+}
+
+FILE* log_index_open(const char* log_path) {
+
+    char path[LOG_PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s.idx", log_path);
+
+    FILE* index = fopen(path, "a");
+
+    if ((index != NULL) && (ftell(index) == 0)) {
+        fprintf(index, "# index every=%ld columns=record,timestamp,offset\n", log_index_every);
+    }
+
+    return index;
+}
+
+// Adds an index entry for every log_index_every-th line of an entity's log segment. The line's offset follows from
+// the bytes counted in the segment so far, so it is known even before a buffered line reaches the file.
+static void log_index_entity(const struct LogEntityVolume* volume, int entity_id, unsigned segment, long long timestamp, size_t length) {
+
+    long record = volume->segment_lines - 1;
+
+    if ((record == 0) || ((record % log_index_every) != 0)) {
+        return;
+    }
+
+    char header[128];
+    int header_length = log_file_header(header, sizeof(header));
+    long offset = ((header_length > 0) ? header_length : 0) + volume->segment_bytes - (long)length;
+
+    char log_path[LOG_PATH_MAX];
+    if (log_file_path(entity_id, segment, log_path, sizeof(log_path)) < 0) {
+        return;
+    }
+
+    FILE* index = log_index_open(log_path);
+
+    if (index != NULL) {
+        fprintf(index, "%ld,%lld,%ld\n", record, timestamp, offset);
+        fclose(index);
+    }
+}
+
+// Counts a line against its entity and picks the segment it goes to, rotating when the current segment is full
+static unsigned log_assign_segment(struct LogEntityVolume* volume, size_t length) {
+
+    if (volume == NULL) {
+        return 0;
+    }
+
+    bool full = ((log_rotate_lines > 0) && (volume->segment_lines >= log_rotate_lines)) ||
+                ((log_rotate_bytes > 0) && (volume->segment_lines > 0) && (volume->segment_bytes + (long)length > log_rotate_bytes));
+
+    if (full) {
+        volume->segment++;
+        volume->segment_lines = 0;
+        volume->segment_bytes = 0;
+    }
+
+    volume->lines++;
+    volume->segment_lines++;
+    volume->segment_bytes += (long)length;
+
+    return volume->segment;
+}
+
+const char* log_get_directory(void) {
+    return log_directory;
+}
+
+bool log_set_directory(const char* directory) {
+
+    if (strlen(directory) >= sizeof(log_directory)) {
+        return false;
+    }
+
+    strcpy(log_directory, directory);
+    return true;
+}
+
+void log_set_ms_timestamps(bool enabled) {
+    log_ms_timestamps = enabled;
+}
+
+void log_set_entity_output(bool enabled) {
+    log_entity_output = enabled;
+}
+
+void log_set_file_output(bool enabled) {
+    log_file_output = enabled;
+}
+
+void log_set_verbosity(enum LogVerbosity verbosity) {
+    log_verbosity = verbosity;
+}
+
+bool log_parse_verbosity(const char* text, enum LogVerbosity* verbosity) {
+
+    if (strcmp(text, "silent") == 0) {
+        *verbosity = LOG_VERBOSITY_SILENT;
+    } else if (strcmp(text, "summary") == 0) {
+        *verbosity = LOG_VERBOSITY_SUMMARY;
+    } else if (strcmp(text, "full") == 0) {
+        *verbosity = LOG_VERBOSITY_FULL;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void log_console_flush(void) {
+
+    if (log_console_used > 0) {
+        fwrite(log_console_buffer, 1, log_console_used, stdout);
+        fflush(stdout);
+        log_console_used = 0;
+    }
+}
+
+// Prints a console line at the given level, dropped when the verbosity is lower
+// Only full verbosity batches lines in the calling thread's buffer, the sparse summary lines are printed as they happen
+static void log_console(enum LogVerbosity level, const char* format, ...) {
+
+    if (level > log_verbosity) {
+        return;
+    }
 
-    if (line_count >= 100000) {
-        fprintf(stderr, "Log capped for entity %d; stopping to prevent infinite growth.\n", record->entity_id);
-        exit(1);
+    if ((log_verbosity == LOG_VERBOSITY_FULL) && (log_console_buffer == NULL)) {
+        log_console_buffer = (char*)malloc(LOG_CONSOLE_BYTES);
+        alloc_count_add();
     }
 
-    char filename[64];
-    snprintf(filename, sizeof(filename), "log_%d.csv", record->entity_id);
+    va_list args;
+    va_start(args, format);
+
+    // Also prints straight away when the buffer cannot be allocated
+    if (log_console_buffer == NULL) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    int length = vsnprintf(log_console_buffer + log_console_used, LOG_LINE_MAX, format, args);
+    va_end(args);
+
+    if (length > 0) {
+        log_console_used += ((size_t)length < LOG_LINE_MAX) ? (size_t)length : LOG_LINE_MAX - 1;
+    }
+
+    if (log_console_used >= LOG_CONSOLE_FLUSH_BYTES) {
+        fwrite(log_console_buffer, 1, log_console_used, stdout);
+        log_console_used = 0;
+    }
+}
+
+void log_set_write_hook(LogWriteHook hook) {
+    log_write_hook = hook;
+}
+
+void log_set_buffered(bool enabled) {
+    log_buffered = enabled;
+}
+
+// Wall-clock time of CLOCK_MONOTONIC zero, measured once so nanosecond timestamps can be turned back into dates
+static long long log_epoch_offset_ns = 0;
+static pthread_once_t log_epoch_once = PTHREAD_ONCE_INIT;
+
+static void log_measure_epoch_offset(void) {
+
+    struct timespec wall, mono;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+
+    log_epoch_offset_ns = ((long long)wall.tv_sec - (long long)mono.tv_sec) * 1000000000LL + (wall.tv_nsec - mono.tv_nsec);
+}
+
+int log_file_path(int entity_id, unsigned segment, char* path, size_t size) {
+
+    const char* separator = (log_directory[0] != '\0') ? "/" : "";
+    int length;
+
+    if (segment == 0) {
+        length = snprintf(path, size, "%s%slog_%d.csv", log_directory, separator, entity_id);
+    } else {
+        length = snprintf(path, size, "%s%slog_%d.%u.csv", log_directory, separator, entity_id, segment);
+    }
+
+    return ((length < 0) || ((size_t)length >= size)) ? -1 : length;
+}
+
+int log_file_header(char* header, size_t size) {
+
+    if (log_ms_timestamps) {
+        header[0] = '\0';
+        return 0;
+    }
+
+    pthread_once(&log_epoch_once, log_measure_epoch_offset);
+    return snprintf(header, size, "# clock=monotonic_ns epoch_offset_ns=%lld\n", log_epoch_offset_ns);
+}
+
+// Opens an entity's log file for appending, starting new nanosecond logs with a header recording the clock
+static FILE* log_open_file(int entity_id, unsigned segment) {
+
+    char filename[LOG_PATH_MAX];
+
+    if (log_file_path(entity_id, segment, filename, sizeof(filename)) < 0) {
+        return NULL;
+    }
 
     FILE* log_file = fopen(filename, "a");
 
+    if (log_file && !log_ms_timestamps && (ftell(log_file) == 0)) {
+        char header[128];
+        log_file_header(header, sizeof(header));
+        fputs(header, log_file);
+    }
+
+    return log_file;
+}
+
+// Appends one formatted line to an entity's log file
+static void log_append_line(int entity_id, unsigned segment, const char* line, size_t length) {
+
+    FILE* log_file = log_open_file(entity_id, segment);
+
     if (!log_file) {
         return;
     }
 
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    long long timestamp = (long long)tv.tv_sec * 1000LL + (long long)tv.tv_usec / 1000LL;
+    fwrite(line, 1, length, log_file);
+    fclose(log_file);
+}
+
+// Orders buffered lines by entity, keeping each entity's lines in the order they were logged (segments only ever grow)
+static int log_buffer_entry_compare(const void* a, const void* b) {
+
+    const struct LogBufferEntry* x = (const struct LogBufferEntry*)a;
+    const struct LogBufferEntry* y = (const struct LogBufferEntry*)b;
+
+    if (x->entity_id != y->entity_id) {
+        return (x->entity_id < y->entity_id) ? -1 : 1;
+    }
+
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Writes every buffered line out, opening each entity's log file (segment) once per batch
+static void log_buffer_write_out(struct LogBuffer* buffer) {
+
+    qsort(buffer->entries, (size_t)buffer->count, sizeof(struct LogBufferEntry), log_buffer_entry_compare);
+
+    // With a log writer thread the sorted lines are copied into its staging buffer and written by that thread
+    if (log_writer_running()) {
+
+        log_writer_append_begin();
+
+        for (int i = 0; i < buffer->count; i++) {
+
+            const struct LogBufferEntry* entry = buffer->entries + i;
+
+            if (!log_writer_append(entry->entity_id, entry->segment, buffer->data + entry->offset, entry->length)) {
+                log_append_line(entry->entity_id, entry->segment, buffer->data + entry->offset, entry->length);
+            }
+        }
+
+        log_writer_append_end();
+
+        __atomic_sub_fetch(&log_queued, buffer->count, __ATOMIC_RELAXED);
+
+        buffer->used = 0;
+        buffer->count = 0;
+        return;
+    }
+
+    FILE* log_file = NULL;
+    int open_id = 0;
+    unsigned open_segment = 0;
+    bool have_open = false;
+
+    for (int i = 0; i < buffer->count; i++) {
+
+        const struct LogBufferEntry* entry = buffer->entries + i;
+
+        if (!have_open || (entry->entity_id != open_id) || (entry->segment != open_segment)) {
+
+            if (log_file) {
+                fclose(log_file);
+            }
+
+            log_file = log_open_file(entry->entity_id, entry->segment);
+            open_id = entry->entity_id;
+            open_segment = entry->segment;
+            have_open = true;
+        }
+
+        if (log_file) {
+            fwrite(buffer->data + entry->offset, 1, entry->length, log_file);
+        }
+    }
+
+    if (log_file) {
+        fclose(log_file);
+    }
+
+    __atomic_sub_fetch(&log_queued, buffer->count, __ATOMIC_RELAXED);
+
+    buffer->used = 0;
+    buffer->count = 0;
+}
+
+// Adds a line to the calling thread's buffer, writing the batch out first when it is full
+static void log_buffer_append(int entity_id, unsigned segment, const char* line, size_t length) {
+
+    struct LogBuffer* buffer = &log_buffer;
+
+    if (buffer->used + length > LOG_BUFFER_BYTES) {
+        log_buffer_write_out(buffer);
+    }
+
+    if (buffer->used + length > buffer->capacity) {
+
+        size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : LOG_BUFFER_INITIAL_BYTES;
+        char* data = (char*)realloc(buffer->data, new_capacity);
+        alloc_count_add();
+
+        if (data == NULL) {
+            log_append_line(entity_id, segment, line, length);
+            return;
+        }
+
+        buffer->data = data;
+        buffer->capacity = new_capacity;
+    }
+
+    if (buffer->count == buffer->entry_capacity) {
+
+        int new_capacity = buffer->entry_capacity ? buffer->entry_capacity * 2 : 64;
+        struct LogBufferEntry* entries = (struct LogBufferEntry*)realloc(buffer->entries, (size_t)new_capacity * sizeof(struct LogBufferEntry));
+        alloc_count_add();
+
+        if (entries == NULL) {
+            log_append_line(entity_id, segment, line, length);
+            return;
+        }
+
+        buffer->entries = entries;
+        buffer->entry_capacity = new_capacity;
+    }
+
+    memcpy(buffer->data + buffer->used, line, length);
+
+    buffer->entries[buffer->count].entity_id = entity_id;
+    buffer->entries[buffer->count].segment = segment;
+    buffer->entries[buffer->count].offset = (unsigned)buffer->used;
+    buffer->entries[buffer->count].length = (unsigned)length;
+
+    buffer->used += length;
+    buffer->count++;
+
+    __atomic_add_fetch(&log_queued, 1, __ATOMIC_RELAXED);
+}
+
+long log_queue_depth(void) {
+    return __atomic_load_n(&log_queued, __ATOMIC_RELAXED);
+}
+
+void log_flush(void) {
+
+    struct LogBuffer* buffer = &log_buffer;
+
+    if (buffer->count > 0) {
+        log_buffer_write_out(buffer);
+    }
+
+    free(buffer->data);
+    free(buffer->entries);
+    memset(buffer, 0, sizeof(*buffer));
+
+    log_console_flush();
+    free(log_console_buffer);
+    log_console_buffer = NULL;
+    flight_thread_release();
+}
+
+static void log_cap_exit(const char* reason, int entity_id) {
+    fprintf(stderr, "Log capped (%s cap) for entity %d; stopping to prevent infinite growth.\n", reason, entity_id);
+    log_console_flush();
+    exit(1);
+}
+
+static void write_log_record(const struct LogRecord* record, enum LogAction log_action) {
+
+    // The flight recorder keeps the last records in memory even when file logging is off, capped or filtered
+    flight_record(record);
+
+    // --log-filter only decides what reaches the log files, the console output of the record is printed either way
+    if (!log_filter_keep(log_action, record->entity_type, record->entity_id)) {
+        return;
+    }
+
+    // Nothing is written and no pause is needed when file logging is off
+    if (!log_file_output) {
+        return;
+    }
+
+    // Past a cap the record is dropped and the simulation carries on (unless the cap policy is exit)
+    struct LogEntityVolume* volume = log_entity_volume(record->entity_id);
+    if (!log_within_caps(record->entity_id, volume)) {
+        return;
+    }
+
+    LogWriteHook hook = log_write_hook;
+    struct timespec write_start = {0, 0};
+    if (hook) {
+        clock_gettime(CLOCK_MONOTONIC, &write_start);
+    }
+
+    // The timeline number is taken right before the timestamp, so threads racing here are the only records whose
+    // timeline order can differ from their timestamp order
+    unsigned long timeline_seq = timeline_enabled ? timeline_reserve() : 0;
+    long long timestamp;
+
+    if (log_ms_timestamps) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        timestamp = (long long)tv.tv_sec * 1000LL + (long long)tv.tv_usec / 1000LL;
+    } else {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timestamp = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    }
 
     const char* entity = log_entity_type_to_string(record->entity_type);
     const char* room = record->room ? record->room : "";
@@ -305,7 +1213,9 @@ static void write_log_record(const struct LogRecord* record) {
     const char* action = record->action ? record->action : "";
     const char* extra = record->extra ? record->extra : "";
 
-    fprintf(log_file,
+    char line[LOG_LINE_MAX];
+    int length = snprintf(line,
+            sizeof(line),
             "%lld,%s,%d,%s,%s,%d,%d,%s,%s\n",
             timestamp,
             entity,
@@ -317,12 +1227,53 @@ static void write_log_record(const struct LogRecord* record) {
             action,
             extra);
 
-    fclose(log_file);
-    line_count++;
+    if (length < 0) {
+        if (timeline_enabled) {
+            timeline_publish(timeline_seq, NULL, 0);
+        }
+        return;
+    }
+    if ((size_t)length >= sizeof(line)) {
+        length = (int)sizeof(line) - 1;
+        line[length - 1] = '\n';
+    }
+
+    if (timeline_enabled) {
+        timeline_publish(timeline_seq, line, (size_t)length);
+    }
+
+    unsigned segment = log_assign_segment(volume, (size_t)length);
+
+    if (!log_entity_output) {
+        // Only the timeline is written
+    } else if (mmap_log_enabled && mmap_log_append(line, (size_t)length)) {
+        // Copied into the current segment, lines the segments could not take fall through to the per-entity files
+    } else {
+        if (log_buffered) {
+            log_buffer_append(record->entity_id, segment, line, (size_t)length);
+        } else {
+            log_append_line(record->entity_id, segment, line, (size_t)length);
+        }
+
+        if (log_index_entity_files && (volume != NULL)) {
+            log_index_entity(volume, record->entity_id, segment, timestamp, (size_t)length);
+        }
+    }
+
+    if (hook) {
+        struct timespec write_end;
+        clock_gettime(CLOCK_MONOTONIC, &write_end);
+        hook(record->entity_id,
+                room,
+                (long long)write_start.tv_sec * 1000000000LL + write_start.tv_nsec,
+                (long long)write_end.tv_sec * 1000000000LL + write_end.tv_nsec);
+    }
 
     // Short pause helps ensure successive logs receive distinct timestamps.
-    struct timespec pause = {0, 2 * 1000 * 1000}; // 2 ms
-    nanosleep(&pause, NULL);
+    if (log_record_pause) {
+        struct timespec pause = {0, 2 * 1000 * 1000}; // 2 ms
+        nanosleep(&pause, NULL);
+    }
 }
 
 void log_move(int hunter_id, int boredom, int fear, const char* from_room, const char* to_room, enum EvidenceType device) {
@@ -337,15 +1288,15 @@ void log_move(int hunter_id, int boredom, int fear, const char* from_room, const
         .extra = to_room
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_MOVE);
 
-    printf("Hunter %d using %s moved from %s to %s (bored=%d fear=%d)\n",
-           hunter_id,
-           evidence_to_string(device),
-           from_room ? from_room : "",
-           to_room ? to_room : "",
-           boredom,
-           fear);
+    log_console(LOG_VERBOSITY_FULL, "Hunter %d using %s moved from %s to %s (bored=%d fear=%d)\n",
+                hunter_id,
+                evidence_to_string(device),
+                from_room ? from_room : "",
+                to_room ? to_room : "",
+                boredom,
+                fear);
 }
 
 void log_evidence(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device) {
@@ -361,14 +1312,14 @@ void log_evidence(int hunter_id, int boredom, int fear, const char* room_name, e
         .extra = evidence
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_EVIDENCE);
 
-    printf("Hunter %d using %s gathered evidence in %s (bored=%d fear=%d)\n",
-           hunter_id,
-           evidence,
-           room_name ? room_name : "",
-           boredom,
-           fear);
+    log_console(LOG_VERBOSITY_FULL, "Hunter %d using %s gathered evidence in %s (bored=%d fear=%d)\n",
+                hunter_id,
+                evidence,
+                room_name ? room_name : "",
+                boredom,
+                fear);
 }
 
 void log_swap(int hunter_id, int boredom, int fear, enum EvidenceType from_device, enum EvidenceType to_device) {
@@ -388,14 +1339,14 @@ void log_swap(int hunter_id, int boredom, int fear, enum EvidenceType from_devic
         .extra = extra
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_SWAP);
 
-    printf("Hunter %d swapped devices: %s -> %s (bored=%d fear=%d)\n",
-           hunter_id,
-           from_text,
-           to_text,
-           boredom,
-           fear);
+    log_console(LOG_VERBOSITY_FULL, "Hunter %d swapped devices: %s -> %s (bored=%d fear=%d)\n",
+                hunter_id,
+                from_text,
+                to_text,
+                boredom,
+                fear);
 }
 
 void log_exit(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device, enum LogReason reason) {
@@ -413,15 +1364,15 @@ void log_exit(int hunter_id, int boredom, int fear, const char* room_name, enum
         .extra = reason_text
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_EXIT);
 
-    printf("Hunter %d using %s exited at %s (reason=%s, bored=%d fear=%d)\n",
-           hunter_id,
-           device_text,
-           room_name ? room_name : "",
-           reason_text,
-           boredom,
-           fear);
+    log_console(LOG_VERBOSITY_SUMMARY, "Hunter %d using %s exited at %s (reason=%s, bored=%d fear=%d)\n",
+                hunter_id,
+                device_text,
+                room_name ? room_name : "",
+                reason_text,
+                boredom,
+                fear);
 }
 
 void log_return_to_van(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device, bool heading_home) {
@@ -440,22 +1391,22 @@ void log_return_to_van(int hunter_id, int boredom, int fear, const char* room_na
         .extra = extra
     };
 
-    write_log_record(&record);
+    write_log_record(&record, heading_home ? LOG_ACTION_RETURN_START : LOG_ACTION_RETURN_COMPLETE);
 
     if (heading_home) {
-        printf("Hunter %d using %s heading to van from %s (bored=%d fear=%d)\n",
-               hunter_id,
-               device_text,
-               room_name ? room_name : "",
-               boredom,
-               fear);
+        log_console(LOG_VERBOSITY_FULL, "Hunter %d using %s heading to van from %s (bored=%d fear=%d)\n",
+                    hunter_id,
+                    device_text,
+                    room_name ? room_name : "",
+                    boredom,
+                    fear);
     } else {
-        printf("Hunter %d using %s finished return at %s (bored=%d fear=%d)\n",
-               hunter_id,
-               device_text,
-               room_name ? room_name : "",
-               boredom,
-               fear);
+        log_console(LOG_VERBOSITY_FULL, "Hunter %d using %s finished return at %s (bored=%d fear=%d)\n",
+                    hunter_id,
+                    device_text,
+                    room_name ? room_name : "",
+                    boredom,
+                    fear);
     }
 }
 
@@ -472,12 +1423,12 @@ void log_hunter_init(int hunter_id, const char* room_name, const char* hunter_na
         .extra = hunter_name ? hunter_name : ""
     };
 
-    write_log_record(&record);
-    printf("Hunter %d (%s) initialized in %s with %s\n",
-           hunter_id,
-           hunter_name ? hunter_name : "unknown",
-           room_name ? room_name : "",
-           device_text);
+    write_log_record(&record, LOG_ACTION_INIT);
+    log_console(LOG_VERBOSITY_SUMMARY, "Hunter %d (%s) initialized in %s with %s\n",
+                hunter_id,
+                hunter_name ? hunter_name : "unknown",
+                room_name ? room_name : "",
+                device_text);
 }
 
 void log_ghost_init(int ghost_id, const char* room_name, enum GhostType type) {
@@ -493,11 +1444,11 @@ void log_ghost_init(int ghost_id, const char* room_name, enum GhostType type) {
         .extra = type_text
     };
 
-    write_log_record(&record);
-    printf("Ghost %d (%s) initialized in %s\n",
-           ghost_id,
-           type_text,
-           room_name ? room_name : "");
+    write_log_record(&record, LOG_ACTION_INIT);
+    log_console(LOG_VERBOSITY_SUMMARY, "Ghost %d (%s) initialized in %s\n",
+                ghost_id,
+                type_text,
+                room_name ? room_name : "");
 }
 
 void log_ghost_move(int ghost_id, int boredom, const char* from_room, const char* to_room) {
@@ -512,13 +1463,13 @@ void log_ghost_move(int ghost_id, int boredom, const char* from_room, const char
         .extra = to_room
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_MOVE);
 
-    printf("Ghost %d [bored=%d] MOVE %s -> %s\n",
-           ghost_id,
-           boredom,
-           from_room ? from_room : "",
-           to_room ? to_room : "");
+    log_console(LOG_VERBOSITY_FULL, "Ghost %d [bored=%d] MOVE %s -> %s\n",
+                ghost_id,
+                boredom,
+                from_room ? from_room : "",
+                to_room ? to_room : "");
 }
 
 void log_ghost_evidence(int ghost_id, int boredom, const char* room_name, enum EvidenceType evidence) {
@@ -535,13 +1486,13 @@ void log_ghost_evidence(int ghost_id, int boredom, const char* room_name, enum E
         .extra = evidence_text
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_EVIDENCE);
 
-    printf("Ghost %d [bored=%d] EVIDENCE %s in %s\n",
-           ghost_id,
-           boredom,
-           evidence_text,
-           room_name ? room_name : "");
+    log_console(LOG_VERBOSITY_FULL, "Ghost %d [bored=%d] EVIDENCE %s in %s\n",
+                ghost_id,
+                boredom,
+                evidence_text,
+                room_name ? room_name : "");
 }
 
 void log_ghost_exit(int ghost_id, int boredom, const char* room_name) {
@@ -556,12 +1507,12 @@ void log_ghost_exit(int ghost_id, int boredom, const char* room_name) {
         .extra = ""
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_EXIT);
 
-    printf("Ghost %d [bored=%d] EXIT %s\n",
-           ghost_id,
-           boredom,
-           room_name ? room_name : "");
+    log_console(LOG_VERBOSITY_SUMMARY, "Ghost %d [bored=%d] EXIT %s\n",
+                ghost_id,
+                boredom,
+                room_name ? room_name : "");
 }
 
 void log_ghost_idle(int ghost_id, int boredom, const char* room_name) {
@@ -577,10 +1528,10 @@ void log_ghost_idle(int ghost_id, int boredom, const char* room_name) {
         .extra = ""
     };
 
-    write_log_record(&record);
+    write_log_record(&record, LOG_ACTION_IDLE);
 
-    printf("Ghost %d [bored=%d] IDLE in %s\n",
-           ghost_id,
-           boredom,
-           room_name ? room_name : "");
+    log_console(LOG_VERBOSITY_FULL, "Ghost %d [bored=%d] IDLE in %s\n",
+                ghost_id,
+                boredom,
+                room_name ? room_name : "");
 }
@@ -46,6 +46,42 @@ int get_all_ghost_types(const enum GhostType** list);
  */
 int rand_int_threadsafe(int lower_inclusive, int upper_exclusive);
 
+/**
+ * @brief Set the base seed the whole run derives its random streams from.
+ * @param[in] seed Base seed, 0 to seed from the clock.
+ */
+void rand_set_base_seed(unsigned seed);
+
+/**
+ * @brief Read back the base seed set with rand_set_base_seed.
+ * @return Base seed, 0 when the run is seeded from the clock.
+ */
+unsigned rand_get_base_seed(void);
+
+/**
+ * @brief Derive the starting PRNG state for one entity.
+ * @param[in] entity_id Hunter or ghost identifier.
+ * @return Non-zero seed, reproducible when a base seed is set.
+ */
+unsigned rand_seed_for_entity(int entity_id);
+
+/**
+ * @brief Make the calling thread draw random numbers from an entity's state.
+ * @param[in,out] seed Entity PRNG state, NULL to go back to the thread's own seed.
+ */
+void rand_bind_seed(unsigned* seed);
+
+/**
+ * @brief Count one heap allocation made by the simulation (room path nodes, hunters, arrays, log buffers).
+ */
+void alloc_count_add(void);
+
+/**
+ * @brief Read the number of allocations counted with alloc_count_add.
+ * @return Allocations counted so far by every thread.
+ */
+long alloc_count_get(void);
+
 /**
  * @brief Verify whether an evidence mask matches a supported ghost type.
  * @param[in] mask Combined evidence mask.
@@ -66,6 +102,221 @@ bool evidence_has_three_unique(EvidenceByte mask);
  */
 void house_populate_rooms(struct House* house);
 
+/**
+ * @brief Kind of entity a log record belongs to.
+ */
+enum LogEntityType {
+    LOG_ENTITY_HUNTER = 0,
+    LOG_ENTITY_GHOST = 1
+};
+
+/**
+ * @brief One log event, the fields of a log_<id>.csv line without its timestamp.
+ * @note The strings are not copied: they are static text, room names or hunter names, valid for the whole run.
+ */
+struct LogRecord {
+    enum LogEntityType entity_type;
+    int                entity_id;
+    const char*        room;
+    const char*        device;
+    int                boredom;
+    int                fear;
+    const char*        action;
+    const char*        extra;
+};
+
+/**
+ * @brief Return the type column text of a log record.
+ * @param[in] type Entity type.
+ * @return Static string "hunter" or "ghost"; "unknown" when out of range.
+ */
+const char* log_entity_type_to_string(enum LogEntityType type);
+
+/**
+ * @brief How much the log_* functions print to the console (log files are written either way).
+ */
+enum LogVerbosity {
+    LOG_VERBOSITY_SILENT = 0,       ///< no per-event lines
+    LOG_VERBOSITY_SUMMARY = 1,      ///< entity initialization and exit lines only
+    LOG_VERBOSITY_FULL = 2,         ///< every event (default)
+};
+
+/**
+ * @brief Set the console verbosity of the log_* functions.
+ * @param[in] verbosity Level to print at.
+ * @note Console lines are batched per thread and written out by log_flush or when the batch fills up.
+ */
+void log_set_verbosity(enum LogVerbosity verbosity);
+
+/**
+ * @brief Parse a verbosity name.
+ * @param[in] text "silent", "summary" or "full".
+ * @param[out] verbosity Parsed level, unchanged when the name is unknown.
+ * @return true when the name is known.
+ */
+bool log_parse_verbosity(const char* text, enum LogVerbosity* verbosity);
+
+/**
+ * @brief Set the log volume caps; past a cap records are dropped and the simulation keeps running.
+ * @param[in] max_entity_lines Lines one entity may log over the run, 0 for no cap (default 100000).
+ * @param[in] max_total_lines Lines all entities together may log, 0 for no cap (default).
+ * @param[in] exit_on_cap true to stop the process with exit(1) at a cap instead of dropping records.
+ */
+void log_set_limits(long max_entity_lines, long max_total_lines, bool exit_on_cap);
+
+/**
+ * @brief Rotate each entity's log into numbered segments, log_<id>.csv then log_<id>.1.csv, log_<id>.2.csv, ...
+ * @param[in] segment_lines Lines per segment, 0 for no line limit.
+ * @param[in] segment_bytes Bytes per segment, 0 for no size limit.
+ */
+void log_set_rotation(long segment_lines, long segment_bytes);
+
+/**
+ * @brief Count the log records dropped because a cap was reached.
+ * @return Dropped records.
+ */
+long log_dropped_line_count(void);
+
+/**
+ * @brief Count the entities that reached the per-entity cap.
+ * @return Capped entities.
+ */
+int log_capped_entity_count(void);
+
+/**
+ * @brief Check whether the total cap was reached.
+ * @return true once any record was dropped by the total cap.
+ */
+bool log_total_cap_reached(void);
+
+/**
+ * @brief Select the records written to the log files (the console and flight recorder still see every record).
+ * @param[in] spec Semicolon-separated clauses: actions=EVIDENCE,RETURN_*,EXIT keeps only those actions,
+ *                 entities=hunter,ghost,<id>,... keeps only those entity types or IDs, and
+ *                 sample=MOVE:10,IDLE:100 keeps one record in N of an action (counted per entity).
+ * @return true if the spec was valid; otherwise prints the error and returns false.
+ */
+bool log_set_filter(const char* spec);
+
+/**
+ * @brief Write a sparse index next to each log segment: every Nth record's number, timestamp and byte offset.
+ * @param[in] every Records between index entries, 0 for no index.
+ * @param[in] entity_files true to index the log_<id>.csv files too, not only timeline.csv and the --log-mmap segments.
+ */
+void log_set_index(long every, bool entity_files);
+
+/**
+ * @brief Get the records between index entries.
+ * @return Index interval, 0 when no index is written.
+ */
+long log_index_interval(void);
+
+/**
+ * @brief Open the index of a log segment (its path plus ".idx") for appending, writing its header when it is new.
+ * @param[in] log_path Path of the indexed log segment.
+ * @return Open index file, NULL if it could not be opened. Entries are "record,timestamp,offset" lines where no record
+ *         before offset has a later timestamp.
+ */
+FILE* log_index_open(const char* log_path);
+
+/**
+ * @brief Write log_filter.txt to the log directory, listing the filtered and sampled actions for validators.
+ * @return C_OK if written or no filter is set, C_ERR otherwise.
+ */
+int log_write_filter_note(void);
+
+/**
+ * @brief Write log files into a directory instead of the current directory.
+ * @param[in] directory Existing directory, "" for the current directory.
+ * @return false when the path is too long (the directory is left unchanged).
+ */
+bool log_set_directory(const char* directory);
+
+/**
+ * @brief Read back the directory set with log_set_directory.
+ * @return Log directory, "" for the current directory.
+ */
+const char* log_get_directory(void);
+
+/**
+ * @brief Build the path of an entity's log file segment in the log directory.
+ * @param[in] entity_id Hunter or ghost identifier.
+ * @param[in] segment Segment number, 0 for log_<id>.csv.
+ * @param[out] path Buffer for the path.
+ * @param[in] size Size of the buffer.
+ * @return Path length, -1 when it does not fit.
+ */
+int log_file_path(int entity_id, unsigned segment, char* path, size_t size);
+
+/**
+ * @brief Build the header line new log files start with.
+ * @param[out] header Buffer for the line, newline included.
+ * @param[in] size Size of the buffer.
+ * @return Header length, 0 for millisecond logs (which have no header).
+ */
+int log_file_header(char* header, size_t size);
+
+/**
+ * @brief Switch log timestamps between CLOCK_MONOTONIC nanoseconds (default) and wall-clock milliseconds.
+ * @param[in] enabled true for the legacy millisecond column (no header line).
+ * @note Nanosecond logs start with a "# clock=monotonic_ns epoch_offset_ns=N" line; wall-clock time is timestamp + N.
+ */
+void log_set_ms_timestamps(bool enabled);
+
+/**
+ * @brief Turn the short pause after each log record on or off.
+ * @param[in] enabled false to skip the pause (replayed runs do not rely on wall-clock ordering).
+ */
+void log_set_record_pause(bool enabled);
+
+/**
+ * @brief Turn writing of log_<id>.csv files on or off.
+ * @param[in] enabled false to skip file logging (console output is unaffected).
+ */
+void log_set_file_output(bool enabled);
+
+/**
+ * @brief Turn the per-entity log output (log_<id>.csv files or --log-mmap segments) on or off.
+ * @param[in] enabled false to write only the merged timeline.
+ */
+void log_set_entity_output(bool enabled);
+
+/**
+ * @brief Turn buffered file logging on or off.
+ * @param[in] enabled true to collect records per thread and append them to the log files in batches.
+ */
+void log_set_buffered(bool enabled);
+
+/**
+ * @brief Called after every log record is written, with the record's entity and room and the write's start and end time.
+ */
+typedef void (*LogWriteHook)(int entity_id, const char* room, long long start_ns, long long end_ns);
+
+/**
+ * @brief Install a function called after each log record is written (used by trace event export).
+ * @param[in] hook Function to call, or NULL to remove it.
+ * @note Times are CLOCK_MONOTONIC nanoseconds.
+ */
+void log_set_write_hook(LogWriteHook hook);
+
+/**
+ * @brief Count the log records held in per-thread buffers that are not written out yet.
+ * @return Records waiting to be written (always 0 without buffered logging).
+ */
+long log_queue_depth(void);
+
+/**
+ * @brief Write the calling thread's batched console lines to stdout.
+ * @note Call before prompting the user so that lines logged so far are shown first.
+ */
+void log_console_flush(void);
+
+/**
+ * @brief Write out and release the calling thread's buffered log records and console lines.
+ * @note Every thread that logs must call this before it exits.
+ */
+void log_flush(void);
+
 /**
  * @brief Append a MOVE entry for a hunter.
  * @param[in] id Hunter identifier.
@@ -27,6 +27,7 @@ int house_create_stack(House *house) {
     house->ghost = ghost;
     house->hunter_arr = hunters;
     house->entities_running = false;
+    house->round_count = 0;
 
     house->starting_room = NULL;
     house->room_count = 0;
@@ -61,12 +62,12 @@ int house_load_data(House *house) {
     Room* start_room = room_choose_rand_start(house);
 
     // Waits for room ghost presence lock
-    sem_wait(&(start_room->ghost_presence_lock));
+    LOCK_WAIT(&(start_room->ghost_presence_lock));
 
     room_add_ghost(start_room, ghost);
 
     // Releases room ghost prescence lock
-    sem_post(&(start_room->ghost_presence_lock));
+    LOCK_POST(&(start_room->ghost_presence_lock));
 
     // TESTING (spawns ghost in van to ensure ghost can detect hunters)
     // room_add_ghost(house->starting_room, ghost);
@@ -101,6 +102,8 @@ int house_add_hunter(House *house, Hunter *hunter) {
 
     hunter->case_file = &(house->case_file);        // points hunter's casefile to house's shared casefile
 
+    decision_trace_add_hunter(hunter);              // records hunter in decision trace roster (when recording)
+
     // Permitted for hunters to point to exit without being added to the exit room's occupancy during initialization
     // Allows for more than 8 hunters to be added to house
 
@@ -145,6 +148,276 @@ void house_check_entities_running(House *house) {
     house->entities_running = entities_running;
 }
 
+/*
+    Purpose:
+        Runs the simulation on the calling thread, giving the ghost and then each hunter one turn per round.
+        Each entity's turn draws from that entity's own PRNG state, so a run resumed from a checkpoint continues identically.
+    Parameters:
+        - house (in/out): house structure
+        - checkpoint_every (in): rounds between checkpoints, 0 to never checkpoint
+        - checkpoint_path (in): file checkpoints are written to, may be NULL when not checkpointing
+*/
+void house_run_single_thread(House *house, long checkpoint_every, const char *checkpoint_path) {
+
+    house_check_entities_running(house);
+
+    while (house->entities_running) {
+
+        // Ghost takes its turn
+        if (house->ghost.running) {
+            rand_bind_seed(&(house->ghost.rand_seed));
+            decision_bind_entity(house->ghost.id);
+            ghost_take_turn(&(house->ghost));
+        }
+
+        // Each hunter still in the house takes its turn
+        for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+
+            Hunter *hunter = house->hunter_arr.hunters[i];
+
+            if (hunter->running) {
+                rand_bind_seed(&(hunter->rand_seed));
+                decision_bind_entity(hunter->id);
+                hunter_take_turn(hunter);
+            }
+        }
+
+        rand_bind_seed(NULL);
+        decision_bind_entity(DECISION_NO_ENTITY);
+
+        (house->round_count)++;
+        house_check_entities_running(house);
+
+        // Saves a checkpoint between rounds, when no entity is mid-turn
+        if ((checkpoint_every > 0) && (checkpoint_path != NULL) && (house->round_count % checkpoint_every == 0)) {
+            house_checkpoint_save(house, checkpoint_path);
+        }
+    }
+
+    latency_thread_flush();
+}
+
+// Entities run by one thread of the worker pool
+typedef struct HouseWorker {
+    House *house;
+    int worker_index;
+    int worker_count;
+    pthread_t thread;
+} HouseWorker;
+
+// Worker thread, keeps giving turns to entities worker_index, worker_index + worker_count, ... until all of them stop
+// Entity 0 is the ghost, entity i is hunter i - 1
+static void *house_worker_thread(void *arg) {
+
+    HouseWorker *worker = (HouseWorker*)arg;
+    House *house = worker->house;
+    int entity_count = house->hunter_arr.hunter_count + 1;
+    bool running = true;
+
+    while (running) {
+
+        running = false;
+
+        for (int i = worker->worker_index; i < entity_count; i += worker->worker_count) {
+
+            if (i == 0) {
+
+                if (house->ghost.running) {
+                    rand_bind_seed(&(house->ghost.rand_seed));
+                    decision_bind_entity(house->ghost.id);
+                    ghost_take_turn(&(house->ghost));
+                    running = true;
+                }
+            }
+            else {
+
+                Hunter *hunter = house->hunter_arr.hunters[i - 1];
+
+                if (hunter->running) {
+                    rand_bind_seed(&(hunter->rand_seed));
+                    decision_bind_entity(hunter->id);
+                    hunter_take_turn(hunter);
+                    running = true;
+                }
+            }
+        }
+    }
+
+    rand_bind_seed(NULL);
+    decision_bind_entity(DECISION_NO_ENTITY);
+    log_flush();            // writes out records still held by buffered logging
+    latency_thread_flush();
+    trace_thread_flush();
+
+    return 0;
+}
+
+/*
+    Purpose:
+        Runs the simulation on a fixed pool of threads instead of one thread per entity.
+        Entities are dealt out to the workers round robin, each worker runs its entities' turns in a loop like the entity threads do.
+    Parameters:
+        - house (in/out): house structure
+        - worker_count (in): number of worker threads, capped at the number of entities
+*/
+void house_run_workers(House *house, int worker_count) {
+
+    int entity_count = house->hunter_arr.hunter_count + 1;
+
+    if (worker_count > entity_count) {
+        worker_count = entity_count;
+    }
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+
+    HouseWorker *workers = (HouseWorker*)malloc((size_t)worker_count * sizeof(HouseWorker));
+    alloc_count_add();
+
+    if (workers == NULL) {
+        printf("\nERROR: Memory allocation error... \n");
+        return;
+    }
+
+    // Creates worker threads
+    for (int i = 0; i < worker_count; i++) {
+
+        workers[i].house = house;
+        workers[i].worker_index = i;
+        workers[i].worker_count = worker_count;
+
+        pthread_create(&(workers[i].thread), NULL, house_worker_thread, workers + i);
+    }
+
+    // Waits for all worker threads to complete
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    free(workers);
+}
+
+/*
+    Purpose:
+        Populates the house with a generated layout instead of Willow House, for runs larger than Willow allows.
+        Room 0 is the van, every other room joins the layout through a random earlier room, then extra random connections add loops.
+        The layout is drawn from its own PRNG state derived from the base seed, so a seeded run always gets the same layout.
+    Parameters:
+        - house (in/out): house structure
+        - room_count (in): number of rooms, 2 to MAX_ROOMS
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int house_generate_rooms(House *house, int room_count) {
+
+    if ((room_count < 2) || (room_count > MAX_ROOMS)) {
+        printf("\nERROR: Generated layouts need 2 to %d rooms...\n", MAX_ROOMS);
+        return C_ERR;
+    }
+
+    unsigned state = rand_seed_for_entity(DECISION_NO_ENTITY) ^ (unsigned)room_count;
+    char name[MAX_ROOM_NAME];
+
+    house->room_count = room_count;
+
+    room_init(house->rooms, "Van", true);
+
+    for (int i = 1; i < room_count; i++) {
+
+        snprintf(name, sizeof(name), "Room %d", i);
+        room_init(house->rooms + i, name, false);
+
+        // Room i - 1 has only its own connection so far, so the scan always finds a room with space
+        int j = rand_r(&state) % i;
+        while (house->rooms[j].connect_count == MAX_CONNECTIONS) {
+            j = (j + 1) % i;
+        }
+
+        room_connect(house->rooms + i, house->rooms + j);
+    }
+
+    // Extra connections, skipped when the pair is already connected or either room is full
+    for (int k = 0; k < room_count / 4; k++) {
+
+        Room *a = house->rooms + (rand_r(&state) % room_count);
+        Room *b = house->rooms + (rand_r(&state) % room_count);
+        bool connected = (a == b);
+
+        for (int i = 0; i < a->connect_count; i++) {
+            connected = connected || (a->rooms_connected[i] == b);
+        }
+
+        if (!connected && (a->connect_count < MAX_CONNECTIONS) && (b->connect_count < MAX_CONNECTIONS)) {
+            room_connect(a, b);
+        }
+    }
+
+    house->starting_room = house->rooms;
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Writes the house's room graph to rooms.csv in the log directory, so that validators check moves against the
+        layout the run actually used. One line per room: the room's name, then the names of its connected rooms.
+    Parameters:
+        - house (in): house structure, rooms populated
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int house_write_room_graph(const House *house) {
+
+    const char *directory = log_get_directory();
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s%srooms.csv", directory, (directory[0] != '\0') ? "/" : "");
+
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        printf("\nERROR: Room graph %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    fprintf(file, "# room,connected rooms\n");
+
+    for (int i = 0; i < house->room_count; i++) {
+
+        const Room *room = house->rooms + i;
+        fputs(room->name, file);
+
+        for (int j = 0; j < room->connect_count; j++) {
+            fprintf(file, ",%s", room->rooms_connected[j]->name);
+        }
+
+        fputc('\n', file);
+    }
+
+    fclose(file);
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Counts the turns every entity has taken so far in this process.
+    Parameters:
+        - house (in): house structure
+    Returns:
+        Total number of ghost and hunter turns.
+*/
+long house_turn_count(const House *house) {
+
+    long turns = house->ghost.turn_count;
+
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+        turns += house->hunter_arr.hunters[i]->turn_count;
+    }
+
+    return turns;
+}
+
 /*
     Purpose:
         Frees the dynamic memory allocated for the house structure's dynamically allocated fields.
@@ -163,6 +436,9 @@ void house_cleanup_stack(House *house) {
 
     dynamic_hunterarr_cleanup(&(house->hunter_arr));        // frees all memory dynamically allocated for dynamic hunter array
 
+    free(house->ghost.turn_latency);                        // frees ghost turn latency histogram (allocated only with --latency)
+    house->ghost.turn_latency = NULL;
+
     int success;
 
     // Destroys all semaphores allocated to each room
@@ -19,6 +19,8 @@ int hunter_user_create(House *house) {
     Hunter *new_hunter;     // declares pointer to store pointer to user created hunter
     int success;            // flag to track success of hunter creation
 
+    log_console_flush();                    // shows the previous hunter's initialization before prompting
+
     // Asks user for hunter's name (or done if finished creating hunters)
     char name[MAX_HUNTER_NAME];
     printf("\nEnter hunter name (max 63 chars) or \"done\" if finished: ");
@@ -130,6 +132,7 @@ void get_int(int *output_int) {
 int hunter_init(Hunter* *hunter, const char* name, const int id, const bool chose_device, const int device_index) {
 
     *hunter = (Hunter*) malloc(sizeof(Hunter));    // dynamically allocates a hunter structure
+    alloc_count_add();
 
     if (*hunter == NULL) {
         printf("\nERROR: Memory allocation error... \n");
@@ -140,6 +143,7 @@ int hunter_init(Hunter* *hunter, const char* name, const int id, const bool chos
     strcpy((*hunter)->name, name);                             
     (*hunter)->id = id;
     (*hunter)->device_type = hunter_choose_device(chose_device, device_index);
+    (*hunter)->chosen_device = (chose_device && (device_index >= 0) && (device_index < 7)) ? device_index : -1;
 
     // Initializes fields of hunter to simulation starting values
     (*hunter)->boredom = 0;
@@ -152,6 +156,10 @@ int hunter_init(Hunter* *hunter, const char* name, const int id, const bool chos
     (*hunter)->return_to_van = false;
     (*hunter)->exited = false;
     (*hunter)->exited_reason = LR_NOT_YET_EXIT;         // unsure this is necessary
+    (*hunter)->rand_seed = rand_seed_for_entity(id);
+    (*hunter)->turn_count = 0;
+    (*hunter)->evidence_found = 0;
+    (*hunter)->turn_latency = NULL;
 
     roomstack_init(&((*hunter)->rooms_path));
 
@@ -178,6 +186,7 @@ int hunter_cleanup(Hunter* *hunter) {
         return C_ERR;
     }
 
+    free((*hunter)->turn_latency);      // frees turn latency histogram (allocated only with --latency)
     free(*hunter);       // frees memory allocated for hunter structure
     *hunter = NULL;      // sets pointer pointed to by hunter to NULL
 
@@ -208,7 +217,7 @@ enum EvidenceType hunter_choose_device(const bool chose_device, const int device
         }
     }
     // If device not chosen or provided device index is out of range, returns randomly chosen device
-    int rand_index = rand_int_threadsafe(0, device_count);       // generates random integer to choose device at that index
+    int rand_index = decision_rand(DEC_DEVICE, 0, device_count);       // generates random integer to choose device at that index
     return device_types[rand_index];
     
 }
@@ -224,11 +233,19 @@ void *hunter_thread(void *arg) {
 
     Hunter *hunter = (Hunter*)arg;
 
+    // Hunter draws all of its decisions from its own PRNG state
+    rand_bind_seed(&(hunter->rand_seed));
+    decision_bind_entity(hunter->id);
+
     while (hunter->running) {
         
         hunter_take_turn(hunter);
     }
 
+    log_flush();            // writes out records still held by buffered logging
+    latency_thread_flush();
+    trace_thread_flush();
+
     return 0;
 }
 
@@ -243,6 +260,12 @@ void hunter_take_turn(Hunter *hunter) {
 
     bool hunter_exited;         // tracks if hunter has exited the simulation
 
+    long long turn_start = latency_turn_begin();       // times the turn when run with --latency
+    long long trace_start = trace_begin();             // and for the trace when run with --trace-events
+    const char *turn_room = hunter->room->name;
+
+    __atomic_store_n(&(hunter->turn_count), hunter->turn_count + 1, __ATOMIC_RELAXED);     // read by the metrics thread
+
     // Updates hunter's stats
     hunter_stats_update(hunter);
 
@@ -254,6 +277,8 @@ void hunter_take_turn(Hunter *hunter) {
 
             hunter->return_to_van = false;      // marks that hunter has reached the van
 
+            CHECK_RETURN_COMPLETE(hunter);
+
             // Logs hunter's end of returning to exit room
             log_return_to_van(hunter->id, hunter->boredom, hunter->fear, hunter->room->name, hunter->device_type, hunter->return_to_van);
         }
@@ -262,29 +287,28 @@ void hunter_take_turn(Hunter *hunter) {
     // Checks if hunter should exit, hunter exits if true
     hunter_exited = hunter_condition_check(hunter);
 
-    if (hunter_exited) {
-        return;             // ends turn if hunter exited simulation
-    }
-
     // Checks if hunter is in exit room, manages exit room if true
-    if (hunter_exit_check(hunter->room)) {
+    if (!hunter_exited && hunter_exit_check(hunter->room)) {
         hunter_exited = hunter_manage_exit_room(hunter);        // need to track if hunter exited
     }
 
-    if (hunter_exited) {
-        return;             // ends turn if hunter exited simulation
-    }
+    // Hunter gathers evidence and moves only if it is still in the house
+    if (!hunter_exited) {
+
+        // Checks if hunter is on its way to exit room, if so does not gather evidence
+        // Makes no sense to gather evidence with same device when already evidence identified
+        if (!hunter->return_to_van) {
 
-    // Checks if hunter is on its way to exit room, if so does not gather evidence
-    // Makes no sense to gather evidence with same device when already evidence identified
-    if (!hunter->return_to_van) {
+            // Makes hunter attempt to gather evidence
+            hunter_gather_evidence(hunter);
+        }
 
-        // Makes hunter attempt to gather evidence
-        hunter_gather_evidence(hunter);
+        // Makes hunter attempt to move
+        hunter_move(hunter);
     }
 
-    // Makes hunter attempt to move
-    hunter_move(hunter);
+    latency_turn_end(&(hunter->turn_latency), turn_start);
+    trace_turn(hunter->id, turn_room, trace_start);
 }
 
 // HUNTER STATS FUNCTIONS
@@ -297,14 +321,16 @@ void hunter_take_turn(Hunter *hunter) {
 */
 void hunter_stats_update(Hunter *hunter) {
 
+    int boredom_before = hunter->boredom;          // for invariant checks
+
     // Waits for room ghost prescence lock
-    sem_wait(&(hunter->room->ghost_presence_lock));
+    LOCK_WAIT(&(hunter->room->ghost_presence_lock));
 
     // Checks if ghost is currently in room with hunter
     bool ghost_in_room = hunter_check_ghost(hunter->room);
 
     // Releases room ghost prescence lock
-    sem_post(&(hunter->room->ghost_presence_lock));
+    LOCK_POST(&(hunter->room->ghost_presence_lock));
 
     if (ghost_in_room) {
         hunter_boredom_reset(hunter);
@@ -313,6 +339,8 @@ void hunter_stats_update(Hunter *hunter) {
     else {
         hunter_boredom_inc(hunter);
     }
+
+    CHECK_BOREDOM(hunter->id, boredom_before, hunter->boredom, ghost_in_room);
 }
 
 /*
@@ -404,24 +432,28 @@ void hunter_exit(Hunter *hunter, enum LogReason exit_reason) {
 
     Room *room = hunter->room;          // stores pointer to room hunter is exiting from for logs
     
-    // Updates hunter's exit reason
-    hunter->exited_reason = exit_reason;
+    // Updates hunter's exit reason, the fields the metrics thread reads are stored atomically
+    __atomic_store_n(&(hunter->exited_reason), exit_reason, __ATOMIC_RELAXED);
 
     // Waits for room hunter occupancy lock
-    sem_wait(&(room->hunter_occupancy_lock));
+    LOCK_WAIT(&(room->hunter_occupancy_lock));
 
     room_remove_hunter(hunter->room, hunter);       // removes hunter from room
 
+    CHECK_HUNTER_EXIT(hunter, room);
+
     log_exit(hunter->id, hunter->boredom, hunter->fear, room->name, hunter->device_type, hunter->exited_reason);        // logs hunter exiting the simulation
 
     // Releases room hunter occupancy lock
-    sem_post(&(room->hunter_occupancy_lock));
+    LOCK_POST(&(room->hunter_occupancy_lock));
 
     // Updates hunter simulation stats fields
-    hunter->running = false;
-    hunter->exited = true;
+    __atomic_store_n(&(hunter->running), false, __ATOMIC_RELAXED);
+    __atomic_store_n(&(hunter->exited), true, __ATOMIC_RELAXED);
 
     roomstack_cleanup(&(hunter)->rooms_path, true);   // frees memory allocated for hunter's room path stack
+
+    latency_mark_action(LAT_EXIT);
 }
 
 // HUNTER BEHAVIOUR FUNCTIONS
@@ -450,7 +482,7 @@ bool hunter_exit_check(const Room *room) {
 bool hunter_manage_exit_room(Hunter *hunter) {
 
     // Waits for case file mutex
-    sem_wait(&(hunter->case_file->mutex));
+    LOCK_WAIT(&(hunter->case_file->mutex));
 
     // Checks for victory (3 pieces of evidence shared among hunters)
     bool victory =  casefile_check_victory(hunter->case_file);
@@ -464,14 +496,14 @@ bool hunter_manage_exit_room(Hunter *hunter) {
         }
 
         // Releases case file mutex (here if victory)
-        sem_post(&(hunter->case_file->mutex));
+        LOCK_POST(&(hunter->case_file->mutex));
 
         hunter_exit(hunter, LR_EVIDENCE);       // exits hunter from simulation
         return true;
     }
 
     // Releases case file mutex (here if not victory)
-    sem_post(&(hunter->case_file->mutex));
+    LOCK_POST(&(hunter->case_file->mutex));
 
     // Checks if hunter is still in exit room after being initialized, hunter should not swap devices or clear room path stack
     if (hunter->init_first_room) {
@@ -504,6 +536,8 @@ void hunter_swap_device(Hunter *hunter) {
 
     // Logs hunter's device swap
     log_swap(hunter->id, hunter->boredom, hunter->fear, current_device, new_device);
+
+    latency_mark_action(LAT_SWAP);
 }
 
 /*
@@ -515,13 +549,13 @@ void hunter_swap_device(Hunter *hunter) {
 void hunter_gather_evidence(Hunter *hunter) {
 
     // Waits for room evidence lock
-    sem_wait(&(hunter->room->evidence_lock));
+    LOCK_WAIT(&(hunter->room->evidence_lock));
 
     // Checks if hunter's device matches any evidence present in room
     if (!hunter_check_evidence(hunter)) {
 
         // Releases room evidence lock (here when no matching evidence identified)
-        sem_post(&(hunter->room->evidence_lock));
+        LOCK_POST(&(hunter->room->evidence_lock));
 
         // Checks if hunter is currently in exit room
         if (hunter_exit_check(hunter->room)) {
@@ -534,6 +568,12 @@ void hunter_gather_evidence(Hunter *hunter) {
         return;                                 // returns as no evidence was found
     }
 
+    CHECK_EVIDENCE_COLLECT(hunter);
+
+    latency_mark_action(LAT_EVIDENCE);
+
+    (hunter->evidence_found)++;
+
     // Logs hunter's identified evidence
     log_evidence(hunter->id, hunter->boredom, hunter->fear, hunter->room->name, hunter->device_type);
 
@@ -541,16 +581,16 @@ void hunter_gather_evidence(Hunter *hunter) {
     room_evidence_clear(hunter->room, hunter->device_type);
 
     // Releases room evidence lock (here when matching evidence identified)
-    sem_post(&(hunter->room->evidence_lock));
+    LOCK_POST(&(hunter->room->evidence_lock));
 
     // Waits for case file mutex
-    sem_wait(&(hunter->case_file->mutex));
+    LOCK_WAIT(&(hunter->case_file->mutex));
 
     // Adds evidence to shared case file
     casefile_evidence_add(hunter->case_file, hunter->device_type);
 
     // Releases case file mutex
-    sem_post(&(hunter->case_file->mutex));
+    LOCK_POST(&(hunter->case_file->mutex));
 
     // Checks to ensure hunter is not already in exit room
     if (!hunter_exit_check(hunter->room)) {
@@ -594,7 +634,7 @@ void hunter_return_exit(Hunter *hunter, bool need_return) {
     // Gives hunter 19% chance of turning to exit room
     else {
 
-        int rand_int = rand_int_threadsafe(0, 10);           // generates random integer between 0-9
+        int rand_int = decision_rand(DEC_RETURN_ROLL, 0, 10);         // generates random integer between 0-9
 
         if (rand_int == 0) {
 
@@ -618,6 +658,10 @@ int hunter_move(Hunter *hunter) {
 
     Room *current_room = hunter->room;      // stores pointer to hunter's current room for logs
     Room *next_room;                        // stores pointer to next room hunter attempts to move to
+    bool returning = hunter->return_to_van; // stores if hunter is retracing its path for invariant checks
+    long long move_start = trace_begin();
+
+    latency_mark_action(returning ? LAT_RETURN : LAT_MOVE);
 
     // Hunter is returning to van/exit room
     if (hunter->return_to_van) {
@@ -632,12 +676,12 @@ int hunter_move(Hunter *hunter) {
     // Waits for room hunter occupancy locks (locks in order of memory addresses)
     if (current_room < next_room) {
 
-        sem_wait(&(current_room->hunter_occupancy_lock));
-        sem_wait(&(next_room->hunter_occupancy_lock));
+        LOCK_WAIT(&(current_room->hunter_occupancy_lock));
+        LOCK_WAIT(&(next_room->hunter_occupancy_lock));
     }
     else {
-        sem_wait(&(next_room->hunter_occupancy_lock));
-        sem_wait(&(current_room->hunter_occupancy_lock));
+        LOCK_WAIT(&(next_room->hunter_occupancy_lock));
+        LOCK_WAIT(&(current_room->hunter_occupancy_lock));
     }
 
     // Checks if next room is at full capacity
@@ -661,12 +705,14 @@ int hunter_move(Hunter *hunter) {
         }
 
         // Releases room hunter occupancy locks
-        sem_post(&(current_room->hunter_occupancy_lock));
-        sem_post(&(next_room->hunter_occupancy_lock));
+        LOCK_POST(&(current_room->hunter_occupancy_lock));
+        LOCK_POST(&(next_room->hunter_occupancy_lock));
 
         return C_ROOM_FULL;         //  movement fails, ends movement by returning so hunter remains in current room
     }
 
+    int path_depth = CHECK_PATH_DEPTH(&(hunter->rooms_path));      // path stack depth before the move, for invariant checks
+
     // Removes hunter from current room and adds hunter to next room
     if (!room_remove_hunter(hunter->room, hunter)) {     
         printf("\nERROR: Hunter cannot be removed from current room...\n");
@@ -677,12 +723,16 @@ int hunter_move(Hunter *hunter) {
         return C_ERR;
     }
 
+    CHECK_HUNTER_MOVE(hunter, current_room, next_room, returning, path_depth);
+
     // Logs hunter's movement
     log_move(hunter->id, hunter->boredom, hunter->fear, current_room->name, next_room->name, hunter->device_type);
 
     // Releases room hunter occupancy locks
-    sem_post(&(current_room->hunter_occupancy_lock));
-    sem_post(&(next_room->hunter_occupancy_lock));
+    LOCK_POST(&(current_room->hunter_occupancy_lock));
+    LOCK_POST(&(next_room->hunter_occupancy_lock));
+
+    trace_move(hunter->id, current_room->name, next_room->name, move_start);
 
     // Checks if hunter was previously still in exit room after initialization
     if (hunter->init_first_room) {
@@ -714,6 +764,7 @@ int dynamic_hunterarr_init(DynamicHunterArray *hunter_arr) {
     hunter_arr->hunter_count = 0;       // initializes hunter count to 0
 
     hunter_arr->hunters = (Hunter**)malloc((hunter_arr->capacity)*sizeof(Hunter*));     // dynamically allocates memory for array of hunter pointers
+    alloc_count_add();
 
     if (hunter_arr->hunters == NULL) {
         printf("\nERROR: Memory allocation error... \n");
@@ -768,6 +819,7 @@ int dynamic_hunterarr_grow(DynamicHunterArray *hunter_arr) {
     int new_capacity = hunter_arr->capacity * 2;        // calculates double the current capacity of the dynamic hunter array
 
     hunter_arr->hunters = (Hunter**)realloc(hunter_arr->hunters, (new_capacity)*sizeof(Hunter*));       // dynamically reallocates memory for array of hunter pointers
+    alloc_count_add();
 
     if (hunter_arr->hunters == NULL) {
         printf("\nERROR: Memory allocation error... \n");
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Live versions of the checks validate_logs.py runs over the CSV logs.
+// Only compiled in with SIM_CHECKS (make CHECKS=1), the CHECK_* macros in defs.h expand to nothing otherwise.
+// Every check is called by the function making the state change, while it still holds the locks guarding that state.
+
+#define INVARIANT_SAMPLES 5
+
+static unsigned long invariant_counts[INV_TYPE_COUNT];
+
+static const char* invariant_to_string(enum InvariantType type) {
+
+    switch (type) {
+        case INV_EDGE:
+            return "Movement (edge)";
+        case INV_RETURN_PATH:
+            return "Return path";
+        case INV_EVIDENCE:
+            return "Evidence";
+        case INV_BOREDOM:
+            return "Boredom";
+        case INV_OCCUPANCY:
+            return "Occupancy";
+        default:
+            return "Unknown";
+    }
+}
+
+// Counts violation and prints the first few of each type
+static void invariant_fail(enum InvariantType type, int entity_id, const char *detail) {
+
+    unsigned long count = __atomic_add_fetch(invariant_counts + type, 1, __ATOMIC_RELAXED);
+
+    if (count <= INVARIANT_SAMPLES) {
+        fprintf(stderr, "INVARIANT [%s] entity %d: %s\n", invariant_to_string(type), entity_id, detail);
+    }
+}
+
+// Checks if to is one of the rooms listed as connected to from
+static bool invariant_room_lists(const Room *from, const Room *to) {
+
+    for (int i = 0; i < from->connect_count; i++) {
+        if (from->rooms_connected[i] == to) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Checks the edge from both sides: moves are picked from from's list, so to's list has to lead back for a valid edge
+static bool invariant_rooms_connected(const Room *from, const Room *to) {
+
+    return invariant_room_lists(from, to) && invariant_room_lists(to, from);
+}
+
+/*
+    Purpose:
+        Counts the rooms on a hunter's path stack.
+    Parameters:
+        - room_stack (in): hunter room path stack
+    Returns:
+        Number of rooms on the stack.
+*/
+int invariant_path_depth(const RoomStack *room_stack) {
+
+    int depth = 0;
+
+    for (const RoomNode *node = room_stack->head; node != NULL; node = node->next) {
+        depth++;
+    }
+
+    return depth;
+}
+
+/*
+    Purpose:
+        Checks a completed hunter move: valid edge (listed from both rooms), occupancy of both rooms and the room path stack.
+        Exploring pushes the new room onto the path stack, returning pops the room just left.
+        Called with both rooms' hunter occupancy locks held.
+    Parameters:
+        - hunter (in): hunter structure, after the move
+        - from (in): room hunter left
+        - to (in): room hunter entered
+        - returning (in): true if hunter was retracing its path to the van
+        - depth_before (in): path stack depth before the move
+*/
+void invariant_check_hunter_move(const Hunter *hunter, const Room *from, const Room *to, bool returning, int depth_before) {
+
+    char detail[256];
+
+    if (!invariant_rooms_connected(from, to)) {
+        snprintf(detail, sizeof(detail), "invalid edge %s -> %s", from->name, to->name);
+        invariant_fail(INV_EDGE, hunter->id, detail);
+    }
+
+    int depth_after = invariant_path_depth(&(hunter->rooms_path));
+    int depth_expected = returning ? depth_before - 1 : depth_before + 1;
+
+    if (depth_after != depth_expected) {
+        snprintf(detail, sizeof(detail), "path stack depth %d -> %d moving %s -> %s", depth_before, depth_after, from->name, to->name);
+        invariant_fail(INV_RETURN_PATH, hunter->id, detail);
+    }
+
+    if ((hunter->room != to) || (hunter->rooms_path.head == NULL) || (hunter->rooms_path.head->room != to)) {
+        snprintf(detail, sizeof(detail), "path stack top does not match current room %s", to->name);
+        invariant_fail(INV_RETURN_PATH, hunter->id, detail);
+    }
+
+    if (fixed_hunterarr_get_hunter_pos(&(from->hunter_arr), hunter) >= 0) {
+        snprintf(detail, sizeof(detail), "still recorded in %s after moving out", from->name);
+        invariant_fail(INV_OCCUPANCY, hunter->id, detail);
+    }
+
+    if ((fixed_hunterarr_get_hunter_pos(&(to->hunter_arr), hunter) < 0) || (to->hunter_arr.hunter_count > MAX_ROOM_OCCUPANCY)) {
+        snprintf(detail, sizeof(detail), "not recorded in %s after moving in, or room over capacity", to->name);
+        invariant_fail(INV_OCCUPANCY, hunter->id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Checks a completed ghost move: valid edge (listed from both rooms) and ghost presence in both rooms.
+        Called with both rooms' ghost presence locks held.
+    Parameters:
+        - ghost (in): ghost structure, after the move
+        - from (in): room ghost left
+        - to (in): room ghost entered
+*/
+void invariant_check_ghost_move(const Ghost *ghost, const Room *from, const Room *to) {
+
+    char detail[256];
+
+    if (!invariant_rooms_connected(from, to)) {
+        snprintf(detail, sizeof(detail), "invalid edge %s -> %s", from->name, to->name);
+        invariant_fail(INV_EDGE, ghost->id, detail);
+    }
+
+    if ((ghost->room != to) || (to->ghost != ghost) || (from->ghost != NULL)) {
+        snprintf(detail, sizeof(detail), "ghost presence out of sync moving %s -> %s", from->name, to->name);
+        invariant_fail(INV_OCCUPANCY, ghost->id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Checks that a hunter completing its return is in the exit room with only the exit room left on its path stack.
+    Parameters:
+        - hunter (in): hunter structure
+*/
+void invariant_check_return_complete(const Hunter *hunter) {
+
+    const RoomNode *head = hunter->rooms_path.head;
+
+    if (!hunter->room->is_exit || (head == NULL) || (head->room != hunter->room) || (head->next != NULL)) {
+        invariant_fail(INV_RETURN_PATH, hunter->id, "return completed outside the van or with rooms left on the path stack");
+    }
+}
+
+/*
+    Purpose:
+        Checks that a hunter only collects evidence actually present in the room.
+        Called with the room evidence lock held, before the evidence is cleared.
+    Parameters:
+        - hunter (in): hunter structure
+*/
+void invariant_check_evidence_collect(const Hunter *hunter) {
+
+    if (!evidence_byte_contains_type(hunter->room->evidence, hunter->device_type)) {
+
+        char detail[256];
+        snprintf(detail, sizeof(detail), "collected %s but %s is missing that evidence", evidence_to_string(hunter->device_type), hunter->room->name);
+        invariant_fail(INV_EVIDENCE, hunter->id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Checks that the ghost only leaves evidence matching its own type.
+    Parameters:
+        - ghost (in): ghost structure
+        - evidence (in): evidence left behind
+*/
+void invariant_check_evidence_drop(const Ghost *ghost, enum EvidenceType evidence) {
+
+    if (!evidence_byte_contains_type((EvidenceByte)ghost->type, evidence)) {
+
+        char detail[256];
+        snprintf(detail, sizeof(detail), "left %s which is not evidence of %s", evidence_to_string(evidence), ghost_to_string(ghost->type));
+        invariant_fail(INV_EVIDENCE, ghost->id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Checks a stats update against the boredom rule validate_logs.py checks: boredom goes back to 0 in a room shared
+        with the other side and goes up by one otherwise.
+    Parameters:
+        - entity_id (in): hunter or ghost ID
+        - previous (in): entity boredom before its stats update
+        - boredom (in): entity boredom after its stats update
+        - shares_room (in): true if the ghost and a hunter were in the same room
+*/
+void invariant_check_boredom(int entity_id, int previous, int boredom, bool shares_room) {
+
+    int expected = shares_room ? 0 : previous + 1;
+
+    if (boredom != expected) {
+
+        char detail[256];
+        snprintf(detail, sizeof(detail), "boredom %d -> %d %s, expected %d", previous, boredom, shares_room ? "while sharing a room" : "alone", expected);
+        invariant_fail(INV_BOREDOM, entity_id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Checks that an exiting hunter is no longer recorded in the room it left.
+        Called with the room's hunter occupancy lock held.
+    Parameters:
+        - hunter (in): hunter structure
+        - room (in): room hunter exited from
+*/
+void invariant_check_hunter_exit(const Hunter *hunter, const Room *room) {
+
+    if (fixed_hunterarr_get_hunter_pos(&(room->hunter_arr), hunter) >= 0) {
+
+        char detail[256];
+        snprintf(detail, sizeof(detail), "still recorded in %s after exiting", room->name);
+        invariant_fail(INV_OCCUPANCY, hunter->id, detail);
+    }
+}
+
+/*
+    Purpose:
+        Prints the number of invariant violations of each type seen during the run.
+    Returns:
+        Total number of violations.
+*/
+unsigned long invariants_report(void) {
+
+    unsigned long total = 0;
+
+    printf("\nInvariant Checks: \n");
+    printf("--------------------------------------------------------------------\n");
+
+    for (int i = 0; i < INV_TYPE_COUNT; i++) {
+
+        unsigned long count = __atomic_load_n(invariant_counts + i, __ATOMIC_RELAXED);
+        total += count;
+
+        printf("    - %-18s violations: %lu \n", invariant_to_string((enum InvariantType)i), count);
+    }
+
+    return total;
+}
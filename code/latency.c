@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Turn latency histograms, turned on with --latency.
+// Buckets are log-linear like HDR histograms: 2^LATENCY_SUB_BITS linear sub-buckets per power of two, so every bucket is
+// within about 6% of the values it holds while the whole range up to minutes fits in a few hundred counters.
+// Per-entity histograms hang off the entity and per-action histograms are thread-local, so recording never takes a lock.
+// Each thread merges its action histograms into the run's totals once, when it stops running turns.
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_SHIFT 36                                        // values up to 2^41 ns (about 36 minutes)
+#define LATENCY_BUCKETS ((LATENCY_MAX_SHIFT + 2) * LATENCY_SUB_COUNT)
+#define LATENCY_ENTITY_ROWS 16                                      // larger runs print merged hunters and the slowest few
+
+struct LatencyHistogram {
+    unsigned long count;
+    long long max_ns;
+    unsigned counts[LATENCY_BUCKETS];
+};
+
+static bool latency_enabled = false;
+
+// Run totals per action type, merged into from every thread under latency_mutex
+static LatencyHistogram latency_action_totals[LAT_ACTION_COUNT];
+static pthread_mutex_t latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local LatencyHistogram *thread_action_hists[LAT_ACTION_COUNT];
+static _Thread_local int turn_action = -1;
+
+static long long latency_now_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Bucket holding value, values below 2 * LATENCY_SUB_COUNT get a bucket each
+static int latency_bucket(long long value) {
+
+    if (value < 2 * LATENCY_SUB_COUNT) {
+        return (value < 0) ? 0 : (int)value;
+    }
+
+    int msb = 63 - __builtin_clzll((unsigned long long)value);
+    int shift = msb - LATENCY_SUB_BITS;
+
+    if (shift > LATENCY_MAX_SHIFT) {
+        return LATENCY_BUCKETS - 1;
+    }
+
+    int sub = (int)(value >> shift);        // in [LATENCY_SUB_COUNT, 2 * LATENCY_SUB_COUNT)
+
+    return (shift + 1) * LATENCY_SUB_COUNT + (sub - LATENCY_SUB_COUNT);
+}
+
+// Largest value that falls in a bucket
+static long long latency_bucket_high(int bucket) {
+
+    if (bucket < 2 * LATENCY_SUB_COUNT) {
+        return bucket;
+    }
+
+    int shift = bucket / LATENCY_SUB_COUNT - 1;
+    long long sub = (bucket % LATENCY_SUB_COUNT) + LATENCY_SUB_COUNT;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+static void latency_record(LatencyHistogram *hist, long long value) {
+
+    hist->counts[latency_bucket(value)]++;
+    hist->count++;
+
+    if (value > hist->max_ns) {
+        hist->max_ns = value;
+    }
+}
+
+static void latency_merge(LatencyHistogram *into, const LatencyHistogram *from) {
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+
+    into->count += from->count;
+
+    if (from->max_ns > into->max_ns) {
+        into->max_ns = from->max_ns;
+    }
+}
+
+// Value at percentile (0-100), reported as the top of its bucket and never above the recorded maximum
+static long long latency_percentile(const LatencyHistogram *hist, double percentile) {
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    unsigned long rank = (unsigned long)((percentile / 100.0) * (double)hist->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    unsigned long seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+
+        seen += hist->counts[i];
+
+        if (seen >= rank) {
+            long long high = latency_bucket_high(i);
+            return (high < hist->max_ns) ? high : hist->max_ns;
+        }
+    }
+
+    return hist->max_ns;
+}
+
+/*
+    Purpose:
+        Turns turn latency recording on or off, set before any entity takes a turn.
+    Parameters:
+        - enabled (in): true to time every turn
+*/
+void latency_set_enabled(bool enabled) {
+
+    latency_enabled = enabled;
+}
+
+/*
+    Purpose:
+        Marks what the current turn did. A turn that does several things is reported under the most significant one,
+        in the order of enum LatencyAction (an evidence turn that also moves counts as evidence).
+    Parameters:
+        - action (in): action taken during the turn
+*/
+void latency_mark_action(enum LatencyAction action) {
+
+    if ((int)action > turn_action) {
+        turn_action = (int)action;
+    }
+}
+
+/*
+    Purpose:
+        Starts timing a turn.
+    Returns:
+        Start time to pass to latency_turn_end, 0 when latency recording is off.
+*/
+long long latency_turn_begin(void) {
+
+    turn_action = -1;
+
+    return latency_enabled ? latency_now_ns() : 0;
+}
+
+/*
+    Purpose:
+        Finishes timing a turn, recording it in the entity's histogram and the thread's histogram for the turn's action.
+    Parameters:
+        - entity_hist (in/out): entity's histogram pointer, allocated on the entity's first timed turn
+        - start_ns (in): value returned by latency_turn_begin
+*/
+void latency_turn_end(LatencyHistogram **entity_hist, long long start_ns) {
+
+    if (!latency_enabled) {
+        return;
+    }
+
+    long long elapsed = latency_now_ns() - start_ns;
+    int action = (turn_action < 0) ? LAT_MOVE : turn_action;
+
+    if (*entity_hist == NULL) {
+        *entity_hist = (LatencyHistogram*)calloc(1, sizeof(LatencyHistogram));
+        alloc_count_add();
+    }
+    if (thread_action_hists[action] == NULL) {
+        thread_action_hists[action] = (LatencyHistogram*)calloc(1, sizeof(LatencyHistogram));
+        alloc_count_add();
+    }
+
+    if (*entity_hist != NULL) {
+        latency_record(*entity_hist, elapsed);
+    }
+    if (thread_action_hists[action] != NULL) {
+        latency_record(thread_action_hists[action], elapsed);
+    }
+}
+
+/*
+    Purpose:
+        Merges the calling thread's action histograms into the run totals and frees them.
+        Every thread that runs turns calls this once it is done.
+*/
+void latency_thread_flush(void) {
+
+    pthread_mutex_lock(&latency_mutex);
+
+    for (int i = 0; i < LAT_ACTION_COUNT; i++) {
+
+        if (thread_action_hists[i] != NULL) {
+            latency_merge(latency_action_totals + i, thread_action_hists[i]);
+            free(thread_action_hists[i]);
+            thread_action_hists[i] = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&latency_mutex);
+}
+
+/*
+    Purpose:
+        Gets what the calling thread's current turn did so far, as it would be recorded by latency_turn_end.
+    Returns:
+        Most significant action marked since latency_turn_begin, LAT_MOVE if none was marked.
+*/
+enum LatencyAction latency_turn_action(void) {
+
+    return (turn_action < 0) ? LAT_MOVE : (enum LatencyAction)turn_action;
+}
+
+/*
+    Purpose:
+        Converts a turn action to its name.
+    Parameters:
+        - action (in): turn action
+    Returns:
+        Action name.
+*/
+const char* latency_action_to_string(enum LatencyAction action) {
+
+    switch (action) {
+        case LAT_MOVE:
+            return "move";
+        case LAT_RETURN:
+            return "return";
+        case LAT_IDLE:
+            return "idle";
+        case LAT_HAUNT:
+            return "haunt";
+        case LAT_EVIDENCE:
+            return "evidence";
+        case LAT_SWAP:
+            return "swap";
+        case LAT_EXIT:
+            return "exit";
+        default:
+            return "unknown";
+    }
+}
+
+static void latency_print_row(const char *name, const LatencyHistogram *hist) {
+
+    if ((hist == NULL) || (hist->count == 0)) {
+        return;
+    }
+
+    printf("    %-24s %9lu %10.2f %10.2f %10.2f %10.2f %10.2f \n",
+           name,
+           hist->count,
+           (double)latency_percentile(hist, 50.0) / 1000.0,
+           (double)latency_percentile(hist, 90.0) / 1000.0,
+           (double)latency_percentile(hist, 99.0) / 1000.0,
+           (double)latency_percentile(hist, 99.9) / 1000.0,
+           (double)hist->max_ns / 1000.0);
+}
+
+static void latency_print_header(const char *first_column) {
+
+    printf("    %-24s %9s %10s %10s %10s %10s %10s \n", first_column, "Turns", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+}
+
+/*
+    Purpose:
+        Prints turn latency percentiles per entity and per action type.
+        Runs with more than LATENCY_ENTITY_ROWS hunters print all hunters merged and the hunters with the slowest p99.
+    Parameters:
+        - house (in): house structure
+*/
+void latency_report(const House *house) {
+
+    if (!latency_enabled) {
+        return;
+    }
+
+    char name[MAX_HUNTER_NAME + 32];
+    const DynamicHunterArray *hunters = &(house->hunter_arr);
+
+    printf("\nTurn Latency: \n");
+    printf("--------------------------------------------------------------------\n");
+    latency_print_header("Entity");
+
+    snprintf(name, sizeof(name), "Ghost %d", house->ghost.id);
+    latency_print_row(name, house->ghost.turn_latency);
+
+    if (hunters->hunter_count <= LATENCY_ENTITY_ROWS) {
+
+        for (int i = 0; i < hunters->hunter_count; i++) {
+            snprintf(name, sizeof(name), "%s (%d)", hunters->hunters[i]->name, hunters->hunters[i]->id);
+            latency_print_row(name, hunters->hunters[i]->turn_latency);
+        }
+    }
+    else {
+
+        LatencyHistogram *merged = (LatencyHistogram*)calloc(1, sizeof(LatencyHistogram));
+
+        if (merged != NULL) {
+
+            for (int i = 0; i < hunters->hunter_count; i++) {
+                if (hunters->hunters[i]->turn_latency != NULL) {
+                    latency_merge(merged, hunters->hunters[i]->turn_latency);
+                }
+            }
+
+            snprintf(name, sizeof(name), "All %d hunters", hunters->hunter_count);
+            latency_print_row(name, merged);
+            free(merged);
+        }
+
+        // Picks the slowest hunters by p99, one pass per row
+        const Hunter *printed[5] = {NULL};
+
+        for (int row = 0; row < 5; row++) {
+
+            const Hunter *slowest = NULL;
+            long long slowest_p99 = -1;
+
+            for (int i = 0; i < hunters->hunter_count; i++) {
+
+                const Hunter *hunter = hunters->hunters[i];
+                bool already = false;
+
+                for (int j = 0; j < row; j++) {
+                    already = already || (printed[j] == hunter);
+                }
+
+                if (!already && (hunter->turn_latency != NULL) && (latency_percentile(hunter->turn_latency, 99.0) > slowest_p99)) {
+                    slowest = hunter;
+                    slowest_p99 = latency_percentile(hunter->turn_latency, 99.0);
+                }
+            }
+
+            if (slowest == NULL) {
+                break;
+            }
+
+            printed[row] = slowest;
+            snprintf(name, sizeof(name), "  %s (%d)", slowest->name, slowest->id);
+            latency_print_row(name, slowest->turn_latency);
+        }
+    }
+
+    printf("\n");
+    latency_print_header("Action");
+
+    pthread_mutex_lock(&latency_mutex);
+
+    for (int i = 0; i < LAT_ACTION_COUNT; i++) {
+        latency_print_row(latency_action_to_string((enum LatencyAction)i), latency_action_totals + i);
+    }
+
+    pthread_mutex_unlock(&latency_mutex);
+}
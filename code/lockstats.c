@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Contention counters for the room and case file semaphores.
+// Only compiled in with SIM_LOCK_STATS (make LOCKSTATS=1), the LOCK_* macros in defs.h are plain sem_wait/sem_post otherwise.
+// Every lock is a binary semaphore used as a mutex, so a lock's counters are only ever updated by the thread holding it.
+
+#define LOCK_STATS_SLOTS 1024          // power of two, more than the 3 * MAX_ROOMS + 1 locks a house has
+
+typedef struct LockStats {
+    const sem_t *sem;                   // lock the counters belong to, NULL for a free slot
+    unsigned long acquisitions;
+    unsigned long contended;            // acquisitions that had to wait for another thread
+    long long total_wait_ns;
+    long long max_wait_ns;
+    long long total_hold_ns;
+    long long acquired_ns;              // when the current holder acquired the lock
+} LockStats;
+
+// Registered on the main thread before entity threads start, read-only lookups afterwards
+static LockStats lock_stats[LOCK_STATS_SLOTS];
+
+static long long lockstats_now_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Gets the slot for a lock, or the free slot it would go in, NULL if the table is full
+static LockStats* lockstats_slot(const sem_t *sem) {
+
+    size_t index = (size_t)(((uintptr_t)sem >> 4) * 0x9E3779B97F4A7C15ull) & (LOCK_STATS_SLOTS - 1);
+
+    for (int probe = 0; probe < LOCK_STATS_SLOTS; probe++) {
+
+        LockStats *stats = lock_stats + ((index + probe) & (LOCK_STATS_SLOTS - 1));
+
+        if ((stats->sem == sem) || (stats->sem == NULL)) {
+            return stats;
+        }
+    }
+
+    return NULL;
+}
+
+// Gets the counters of a registered lock, NULL for locks that were never registered
+static LockStats* lockstats_find(const sem_t *sem) {
+
+    LockStats *stats = lockstats_slot(sem);
+
+    return ((stats != NULL) && (stats->sem == sem)) ? stats : NULL;
+}
+
+/*
+    Purpose:
+        Starts (or restarts) the contention counters of a lock, called right after the lock is initialized.
+    Parameters:
+        - sem (in): room or case file semaphore
+*/
+void lockstats_register(sem_t *sem) {
+
+    LockStats *stats = lockstats_slot(sem);
+
+    if (stats == NULL) {
+        printf("\nERROR: Lock statistics table is full...\n");
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sem = sem;
+}
+
+/*
+    Purpose:
+        Acquires a lock like sem_wait, counting the acquisition and timing any wait for another thread.
+    Parameters:
+        - sem (in/out): room or case file semaphore
+    Returns:
+        Return value of sem_wait (0 on success).
+*/
+int lockstats_wait(sem_t *sem) {
+
+    LockStats *stats = lockstats_find(sem);
+
+    // Uncontended acquisitions skip timing the wait
+    if (sem_trywait(sem) == 0) {
+
+        if (stats != NULL) {
+            stats->acquisitions++;
+            stats->acquired_ns = lockstats_now_ns();
+        }
+
+        return 0;
+    }
+
+    long long start = lockstats_now_ns();
+    int result = sem_wait(sem);
+    long long end = lockstats_now_ns();
+
+    if ((stats != NULL) && (result == 0)) {
+
+        long long wait = end - start;
+
+        stats->acquisitions++;
+        stats->contended++;
+        stats->total_wait_ns += wait;
+        if (wait > stats->max_wait_ns) {
+            stats->max_wait_ns = wait;
+        }
+        stats->acquired_ns = end;
+    }
+
+    if (trace_events_enabled) {
+        trace_lock_event(sem, start, end);
+    }
+
+    return result;
+}
+
+/*
+    Purpose:
+        Releases a lock like sem_post, adding the time it was held.
+    Parameters:
+        - sem (in/out): room or case file semaphore
+    Returns:
+        Return value of sem_post (0 on success).
+*/
+int lockstats_post(sem_t *sem) {
+
+    LockStats *stats = lockstats_find(sem);
+
+    if ((stats != NULL) && (stats->acquired_ns != 0)) {
+        stats->total_hold_ns += lockstats_now_ns() - stats->acquired_ns;
+        stats->acquired_ns = 0;
+    }
+
+    return sem_post(sem);
+}
+
+/*
+    Purpose:
+        Adds up the time every registered lock spent waiting, for the --stats line.
+    Returns:
+        Total wait time in nanoseconds.
+*/
+long long lockstats_total_wait_ns(void) {
+
+    long long total = 0;
+
+    for (int i = 0; i < LOCK_STATS_SLOTS; i++) {
+        if (lock_stats[i].sem != NULL) {
+            total += lock_stats[i].total_wait_ns;
+        }
+    }
+
+    return total;
+}
+
+// Prints one row of the contention table, skips locks that were never taken
+static void lockstats_print_row(const char *owner, const char *lock_name, const sem_t *sem) {
+
+    const LockStats *stats = lockstats_find(sem);
+
+    if ((stats == NULL) || (stats->acquisitions == 0)) {
+        return;
+    }
+
+    double acquisitions = (double)stats->acquisitions;
+    double contended_pct = 100.0 * (double)stats->contended / acquisitions;
+    double avg_wait_us = (stats->contended > 0) ? (double)stats->total_wait_ns / (double)stats->contended / 1000.0 : 0.0;
+
+    char name[MAX_ROOM_NAME + 32];
+    snprintf(name, sizeof(name), "%s %s lock", owner, lock_name);
+
+    printf("    %-42s %10lu %9.1f%% %11.2f %11.2f %11.2f \n",
+           name,
+           stats->acquisitions,
+           contended_pct,
+           avg_wait_us,
+           (double)stats->max_wait_ns / 1000.0,
+           (double)stats->total_hold_ns / acquisitions / 1000.0);
+}
+
+/*
+    Purpose:
+        Prints acquisitions, contention, wait and hold times of every room lock and the case file lock.
+        Wait times are averaged over contended acquisitions, hold times over all acquisitions.
+    Parameters:
+        - house (in): house structure
+*/
+void lockstats_report(const House *house) {
+
+    printf("\nLock Contention: \n");
+    printf("--------------------------------------------------------------------\n");
+    printf("    %-42s %10s %10s %11s %11s %11s \n", "Lock", "Acquired", "Contended", "Avg wait us", "Max wait us", "Avg hold us");
+
+    for (int i = 0; i < house->room_count; i++) {
+
+        const Room *room = house->rooms + i;
+
+        lockstats_print_row(room->name, "ghost presence", &(room->ghost_presence_lock));
+        lockstats_print_row(room->name, "occupancy", &(room->hunter_occupancy_lock));
+        lockstats_print_row(room->name, "evidence", &(room->evidence_lock));
+    }
+
+    lockstats_print_row("Case file", "mutex", &(house->case_file.mutex));
+
+    printf("\n    - Total wait: %.3f ms \n", (double)lockstats_total_wait_ns() / 1e6);
+}
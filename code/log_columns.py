@@ -0,0 +1,346 @@
+"""
+Columnar export of the Willow House logs, for analytics that only need a few fields.
+
+Usage:
+- python3 log_columns.py export [directory] writes the run's records (read like validate_logs.py reads them:
+  log_*.csv, log_*.csv.gz, events_<n>.csv segments or timeline.csv) to <directory>/events.cols
+- python3 log_columns.py query <file> rooms|evidence|exits prints a room heatmap, the evidence found per device
+  or the hunters' exit reasons, reading only the columns the query needs
+
+File format (little-endian):
+- "WHCOLS1\\n", then every column's blocks back to back, one column after another
+- a JSON footer, its length as an 8-byte integer, and "WHCOLS1\\n" again
+The footer holds the dictionaries and, per column, the encoding and its blocks (offset, length, rows, min, max).
+Records are in timestamp order and split into blocks of --block-rows rows. Columns and encodings:
+- timestamp: delta, the block's first value then signed differences
+- entity, room, device, action, extra: dict, codes into the footer's dictionaries ("room id" is the room code)
+- boredom, fear: int, differences from the block minimum
+Each block is a fixed-width array, 1 to 8 bytes per value, as narrow as its values allow.
+A query reads the footer, skips blocks whose min/max rule them out, and reads only the chunks of the columns it uses.
+
+Command Line Arguments (export):
+- <directory> run's log directory (default: the current directory)
+- --output <filename> columnar file to write (default: <directory>/events.cols)
+- --block-rows <number> rows per block (default 65536)
+- --stream merges the logs while reading them instead of loading and sorting them
+- --per-entity reads the per-entity logs even when the run also wrote timeline.csv
+
+Command Line Arguments (query):
+- --from <timestamp> / --to <timestamp> only counts records in this timestamp range, skipping blocks outside it
+"""
+
+from __future__ import annotations
+
+import argparse
+import itertools
+import json
+import os
+import struct
+import sys
+from array import array
+from collections import Counter
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+from validate_logs import LogEntry, parse_logs, stream_logs, timeline_path
+
+
+MAGIC = b"WHCOLS1\n"
+FORMAT = "ghost-hunt-columns"
+VERSION = 1
+DEFAULT_BLOCK_ROWS = 65536
+
+# Column name and encoding, dict columns code into the dictionary of the same name
+COLUMNS: List[Tuple[str, str]] = [
+    ("timestamp", "delta"),
+    ("entity", "dict"),
+    ("room", "dict"),
+    ("device", "dict"),
+    ("action", "dict"),
+    ("boredom", "int"),
+    ("fear", "int"),
+    ("extra", "dict"),
+]
+
+# Array type codes by item size; the sizes of I and L differ between platforms
+UNSIGNED = {array(code).itemsize: code for code in "QLIHB"}
+SIGNED = {array(code).itemsize: code for code in "qlihb"}
+WIDTHS = (1, 2, 4, 8)
+
+
+def unsigned_width(largest: int) -> int:
+    return next(width for width in WIDTHS if largest < (1 << (8 * width)))
+
+
+def signed_width(smallest: int, largest: int) -> int:
+    return next(width for width in WIDTHS if -(1 << (8 * width - 1)) <= smallest and largest < (1 << (8 * width - 1)))
+
+
+def pack(values: Sequence[int], code: str) -> bytes:
+    packed = array(code, values)
+    if sys.byteorder == "big":
+        packed.byteswap()
+    return packed.tobytes()
+
+
+def unpack(data: bytes, code: str) -> array:
+    values = array(code)
+    values.frombytes(data)
+    if sys.byteorder == "big":
+        values.byteswap()
+    return values
+
+
+# ---- Encoding ----
+
+class Dictionary:
+    # Assigns codes in first-seen order
+    def __init__(self) -> None:
+        self.codes: Dict[object, int] = {}
+        self.values: List[object] = []
+
+    def code(self, value: object) -> int:
+        code = self.codes.get(value)
+        if code is None:
+            code = self.codes[value] = len(self.values)
+            self.values.append(value)
+        return code
+
+
+def encode_block(encoding: str, values: List[int]) -> Tuple[bytes, Dict[str, int]]:
+    smallest, largest = min(values), max(values)
+    meta = {"rows": len(values), "min": smallest, "max": largest}
+
+    if encoding == "delta":
+        deltas = [later - earlier for earlier, later in zip(values, values[1:])]
+        width = signed_width(min(deltas, default=0), max(deltas, default=0))
+        meta.update(base=values[0], width=width)
+        return pack(deltas, SIGNED[width]), meta
+
+    if encoding == "int":
+        width = unsigned_width(largest - smallest)
+        meta["width"] = width
+        return pack([value - smallest for value in values], UNSIGNED[width]), meta
+
+    width = unsigned_width(largest)
+    meta["width"] = width
+    return pack(values, UNSIGNED[width]), meta
+
+
+def entry_fields(entry: LogEntry, dictionaries: Dict[str, Dictionary]) -> List[int]:
+    return [
+        entry.timestamp,
+        dictionaries["entity"].code((entry.entity_type, entry.entity_id)),
+        dictionaries["room"].code(entry.room),
+        dictionaries["device"].code(entry.device),
+        dictionaries["action"].code(entry.action),
+        entry.boredom,
+        entry.fear,
+        dictionaries["extra"].code(entry.extra),
+    ]
+
+
+def export_columns(entries: Iterable[LogEntry], path: str, block_rows: int = DEFAULT_BLOCK_ROWS) -> int:
+    dictionaries = {name: Dictionary() for name, encoding in COLUMNS if encoding == "dict"}
+    chunks: List[bytearray] = [bytearray() for _ in COLUMNS]
+    blocks: List[List[Dict[str, int]]] = [[] for _ in COLUMNS]
+    rows = 0
+
+    # Encoded blocks are gathered per column, so each column ends up contiguous in the file
+    iterator = iter(entries)
+    while True:
+        block = [entry_fields(entry, dictionaries) for entry in itertools.islice(iterator, block_rows)]
+        if not block:
+            break
+        for index, (values, (_, encoding)) in enumerate(zip(zip(*block), COLUMNS)):
+            data, meta = encode_block(encoding, list(values))
+            meta["offset"] = len(chunks[index])
+            meta["length"] = len(data)
+            chunks[index] += data
+            blocks[index].append(meta)
+        rows += len(block)
+
+    footer = {
+        "format": FORMAT,
+        "version": VERSION,
+        "rows": rows,
+        "block_rows": block_rows,
+        "dictionaries": {name: dictionary.values for name, dictionary in dictionaries.items()},
+        "columns": {},
+    }
+
+    with open(path, "wb") as handle:
+        handle.write(MAGIC)
+        for index, (name, encoding) in enumerate(COLUMNS):
+            start = handle.tell()
+            for meta in blocks[index]:
+                meta["offset"] += start
+            footer["columns"][name] = {"encoding": encoding, "blocks": blocks[index]}
+            handle.write(chunks[index])
+        encoded = json.dumps(footer, separators=(",", ":")).encode("utf-8")
+        handle.write(encoded)
+        handle.write(struct.pack("<Q", len(encoded)))
+        handle.write(MAGIC)
+
+    return rows
+
+
+# ---- Reading ----
+
+class ColumnFile:
+    def __init__(self, path: str) -> None:
+        self.path = path
+        self.handle = open(path, "rb")
+        self.size = os.fstat(self.handle.fileno()).st_size
+        self.bytes_read = 0
+
+        tail_length = 8 + len(MAGIC)
+        if self.size < len(MAGIC) + tail_length:
+            raise ValueError(f"{path} is not a columnar log file")
+        self.handle.seek(self.size - tail_length)
+        tail = self.handle.read(tail_length)
+        if tail[8:] != MAGIC:
+            raise ValueError(f"{path} is not a columnar log file")
+        (footer_length,) = struct.unpack("<Q", tail[:8])
+        self.handle.seek(self.size - tail_length - footer_length)
+        footer = json.loads(self.handle.read(footer_length).decode("utf-8"))
+        if footer.get("format") != FORMAT or footer.get("version") != VERSION:
+            raise ValueError(f"{path} has an unsupported format or version")
+
+        self.rows: int = footer["rows"]
+        self.columns: Dict[str, Dict] = footer["columns"]
+        self.dictionaries: Dict[str, List] = footer["dictionaries"]
+        self.block_count = len(self.columns["timestamp"]["blocks"])
+
+    def close(self) -> None:
+        self.handle.close()
+
+    def code(self, column: str, value: object) -> Optional[int]:
+        values = self.dictionaries[column]
+        return values.index(value) if value in values else None
+
+    def blocks_in_range(self, column: str, low: Optional[int], high: Optional[int]) -> List[int]:
+        # Blocks whose min/max can hold a value in [low, high]
+        return [
+            index for index, meta in enumerate(self.columns[column]["blocks"])
+            if (low is None or meta["max"] >= low) and (high is None or meta["min"] <= high)
+        ]
+
+    def block(self, column: str, index: int) -> Sequence[int]:
+        info = self.columns[column]
+        meta = info["blocks"][index]
+        self.handle.seek(meta["offset"])
+        data = self.handle.read(meta["length"])
+        self.bytes_read += len(data)
+
+        if info["encoding"] == "delta":
+            deltas = unpack(data, SIGNED[meta["width"]])
+            return list(itertools.accumulate(deltas, initial=meta["base"]))
+        values = unpack(data, UNSIGNED[meta["width"]])
+        if info["encoding"] == "int":
+            return [value + meta["min"] for value in values]
+        return values
+
+
+def row_mask(columns: ColumnFile, index: int, low: Optional[int], high: Optional[int]) -> Optional[List[bool]]:
+    # None when every row of the block is in the timestamp range, so the timestamp column need not be read
+    meta = columns.columns["timestamp"]["blocks"][index]
+    if (low is None or meta["min"] >= low) and (high is None or meta["max"] <= high):
+        return None
+    return [(low is None or value >= low) and (high is None or value <= high) for value in columns.block("timestamp", index)]
+
+
+def count_codes(columns: ColumnFile, column: str, low: Optional[int], high: Optional[int],
+                action: Optional[str] = None, entity_type: Optional[str] = None) -> Counter:
+    # Counts the codes of one column, optionally over the rows of one action by one entity type
+    counts: Counter = Counter()
+    action_code = columns.code("action", action) if action is not None else None
+    if action is not None and action_code is None:
+        return counts
+    entity_types = [entity[0] for entity in columns.dictionaries["entity"]]
+
+    blocks = columns.blocks_in_range("timestamp", low, high)
+    if action_code is not None:
+        # Block statistics of the action column rule out blocks without that action code in their range
+        blocks = sorted(set(blocks) & set(columns.blocks_in_range("action", action_code, action_code)))
+
+    for index in blocks:
+        keep = row_mask(columns, index, low, high)
+        if action_code is not None:
+            actions = columns.block("action", index)
+            keep = [(keep is None or keep[row]) and code == action_code for row, code in enumerate(actions)]
+        if entity_type is not None:
+            entities = columns.block("entity", index)
+            keep = [(keep is None or keep[row]) and entity_types[code] == entity_type for row, code in enumerate(entities)]
+        values = columns.block(column, index)
+        counts.update(values if keep is None else itertools.compress(values, keep))
+    return counts
+
+
+def query(columns: ColumnFile, name: str, low: Optional[int], high: Optional[int]) -> List[Tuple[str, int]]:
+    if name == "rooms":
+        counts = count_codes(columns, "room", low, high)
+        labels = columns.dictionaries["room"]
+    elif name == "evidence":
+        counts = count_codes(columns, "device", low, high, action="EVIDENCE", entity_type="hunter")
+        labels = columns.dictionaries["device"]
+    else:
+        counts = count_codes(columns, "extra", low, high, action="EXIT", entity_type="hunter")
+        labels = columns.dictionaries["extra"]
+    return [(str(labels[code]) or "(none)", count) for code, count in counts.most_common()]
+
+
+QUERY_TITLES = {
+    "rooms": "Records per room",
+    "evidence": "Evidence collected per device (hunters)",
+    "exits": "Exit reasons (hunters)",
+}
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Export Willow House logs to a columnar file and query it.")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    export = commands.add_parser("export", help="Write the run's records to a columnar file.")
+    export.add_argument("directory", nargs="?", default=".", help="Directory holding the run's logs (default: current directory).")
+    export.add_argument("--output", type=str, default=None, help="Columnar file to write (default: <directory>/events.cols).")
+    export.add_argument("--block-rows", type=int, default=DEFAULT_BLOCK_ROWS, help="Rows per block (default 65536).")
+    export.add_argument("--stream", action="store_true", help="Merge the logs while reading them instead of loading and sorting them.")
+    export.add_argument("--per-entity", action="store_true", help="Read the per-entity logs even when the run also wrote timeline.csv.")
+
+    reader = commands.add_parser("query", help="Aggregate one or two columns of a columnar file.")
+    reader.add_argument("file", help="Columnar file written by export.")
+    reader.add_argument("query", choices=sorted(QUERY_TITLES), help="Aggregate to compute.")
+    reader.add_argument("--from", dest="low", type=int, default=None, help="Only count records at or after this timestamp.")
+    reader.add_argument("--to", dest="high", type=int, default=None, help="Only count records at or before this timestamp.")
+
+    args = parser.parse_args()
+
+    if args.command == "export":
+        if not os.path.isdir(args.directory):
+            parser.error(f"{args.directory} is not a directory")
+        if args.block_rows < 1:
+            parser.error("--block-rows must be at least 1")
+        timeline = None if args.per_entity else timeline_path(args.directory)
+        entries = stream_logs(args.directory, timeline=timeline) if args.stream else parse_logs(args.directory, timeline=timeline)
+        output = args.output or os.path.join(args.directory, "events.cols")
+        rows = export_columns(entries, output, args.block_rows)
+        print(f"Exported {rows} records to {output} ({os.path.getsize(output)} bytes)")
+        return
+
+    try:
+        columns = ColumnFile(args.file)
+    except (OSError, ValueError) as error:
+        parser.error(str(error))
+    try:
+        results = query(columns, args.query, args.low, args.high)
+    finally:
+        columns.close()
+
+    print(f"{QUERY_TITLES[args.query]}:")
+    for label, count in results:
+        print(f"  {label}: {count}")
+    print(f"Read {columns.bytes_read} bytes of column data ({columns.size} bytes in the file)")
+
+
+if __name__ == "__main__":
+    main()
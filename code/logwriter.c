@@ -0,0 +1,961 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#ifdef SIM_ZLIB
+#include <zlib.h>
+#endif
+#include "defs.h"
+#include "helpers.h"
+
+// Asynchronous log writer for buffered logging (--log-writer writev|io_uring).
+// Instead of writing its batch itself, a logging thread copies its sorted lines into the shared staging buffer
+// (one span per log file and thread) and carries on. The writer thread takes the staging buffer whenever it is idle
+// or full, so batches from many threads are written together (group commit), keeps the log files open,
+// and writes each file's spans in the order they were added:
+// - io_uring: staging buffers and open files are registered with the ring, a batch is WRITE_FIXED requests on
+//   fixed files with each file's requests linked so they complete in order, completions are reaped by the writer thread
+// - writev: one writev per file and batch, gathering the file's spans (and the header of a new file)
+// io_uring is set up with raw system calls (no liburing), and falls back to writev when the kernel refuses it.
+// With --log-compress (builds with zlib) the writer thread gzip-compresses each open file's lines into log_<id>.csv.gz
+// instead, so logging threads never pay for compression. A file evicted from the open files ends its gzip member,
+// and reopening it appends a new member, which gzip readers read as one stream.
+
+#define LOG_WRITER_BUFFERS 8                    // staging buffers, logging threads wait for one when all are queued
+#define LOG_WRITER_IOV_MAX 64                   // spans gathered per writev call
+#define LOG_WRITER_BUFFER_BYTES (64 * 1024)     // matches the per-thread log buffer, so one batch always fits
+#define LOG_WRITER_FILES 256                    // open log files kept, direct-mapped by entity and segment
+#define LOG_WRITER_RING_ENTRIES 256
+#define LOG_WRITER_HEADER_MAX 128
+#define LOG_WRITER_COMPRESS_BYTES (64 * 1024)   // compressed bytes gathered per write
+#define LOG_WRITER_COMPRESS_WINDOW_BITS 12      // 4 KB window, dozens of an entity's similar lines back
+#define LOG_WRITER_COMPRESS_MEM_LEVEL 5         // about 40 KB of zlib state per open file
+
+// Lines of one log file in a staging buffer
+struct LogWriterSpan {
+    int entity_id;
+    unsigned segment;
+    size_t offset;
+    size_t length;
+    size_t done;                    // bytes io_uring wrote
+};
+
+struct LogWriterBatch {
+    int index;                      // staging buffer index, also its registered buffer index
+    char *data;
+    size_t used;
+    struct LogWriterSpan *spans;
+    int span_count;
+    int span_capacity;
+    struct LogWriterBatch *next;    // free list or queue link
+};
+
+// An open log file, fd is -1 for an empty slot
+struct LogWriterFile {
+    int entity_id;
+    unsigned segment;
+    int fd;
+    bool new_file;                  // still needs its clock header
+    unsigned long batch;            // last batch the file was written in
+#ifdef SIM_ZLIB
+    z_stream *stream;               // gzip stream of a compressed file, NULL for plain CSV
+#endif
+};
+
+// io_uring rings mapped from the kernel
+struct LogWriterRing {
+    int fd;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned pending;               // submitted or queued requests not reaped yet
+    unsigned unsubmitted;           // requests in the submission queue not passed to io_uring_enter yet
+};
+
+static enum LogWriterBackend log_writer_backend = LOG_WRITER_STDIO;
+static bool log_writer_active = false;
+static pthread_t log_writer_thread;
+static pthread_mutex_t log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_writer_work = PTHREAD_COND_INITIALIZER;     // a batch was queued or the writer should stop
+static pthread_cond_t log_writer_free = PTHREAD_COND_INITIALIZER;     // a staging buffer was returned
+static bool log_writer_stopping = false;
+
+static struct LogWriterBatch log_writer_batches[LOG_WRITER_BUFFERS];
+static struct LogWriterBatch *log_writer_filling = NULL;       // staging buffer logging threads are adding to
+static struct LogWriterBatch *log_writer_free_list = NULL;
+static struct LogWriterBatch *log_writer_queue_head = NULL;
+static struct LogWriterBatch *log_writer_queue_tail = NULL;
+
+// Owned by the writer thread after start
+static struct LogWriterFile log_writer_files[LOG_WRITER_FILES];
+static struct LogWriterRing log_writer_ring = {.fd = -1};
+static unsigned long log_writer_batch_number = 0;
+static int log_writer_unchecked = 0;           // first span whose io_uring result has not been checked
+static char log_writer_header[LOG_WRITER_HEADER_MAX];
+static size_t log_writer_header_length = 0;
+static int log_writer_compress_level = 0;      // zlib level, 0 writes plain CSV
+#ifdef SIM_ZLIB
+static unsigned char *log_writer_compressed = NULL;
+#endif
+
+// File slot of an entity's log segment
+static int log_writer_slot(int entity_id, unsigned segment) {
+
+    return (int)(((unsigned)entity_id * 31u + segment) % LOG_WRITER_FILES);
+}
+
+/*
+    Purpose:
+        Names a log writer backend, the --log-writer value.
+    Parameters:
+        - backend (in): backend
+    Returns:
+        "stdio", "writev" or "io_uring".
+*/
+const char* log_writer_backend_to_string(enum LogWriterBackend backend) {
+
+    switch (backend) {
+        case LOG_WRITER_WRITEV:
+            return "writev";
+        case LOG_WRITER_URING:
+            return "io_uring";
+        default:
+            return "stdio";
+    }
+}
+
+// ---- io_uring through raw system calls ----
+
+static int log_uring_enter(unsigned to_submit, unsigned min_complete) {
+
+    return (int)syscall(__NR_io_uring_enter, log_writer_ring.fd, to_submit, min_complete,
+                        (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static int log_uring_register(unsigned opcode, const void *arg, unsigned count) {
+
+    return (int)syscall(__NR_io_uring_register, log_writer_ring.fd, opcode, arg, count);
+}
+
+static void log_uring_teardown(void) {
+
+    struct LogWriterRing *ring = &log_writer_ring;
+
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if ((ring->cq_map != NULL) && (ring->cq_map != ring->sq_map)) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+// Creates the ring and registers the staging buffers and an empty file table, returns false when io_uring is unavailable
+static bool log_uring_setup(void) {
+
+    struct LogWriterRing *ring = &log_writer_ring;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, LOG_WRITER_RING_ENTRIES, &params);
+
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return false;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels map both rings with one mmap
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        log_uring_teardown();
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    }
+    else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            log_uring_teardown();
+            return false;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        log_uring_teardown();
+        return false;
+    }
+
+    char *sq = (char*)ring->sq_map;
+    char *cq = (char*)ring->cq_map;
+
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // Registered buffers are pinned once instead of mapped for every write
+    struct iovec buffers[LOG_WRITER_BUFFERS];
+
+    for (int i = 0; i < LOG_WRITER_BUFFERS; i++) {
+        buffers[i].iov_base = log_writer_batches[i].data;
+        buffers[i].iov_len = LOG_WRITER_BUFFER_BYTES;
+    }
+
+    // Registered files skip the file table lookup on every write, slots are filled in as log files are opened
+    int files[LOG_WRITER_FILES];
+
+    for (int i = 0; i < LOG_WRITER_FILES; i++) {
+        files[i] = -1;
+    }
+
+    if ((log_uring_register(IORING_REGISTER_BUFFERS, buffers, LOG_WRITER_BUFFERS) < 0) ||
+        (log_uring_register(IORING_REGISTER_FILES, files, LOG_WRITER_FILES) < 0)) {
+        log_uring_teardown();
+        return false;
+    }
+
+    return true;
+}
+
+// Points a registered file slot at a file descriptor (-1 to empty it)
+static bool log_uring_set_file(int slot, int fd) {
+
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = (unsigned)slot;
+    update.fds = (unsigned long long)(uintptr_t)&fd;
+
+    return log_uring_register(IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+// Writes all of a buffer with plain write calls, for short or failed asynchronous writes
+static void log_writer_write_all(int fd, const char *data, size_t length) {
+
+    while (length > 0) {
+
+        ssize_t written = write(fd, data, length);
+
+        if (written <= 0) {
+            if ((written < 0) && (errno == EINTR)) {
+                continue;
+            }
+            return;
+        }
+
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// Writes every part with writev, continuing after short writes
+static void log_writer_writev_all(int fd, struct iovec *parts, int count) {
+
+    while (count > 0) {
+
+        ssize_t written = writev(fd, parts, count);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        // Skips the parts written in full and the written start of the next one
+        while ((count > 0) && ((size_t)written >= parts->iov_len)) {
+            written -= (ssize_t)parts->iov_len;
+            parts++;
+            count--;
+        }
+
+        if (count > 0) {
+            parts->iov_base = (char*)parts->iov_base + written;
+            parts->iov_len -= (size_t)written;
+        }
+    }
+}
+
+// Submits the queued requests and waits for every pending request, then finishes short or cancelled writes in order
+static void log_uring_wait_all(struct LogWriterBatch *batch, int queued) {
+
+    struct LogWriterRing *ring = &log_writer_ring;
+
+    while (ring->pending > 0) {
+
+        int result = log_uring_enter(ring->unsubmitted, 1);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        ring->unsubmitted -= (unsigned)result;
+
+        unsigned head = *(ring->cq_head);
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+
+            const struct io_uring_cqe *cqe = ring->cqes + (head & *(ring->cq_mask));
+
+            batch->spans[cqe->user_data].done = (cqe->res > 0) ? (size_t)cqe->res : 0;
+            ring->pending--;
+        }
+
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // A short write cancels the rest of its file's chain, so writing the remainders in span order keeps the file in order
+    for (; log_writer_unchecked < queued; log_writer_unchecked++) {
+
+        const struct LogWriterSpan *span = batch->spans + log_writer_unchecked;
+
+        if (span->done < span->length) {
+
+            const struct LogWriterFile *file = log_writer_files + log_writer_slot(span->entity_id, span->segment);
+            log_writer_write_all(file->fd, batch->data + span->offset + span->done, span->length - span->done);
+        }
+    }
+}
+
+// Queues one WRITE_FIXED of a span to a registered file, linked to the file's next span when link is set
+static void log_uring_queue_write(struct LogWriterBatch *batch, int span_index, int slot, bool link) {
+
+    struct LogWriterRing *ring = &log_writer_ring;
+
+    // A full submission queue is drained first, a chain split here is still ordered because the first part completes first
+    if (ring->pending == LOG_WRITER_RING_ENTRIES) {
+        log_uring_wait_all(batch, span_index);
+    }
+
+    struct LogWriterSpan *span = batch->spans + span_index;
+    unsigned tail = *(ring->sq_tail);
+    unsigned index = tail & *(ring->sq_mask);
+    struct io_uring_sqe *sqe = ring->sqes + index;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE | (link ? IOSQE_IO_LINK : 0);
+    sqe->fd = slot;
+    sqe->off = (unsigned long long)-1;          // current position, the file is opened with O_APPEND
+    sqe->addr = (unsigned long long)(uintptr_t)(batch->data + span->offset);
+    sqe->len = (unsigned)span->length;
+    sqe->buf_index = (unsigned short)batch->index;
+    sqe->user_data = (unsigned long long)span_index;
+
+    span->done = 0;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ring->pending++;
+    ring->unsubmitted++;
+}
+
+// ---- gzip compression (--log-compress) ----
+
+#ifdef SIM_ZLIB
+
+// Starts a gzip member for a newly opened file
+static bool log_writer_deflate_start(struct LogWriterFile *file) {
+
+    file->stream = (z_stream*)calloc(1, sizeof(z_stream));
+    alloc_count_add();
+
+    if (file->stream == NULL) {
+        return false;
+    }
+
+    // 16 added to the window bits writes a gzip header and trailer instead of a zlib one
+    if (deflateInit2(file->stream, log_writer_compress_level, Z_DEFLATED, LOG_WRITER_COMPRESS_WINDOW_BITS + 16,
+                     LOG_WRITER_COMPRESS_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(file->stream);
+        file->stream = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// Compresses data into the file's stream, writing the compressed bytes out whenever the output buffer fills
+static void log_writer_deflate(struct LogWriterFile *file, const char *data, size_t length, int flush) {
+
+    z_stream *stream = file->stream;
+
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)length;
+
+    // Z_NO_FLUSH consumes all the input unless the output buffer fills, Z_FINISH leaves room once the trailer is out
+    do {
+        stream->next_out = log_writer_compressed;
+        stream->avail_out = LOG_WRITER_COMPRESS_BYTES;
+
+        deflate(stream, flush);
+
+        log_writer_write_all(file->fd, (const char*)log_writer_compressed, LOG_WRITER_COMPRESS_BYTES - stream->avail_out);
+    } while (stream->avail_out == 0);
+}
+
+// Compresses a file's spans [first, end), a new file's header first
+static void log_writer_deflate_file(struct LogWriterFile *file, const struct LogWriterBatch *batch, int first, int end) {
+
+    if (file->new_file) {
+        log_writer_deflate(file, log_writer_header, log_writer_header_length, Z_NO_FLUSH);
+        file->new_file = false;
+    }
+
+    for (int i = first; i < end; i++) {
+        log_writer_deflate(file, batch->data + batch->spans[i].offset, batch->spans[i].length, Z_NO_FLUSH);
+    }
+}
+
+#endif
+
+/*
+    Purpose:
+        Makes the writer thread gzip-compress the log files (log_<id>.csv.gz), called before log_writer_start.
+    Parameters:
+        - level (in): zlib level 1 (fastest) to 9 (smallest), 0 for plain CSV
+    Returns:
+        true if set, false when compression was asked for in a build without zlib.
+*/
+bool log_writer_set_compression(int level) {
+
+#ifdef SIM_ZLIB
+    log_writer_compress_level = level;
+    return true;
+#else
+    log_writer_compress_level = 0;
+    return level == 0;
+#endif
+}
+
+// Ends a compressed file's gzip member, then closes the file
+static void log_writer_close_file(struct LogWriterFile *file) {
+
+#ifdef SIM_ZLIB
+    if (file->stream != NULL) {
+        log_writer_deflate(file, NULL, 0, Z_FINISH);
+        deflateEnd(file->stream);
+        free(file->stream);
+        file->stream = NULL;
+    }
+#endif
+
+    close(file->fd);
+    file->fd = -1;
+}
+
+// ---- Writer thread ----
+
+// Returns the open file slot for an entity's log segment, opening the file (and replacing the slot's old file) if needed
+static struct LogWriterFile *log_writer_file(struct LogWriterBatch *batch, int span_index, int *slot_out) {
+
+    const struct LogWriterSpan *span = batch->spans + span_index;
+    int slot = log_writer_slot(span->entity_id, span->segment);
+    struct LogWriterFile *file = log_writer_files + slot;
+
+    *slot_out = slot;
+
+    if ((file->fd >= 0) && (file->entity_id == span->entity_id) && (file->segment == span->segment)) {
+        return file;
+    }
+
+    // The slot's old file may still have writes of this batch in flight
+    if ((file->fd >= 0) && (log_writer_backend == LOG_WRITER_URING) && (file->batch == log_writer_batch_number)) {
+        log_uring_wait_all(batch, span_index);
+    }
+
+    if (file->fd >= 0) {
+        log_writer_close_file(file);
+    }
+
+    char path[512];
+    int length = log_file_path(span->entity_id, span->segment, path, sizeof(path));
+
+    if ((length < 0) || ((log_writer_compress_level > 0) && ((size_t)length + 3 >= sizeof(path)))) {
+        return NULL;
+    }
+
+    if (log_writer_compress_level > 0) {
+        strcat(path, ".gz");
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat info;
+
+    file->entity_id = span->entity_id;
+    file->segment = span->segment;
+    file->fd = fd;
+    file->new_file = (fstat(fd, &info) == 0) && (info.st_size == 0) && (log_writer_header_length > 0);
+    file->batch = 0;
+
+#ifdef SIM_ZLIB
+    if ((log_writer_compress_level > 0) && !log_writer_deflate_start(file)) {
+        close(fd);
+        file->fd = -1;
+        return NULL;
+    }
+#endif
+
+    if (log_writer_backend == LOG_WRITER_URING) {
+
+        // Fixed file requests use the slot, the header is written before any of them
+        if (file->new_file) {
+            log_writer_write_all(fd, log_writer_header, log_writer_header_length);
+            file->new_file = false;
+        }
+
+        if (!log_uring_set_file(slot, fd)) {
+            close(fd);
+            file->fd = -1;
+            return NULL;
+        }
+    }
+
+    return file;
+}
+
+// Orders spans by log file, keeping each file's spans in the order they were added
+static int log_writer_span_compare(const void *a, const void *b) {
+
+    const struct LogWriterSpan *x = (const struct LogWriterSpan*)a;
+    const struct LogWriterSpan *y = (const struct LogWriterSpan*)b;
+
+    if (x->entity_id != y->entity_id) {
+        return (x->entity_id < y->entity_id) ? -1 : 1;
+    }
+    if (x->segment != y->segment) {
+        return (x->segment < y->segment) ? -1 : 1;
+    }
+
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Writes a file's spans [first, end) with writev, a new file's header first
+static void log_writer_writev_file(struct LogWriterFile *file, const struct LogWriterBatch *batch, int first, int end) {
+
+    struct iovec parts[LOG_WRITER_IOV_MAX];
+    int count = 0;
+
+    if (file->new_file) {
+        parts[count].iov_base = log_writer_header;
+        parts[count].iov_len = log_writer_header_length;
+        count++;
+        file->new_file = false;
+    }
+
+    for (int i = first; i < end; i++) {
+
+        if (count == LOG_WRITER_IOV_MAX) {
+            log_writer_writev_all(file->fd, parts, count);
+            count = 0;
+        }
+
+        parts[count].iov_base = batch->data + batch->spans[i].offset;
+        parts[count].iov_len = batch->spans[i].length;
+        count++;
+    }
+
+    log_writer_writev_all(file->fd, parts, count);
+}
+
+// Writes every span of a batch to its log file
+static void log_writer_write_batch(struct LogWriterBatch *batch) {
+
+    log_writer_batch_number++;
+    log_writer_unchecked = 0;
+
+    qsort(batch->spans, (size_t)batch->span_count, sizeof(struct LogWriterSpan), log_writer_span_compare);
+
+    int first = 0;
+
+    while (first < batch->span_count) {
+
+        const struct LogWriterSpan *span = batch->spans + first;
+        int end = first + 1;
+
+        while ((end < batch->span_count) && (batch->spans[end].entity_id == span->entity_id) && (batch->spans[end].segment == span->segment)) {
+            end++;
+        }
+
+        int slot = 0;
+        struct LogWriterFile *file = log_writer_file(batch, first, &slot);
+
+        if (file != NULL) {
+
+            file->batch = log_writer_batch_number;
+
+            if (log_writer_backend == LOG_WRITER_URING) {
+                for (int i = first; i < end; i++) {
+                    log_uring_queue_write(batch, i, slot, i + 1 < end);
+                }
+            }
+#ifdef SIM_ZLIB
+            else if (file->stream != NULL) {
+                log_writer_deflate_file(file, batch, first, end);
+            }
+#endif
+            else {
+                log_writer_writev_file(file, batch, first, end);
+            }
+        }
+        else if (log_writer_backend == LOG_WRITER_URING) {
+
+            // Nothing is queued for a file that cannot be opened, its spans count as checked
+            for (int i = first; i < end; i++) {
+                batch->spans[i].done = batch->spans[i].length;
+            }
+        }
+
+        first = end;
+    }
+
+    if (log_writer_backend == LOG_WRITER_URING) {
+        log_uring_wait_all(batch, batch->span_count);
+    }
+}
+
+// Writes queued batches, or the staging buffer being filled when nothing is queued, until log_writer_stop
+static void *log_writer_main(void *arg) {
+
+    (void)arg;
+
+    pthread_mutex_lock(&log_writer_mutex);
+
+    while (true) {
+
+        while ((log_writer_queue_head == NULL) && ((log_writer_filling == NULL) || (log_writer_filling->used == 0)) && !log_writer_stopping) {
+            pthread_cond_wait(&log_writer_work, &log_writer_mutex);
+        }
+
+        struct LogWriterBatch *batch = log_writer_queue_head;
+
+        if (batch != NULL) {
+            log_writer_queue_head = batch->next;
+            if (log_writer_queue_head == NULL) {
+                log_writer_queue_tail = NULL;
+            }
+        }
+        else if ((log_writer_filling != NULL) && (log_writer_filling->used > 0)) {
+            batch = log_writer_filling;
+            log_writer_filling = NULL;
+        }
+        else {
+            break;
+        }
+
+        pthread_mutex_unlock(&log_writer_mutex);
+
+        log_writer_write_batch(batch);
+
+        pthread_mutex_lock(&log_writer_mutex);
+
+        batch->next = log_writer_free_list;
+        log_writer_free_list = batch;
+        pthread_cond_signal(&log_writer_free);
+    }
+
+    pthread_mutex_unlock(&log_writer_mutex);
+
+    return 0;
+}
+
+/*
+    Purpose:
+        Starts the writer thread for buffered logging, falling back from io_uring to writev when io_uring cannot be set up.
+        Must be called before any thread logs, after the log directory and timestamp mode are set.
+    Parameters:
+        - requested (in): LOG_WRITER_WRITEV or LOG_WRITER_URING, LOG_WRITER_STDIO does nothing
+    Returns:
+        Backend that was started, LOG_WRITER_STDIO when none was (logging threads then write their batches themselves).
+*/
+enum LogWriterBackend log_writer_start(enum LogWriterBackend requested) {
+
+    if (requested == LOG_WRITER_STDIO) {
+        return LOG_WRITER_STDIO;
+    }
+
+    for (int i = 0; i < LOG_WRITER_BUFFERS; i++) {
+
+        struct LogWriterBatch *batch = log_writer_batches + i;
+
+        // Page-aligned so the registered buffers pin whole pages
+        if (posix_memalign((void**)&(batch->data), 4096, LOG_WRITER_BUFFER_BYTES) != 0) {
+            printf("\nERROR: Memory allocation error... \n");
+            return LOG_WRITER_STDIO;
+        }
+        alloc_count_add();
+
+        batch->index = i;
+        batch->next = log_writer_free_list;
+        log_writer_free_list = batch;
+    }
+
+    for (int i = 0; i < LOG_WRITER_FILES; i++) {
+        log_writer_files[i].fd = -1;
+    }
+
+    int header_length = log_file_header(log_writer_header, sizeof(log_writer_header));
+    log_writer_header_length = (header_length > 0) ? (size_t)header_length : 0;
+
+    log_writer_backend = LOG_WRITER_WRITEV;
+
+#ifdef SIM_ZLIB
+    // Compressed bytes come from one reused output buffer, so compressed files are written with write()
+    if (log_writer_compress_level > 0) {
+
+        log_writer_compressed = (unsigned char*)malloc(LOG_WRITER_COMPRESS_BYTES);
+        alloc_count_add();
+
+        if (log_writer_compressed == NULL) {
+            printf("\nERROR: Memory allocation error... \n");
+            return LOG_WRITER_STDIO;
+        }
+
+        if (requested == LOG_WRITER_URING) {
+            fprintf(stderr, "Compressed logs are written with write(), not io_uring\n");
+            requested = LOG_WRITER_WRITEV;
+        }
+    }
+#endif
+
+    if (requested == LOG_WRITER_URING) {
+
+        if (log_uring_setup()) {
+            log_writer_backend = LOG_WRITER_URING;
+        }
+        else {
+            fprintf(stderr, "io_uring is unavailable (%s), logging with writev\n", strerror(errno));
+        }
+    }
+
+    log_writer_stopping = false;
+
+    if (pthread_create(&log_writer_thread, NULL, log_writer_main, NULL) != 0) {
+        printf("\nERROR: Log writer thread could not be started...\n");
+        log_uring_teardown();
+        return LOG_WRITER_STDIO;
+    }
+
+    log_writer_active = true;
+
+    return log_writer_backend;
+}
+
+/*
+    Purpose:
+        Checks whether batches go to the writer thread.
+    Returns:
+        true between log_writer_start and log_writer_stop.
+*/
+bool log_writer_running(void) {
+
+    return log_writer_active;
+}
+
+/*
+    Purpose:
+        Starts adding a thread's lines to the staging buffer, the lines of one call to log_writer_append_end stay together.
+*/
+void log_writer_append_begin(void) {
+
+    pthread_mutex_lock(&log_writer_mutex);
+}
+
+/*
+    Purpose:
+        Copies a line into the staging buffer, queueing a full staging buffer and waiting for a free one if needed.
+        Lines must be added grouped by entity and segment, in the order they go into the file.
+        Only called between log_writer_append_begin and log_writer_append_end.
+    Parameters:
+        - entity_id (in): hunter or ghost ID
+        - segment (in): log segment of the line
+        - line (in): formatted line
+        - length (in): line length in bytes, at most 64 KB
+    Returns:
+        true if the line was added, false if memory ran out (the caller writes the line itself).
+*/
+bool log_writer_append(int entity_id, unsigned segment, const char *line, size_t length) {
+
+    struct LogWriterBatch *batch = log_writer_filling;
+
+    // A full staging buffer goes to the writer thread as it is
+    if ((batch != NULL) && (batch->used + length > LOG_WRITER_BUFFER_BYTES)) {
+
+        if (log_writer_queue_tail != NULL) {
+            log_writer_queue_tail->next = batch;
+        }
+        else {
+            log_writer_queue_head = batch;
+        }
+        log_writer_queue_tail = batch;
+
+        pthread_cond_signal(&log_writer_work);
+        batch = NULL;
+        log_writer_filling = NULL;
+    }
+
+    if (batch == NULL) {
+
+        while (log_writer_free_list == NULL) {
+            pthread_cond_wait(&log_writer_free, &log_writer_mutex);
+        }
+
+        // The writer may have taken the staging buffer while this thread waited
+        if (log_writer_filling != NULL) {
+            return log_writer_append(entity_id, segment, line, length);
+        }
+
+        batch = log_writer_free_list;
+        log_writer_free_list = batch->next;
+
+        batch->used = 0;
+        batch->span_count = 0;
+        batch->next = NULL;
+        log_writer_filling = batch;
+    }
+
+    struct LogWriterSpan *last = (batch->span_count > 0) ? batch->spans + batch->span_count - 1 : NULL;
+
+    // Consecutive lines of one file extend its span
+    if ((last == NULL) || (last->entity_id != entity_id) || (last->segment != segment)) {
+
+        if (batch->span_count == batch->span_capacity) {
+
+            int new_capacity = batch->span_capacity ? batch->span_capacity * 2 : 64;
+            struct LogWriterSpan *spans = (struct LogWriterSpan*)realloc(batch->spans, (size_t)new_capacity * sizeof(struct LogWriterSpan));
+            alloc_count_add();
+
+            if (spans == NULL) {
+                return false;
+            }
+
+            batch->spans = spans;
+            batch->span_capacity = new_capacity;
+        }
+
+        last = batch->spans + batch->span_count++;
+        last->entity_id = entity_id;
+        last->segment = segment;
+        last->offset = batch->used;
+        last->length = 0;
+    }
+
+    memcpy(batch->data + batch->used, line, length);
+    batch->used += length;
+    last->length += length;
+
+    return true;
+}
+
+/*
+    Purpose:
+        Finishes adding a thread's lines and wakes the writer thread, which writes them with whatever else was added meanwhile.
+*/
+void log_writer_append_end(void) {
+
+    pthread_cond_signal(&log_writer_work);
+    pthread_mutex_unlock(&log_writer_mutex);
+}
+
+/*
+    Purpose:
+        Writes out every queued line, stops the writer thread and closes the log files (ending their gzip streams). Called after the logging threads are done.
+*/
+void log_writer_stop(void) {
+
+    if (!log_writer_active) {
+        return;
+    }
+
+    pthread_mutex_lock(&log_writer_mutex);
+    log_writer_stopping = true;
+    pthread_cond_signal(&log_writer_work);
+    pthread_mutex_unlock(&log_writer_mutex);
+
+    pthread_join(log_writer_thread, NULL);
+    log_writer_active = false;
+
+    for (int i = 0; i < LOG_WRITER_FILES; i++) {
+        if (log_writer_files[i].fd >= 0) {
+            log_writer_close_file(log_writer_files + i);
+        }
+    }
+
+    log_uring_teardown();
+
+#ifdef SIM_ZLIB
+    free(log_writer_compressed);
+    log_writer_compressed = NULL;
+#endif
+
+    for (int i = 0; i < LOG_WRITER_BUFFERS; i++) {
+        free(log_writer_batches[i].data);
+        free(log_writer_batches[i].spans);
+        memset(log_writer_batches + i, 0, sizeof(struct LogWriterBatch));
+    }
+
+    log_writer_filling = NULL;
+    log_writer_free_list = NULL;
+    log_writer_queue_head = NULL;
+    log_writer_queue_tail = NULL;
+    log_writer_backend = LOG_WRITER_STDIO;
+}
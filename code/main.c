@@ -1,14 +1,64 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "defs.h"
 #include "helpers.h"
 
+// Command line options for a simulation run
+typedef struct RunOptions {
+    unsigned seed;                  // base seed for all PRNG streams, 0 seeds from the clock
+    bool single_thread;             // runs every entity on the main thread instead of one thread each
+    const char *checkpoint_path;    // file checkpoints are written to, NULL for none (only the final state outside the single-threaded engine)
+    long checkpoint_every;          // rounds between checkpoints (single-threaded engine only)
+    const char *resume_path;        // checkpoint file to resume from, NULL to start a new run
+    const char *record_path;        // decision trace to record to, NULL for none
+    const char *replay_path;        // decision trace to replay from, NULL for none
+    bool log_files;                 // writes log_<id>.csv files
+    bool log_buffered;              // batches log records per thread instead of opening the log file for each one
+    enum LogWriterBackend log_writer;   // writes buffered batches from the logging threads or from a writer thread
+    long log_index;                 // records between sparse log index entries, 0 for no index
+    int log_compress_level;         // zlib level the writer thread compresses the log files with, 0 for plain CSV
+    long log_mmap_mb;               // size of the shared memory-mapped log segments in MB, 0 for per-entity log files
+    bool timeline;                  // writes the globally ordered timeline.csv
+    const char* log_filter;         // actions, entities and sampling of the records written to the log files, NULL for all
+    bool entity_logs;               // writes the per-entity logs (off with --timeline-only)
+    bool log_pause;                 // pauses briefly after each log record
+    long log_max_lines;             // per-entity log line cap, 0 for none
+    long log_max_total;             // log line cap over all entities, 0 for none
+    bool log_cap_exit;              // exits at a log cap instead of dropping records and simulating on
+    long log_rotate_lines;          // lines per log segment, 0 for no line-based rotation
+    long log_rotate_bytes;          // bytes per log segment, 0 for no size-based rotation
+    const char *output_dir;         // directory run directories are created in, NULL for the current directory
+    const char *run_id;             // run identifier naming the run's log directory, NULL to generate one with --output-dir
+    bool log_ms_timestamps;         // legacy wall-clock millisecond log timestamps (with the pause) instead of nanoseconds
+    enum LogVerbosity verbosity;    // console output of the log functions
+    int hunter_count;               // creates this many hunters without prompting, 0 to ask the user
+    int room_count;                 // rooms in a generated layout, 0 for Willow House
+    int worker_count;               // threads in the worker pool, 0 for one thread per entity
+    bool stats;                     // prints run statistics to stderr when the run ends
+    bool latency;                   // times every turn and prints latency percentiles with the results
+    const char *trace_events_path;  // Trace Event Format JSON file of the run's activity, NULL for none
+    const char *metrics_socket;     // Unix socket serving live metrics snapshots during the run, NULL for none
+    const char *results_path;       // file the run's results are appended to, NULL for none
+    enum ResultsFormat results_format;  // format of the results file
+    int flight_records;             // flight recorder records kept per thread, 0 turns the recorder off
+    const char *flight_dump_path;   // file the flight recorder is dumped to, NULL for flight_recorder.csv in the log directory
+    long watchdog_ms;               // dumps the flight recorder after this long without a turn, 0 for no watchdog
+} RunOptions;
+
 int run_test_functions(House *house);
+int create_run_directory(const RunOptions *options, char *run_id, size_t run_id_size);
+int parse_args(int argc, char *argv[], RunOptions *options);
 int get_hunters(House *house);
+int create_hunters(House *house, int hunter_count);
+void run_threads(House *house);
 void results_print(House *house);
 
-int main() {
+int main(int argc, char *argv[]) {
 
     /*
     1. Initialize a House structure.
@@ -23,6 +73,70 @@ int main() {
     7. Clean up all dynamically allocated resources and call sem_destroy() on all semaphores.
     */
 
+    RunOptions options;                         // command line options
+    if (!parse_args(argc, argv, &options)) {
+        exit(1);
+    }
+
+    // Namespaces this run's log files in their own directory when an output directory or run ID was given
+    char run_id[128] = "";
+    if (((options.output_dir != NULL) || (options.run_id != NULL)) && !create_run_directory(&options, run_id, sizeof(run_id))) {
+        exit(1);
+    }
+
+    rand_set_base_seed(options.seed);
+    log_set_file_output(options.log_files);
+    log_set_buffered(options.log_buffered);
+    log_set_record_pause(options.log_pause);
+    log_set_ms_timestamps(options.log_ms_timestamps);
+    log_set_limits(options.log_max_lines, options.log_max_total, options.log_cap_exit);
+    log_set_rotation(options.log_rotate_lines, options.log_rotate_bytes);
+    log_set_index(options.log_index, options.log_compress_level == 0);
+    log_set_verbosity(options.verbosity);
+    latency_set_enabled(options.latency);
+
+    // Tells validators which actions the filter left out or sampled
+    if (options.log_files && !log_write_filter_note()) {
+        exit(1);
+    }
+
+    // Writes every record to one globally ordered timeline, alongside or instead of the per-entity logs
+    log_set_entity_output(options.entity_logs);
+    if (options.timeline && options.log_files && !timeline_open()) {
+        exit(1);
+    }
+
+    // Logs every entity into shared memory-mapped segments instead of log_<id>.csv files
+    if ((options.log_mmap_mb > 0) && options.log_files && options.entity_logs && !mmap_log_open((size_t)options.log_mmap_mb * 1024 * 1024)) {
+        exit(1);
+    }
+
+    // Hands buffered batches to a writer thread (io_uring falls back to writev when the kernel does not allow it)
+    if ((options.log_writer != LOG_WRITER_STDIO) && options.log_files && options.entity_logs) {
+        log_writer_start(options.log_writer);
+    }
+
+    // Keeps the last log records of every thread in memory, dumped if the run crashes, is killed or exits early
+    char flight_path[512];
+    if (options.flight_dump_path != NULL) {
+        snprintf(flight_path, sizeof(flight_path), "%s", options.flight_dump_path);
+    }
+    else {
+        const char *log_dir = log_get_directory();
+        snprintf(flight_path, sizeof(flight_path), "%s%sflight_recorder.csv", log_dir, (log_dir[0] != '\0') ? "/" : "");
+    }
+    if (!flight_recorder_start(options.flight_records, flight_path)) {
+        exit(1);
+    }
+
+    // Sets up decision trace (replay restores the seed the trace was recorded with)
+    if ((options.record_path != NULL) && !decision_trace_record(options.record_path)) {
+        exit(1);
+    }
+    if ((options.replay_path != NULL) && !decision_trace_replay(options.replay_path)) {
+        exit(1);
+    }
+
     // Project with house allocated on stack
     House house;                                // house structure 
     int success;                                // flag for error checking
@@ -32,54 +146,561 @@ int main() {
         exit(0);
     }
 
-    house_populate_rooms(&house);               // populates house structure with rooms
+    // Resumes a previous run from its checkpoint instead of creating a new one
+    if (options.resume_path != NULL) {
 
-    success = house_load_data(&house);          // initializes ghost data, dynamic hunter array, case file, etc.
-    if (!success) {
-        exit(0);
-    }
+        success = house_checkpoint_load(&house, options.resume_path);
+        if (!success) {
+            exit(1);
+        }
 
-    success = get_hunters(&house);              // gets hunter data from user and appends hunters to house
-    if (!success) {
-        exit(0);
+        // Tells validators which layout the logged moves go through
+        if (options.log_files && !house_write_room_graph(&house)) {
+            exit(1);
+        }
     }
+    else {
 
-    // Creates ghost thread
-    pthread_create(&(house.ghost.thread), NULL, ghost_thread, &(house.ghost));     
+        // Populates house structure with rooms, Willow House unless a generated layout was requested
+        if (options.room_count > 0) {
+            success = house_generate_rooms(&house, options.room_count);
+        }
+        else {
+            house_populate_rooms(&house);
+        }
+        if (!success) {
+            exit(1);
+        }
+
+        // Written before any record is logged, so that a validator following the run has it from the start
+        if (options.log_files && !house_write_room_graph(&house)) {
+            exit(1);
+        }
+
+        success = house_load_data(&house);          // initializes ghost data, dynamic hunter array, case file, etc.
+        if (!success) {
+            exit(0);
+        }
+
+        // Replay recreates the recorded hunters, otherwise gets hunter data from user and appends hunters to house
+        if (options.replay_path != NULL) {
+            success = decision_trace_create_hunters(&house);
+        }
+        else if (options.hunter_count > 0) {
+            success = create_hunters(&house, options.hunter_count);
+        }
+        else {
+            success = get_hunters(&house);
+        }
+        if (!success) {
+            exit(0);
+        }
+    }
 
-    // Creates hunter threads
-    for (int i = 0; i < house.hunter_arr.hunter_count; i++) {
+    // Starts the activity trace, tracks are named after the house's entities when it is closed
+    if ((options.trace_events_path != NULL) && !trace_events_open(options.trace_events_path, &house)) {
+        exit(1);
+    }
 
-        Hunter *hunter = house.hunter_arr.hunters[i];       // gets hunter pointer
+    // Serves live snapshots of the run until the entity threads finish
+    if ((options.metrics_socket != NULL) && !metrics_server_start(options.metrics_socket, &house)) {
+        exit(1);
+    }
 
-        pthread_create(&(hunter->thread), NULL, hunter_thread, hunter);
+    // Dumps the flight recorder if the simulation stops taking turns
+    if (!flight_watchdog_start(&house, options.watchdog_ms)) {
+        exit(1);
     }
 
-    // Waits for ghost thread to complete
-    pthread_join(house.ghost.thread, NULL);
+    log_flush();                                // writes out initialization records before entity threads start logging
 
-    // Waits for all hunter threads to complete
-    for (int i = 0; i < house.hunter_arr.hunter_count; i++) {
+    struct timespec run_start, run_end;
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
 
-        Hunter *hunter = house.hunter_arr.hunters[i];       // gets hunter pointer
+    // Runs simulation on the main thread, on a pool of worker threads or with one thread per entity
+    if (options.single_thread) {
+        house_run_single_thread(&house, options.checkpoint_every, options.checkpoint_path);
+    }
+    else if (options.worker_count > 0) {
+        house_run_workers(&house, options.worker_count);
+    }
+    else {
+        run_threads(&house);
+    }
 
-        pthread_join(hunter->thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &run_end);
+    long long run_ns = (long long)(run_end.tv_sec - run_start.tv_sec) * 1000000000LL + (run_end.tv_nsec - run_start.tv_nsec);
+    log_flush();
+    log_writer_stop();                          // waits until every queued batch is in the log files
+    mmap_log_close();                           // truncates the memory-mapped segments to the bytes used
+    timeline_close();                           // writes the rest of the timeline
+    flight_recorder_stop();                     // the run ended normally, exits from here on are not dumped
+    trace_events_close();
+    metrics_server_stop();
+
+    // Machine-readable line for the scenario benchmark driver
+    if (options.stats) {
+        fprintf(stderr, "SIM_STATS turns=%ld rounds=%ld hunters=%d rooms=%d run_ns=%lld allocs=%ld",
+                house_turn_count(&house), house.round_count, house.hunter_arr.hunter_count, house.room_count, run_ns, alloc_count_get());
+#ifdef SIM_LOCK_STATS
+        fprintf(stderr, " lock_wait_ns=%lld", lockstats_total_wait_ns());
+#endif
+        fprintf(stderr, "\n");
+    }
+
+    // Saves the final state when a checkpoint file was requested
+    if (options.checkpoint_path != NULL) {
+        house_checkpoint_save(&house, options.checkpoint_path);
     }
 
     // RUN TEST FUNCTIONS
     // run_test_functions(&house);
 
+    decision_trace_close();
+
     // Print results screen
     results_print(&house);
 
+    // Appends the same results to the results file for batch pipelines
+    if (options.results_path != NULL) {
+        results_write(options.results_path, options.results_format, &house, run_ns, run_id);
+    }
+
+    latency_report(&house);                     // prints turn latency percentiles when run with --latency
+
+    LOCK_STATS_REPORT(&house);                  // prints lock contention when built with make LOCKSTATS=1
+
+    CHECK_REPORT();                             // prints invariant violations when built with make CHECKS=1
+
     house_cleanup_stack(&house);               // frees dynamically allocated memory for the house structure fields
 
     return 0;
 }
 
+// Parses command line options, prints usage and returns C_ERR on bad input
+int parse_args(int argc, char *argv[], RunOptions *options) {
+
+    options->seed = 0;
+    options->single_thread = false;
+    options->checkpoint_path = NULL;
+    options->checkpoint_every = 0;
+    options->resume_path = NULL;
+    options->record_path = NULL;
+    options->replay_path = NULL;
+    options->log_files = true;
+    options->log_buffered = false;
+    options->log_writer = LOG_WRITER_STDIO;
+    options->log_compress_level = 0;
+    options->log_index = 0;
+    options->log_mmap_mb = 0;
+    options->timeline = false;
+    options->log_filter = NULL;
+    options->entity_logs = true;
+    options->log_pause = true;
+    options->log_ms_timestamps = false;
+    options->output_dir = NULL;
+    options->run_id = NULL;
+    options->log_max_lines = 100000;
+    options->log_max_total = 0;
+    options->log_cap_exit = false;
+    options->log_rotate_lines = 0;
+    options->log_rotate_bytes = 0;
+    options->verbosity = LOG_VERBOSITY_FULL;
+
+    // GHOST_HUNT_VERBOSITY sets the default console verbosity, --verbosity overrides it
+    const char *verbosity_env = getenv("GHOST_HUNT_VERBOSITY");
+    if ((verbosity_env != NULL) && !log_parse_verbosity(verbosity_env, &(options->verbosity))) {
+        printf("ERROR: GHOST_HUNT_VERBOSITY must be silent, summary or full\n");
+        return C_ERR;
+    }
+    options->hunter_count = 0;
+    options->room_count = 0;
+    options->worker_count = 0;
+    options->stats = false;
+    options->latency = false;
+    options->trace_events_path = NULL;
+    options->metrics_socket = NULL;
+    options->results_path = NULL;
+    options->results_format = RESULTS_JSON;
+    options->flight_records = 256;
+    options->flight_dump_path = NULL;
+    options->watchdog_ms = 0;
+
+    bool results_format_set = false;
+
+    for (int i = 1; i < argc; i++) {
+
+        const char *arg = argv[i];
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(arg, "--seed") == 0) && has_value) {
+            options->seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--single-thread") == 0) {
+            options->single_thread = true;
+        }
+        else if ((strcmp(arg, "--checkpoint") == 0) && has_value) {
+            options->checkpoint_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--checkpoint-every") == 0) && has_value) {
+            options->checkpoint_every = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--resume") == 0) && has_value) {
+            options->resume_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--record") == 0) && has_value) {
+            options->record_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--replay") == 0) && has_value) {
+            options->replay_path = argv[++i];
+        }
+        else if (strcmp(arg, "--no-log") == 0) {
+            options->log_files = false;
+        }
+        else if (strcmp(arg, "--log-buffered") == 0) {
+            options->log_buffered = true;
+        }
+        else if ((strcmp(arg, "--log-writer") == 0) && has_value && (strcmp(argv[i + 1], "stdio") == 0)) {
+            options->log_writer = LOG_WRITER_STDIO;
+            i++;
+        }
+        else if ((strcmp(arg, "--log-writer") == 0) && has_value && (strcmp(argv[i + 1], "writev") == 0)) {
+            options->log_writer = LOG_WRITER_WRITEV;
+            options->log_buffered = true;       // the writer thread writes batches, so logging is buffered
+            i++;
+        }
+        else if ((strcmp(arg, "--log-writer") == 0) && has_value && (strcmp(argv[i + 1], "io_uring") == 0)) {
+            options->log_writer = LOG_WRITER_URING;
+            options->log_buffered = true;
+            i++;
+        }
+        else if ((strcmp(arg, "--log-index") == 0) && has_value) {
+            options->log_index = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--log-compress") == 0) {
+            options->log_compress_level = 1;
+        }
+        else if ((strcmp(arg, "--log-compress-level") == 0) && has_value) {
+            char *end;
+            long level = strtol(argv[++i], &end, 10);
+
+            // 0 (plain CSV) and trailing junk are rejected below like any other level outside 1 to 9
+            options->log_compress_level = ((*end == '\0') && (level >= 1) && (level <= 9)) ? (int)level : -1;
+        }
+        else if (strcmp(arg, "--no-log-pause") == 0) {
+            options->log_pause = false;
+        }
+        else if ((strcmp(arg, "--output-dir") == 0) && has_value) {
+            options->output_dir = argv[++i];
+        }
+        else if ((strcmp(arg, "--run-id") == 0) && has_value) {
+            options->run_id = argv[++i];
+        }
+        else if ((strcmp(arg, "--log-filter") == 0) && has_value) {
+            options->log_filter = argv[++i];
+        }
+        else if (strcmp(arg, "--timeline") == 0) {
+            options->timeline = true;
+        }
+        else if (strcmp(arg, "--timeline-only") == 0) {
+            options->timeline = true;
+            options->entity_logs = false;
+        }
+        else if (strcmp(arg, "--log-mmap") == 0) {
+            options->log_mmap_mb = 64;
+        }
+        else if ((strcmp(arg, "--log-mmap-segment-mb") == 0) && has_value) {
+            options->log_mmap_mb = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--log-max-lines") == 0) && has_value) {
+            options->log_max_lines = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--log-max-total") == 0) && has_value) {
+            options->log_max_total = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--log-cap-policy") == 0) && has_value && ((strcmp(argv[i + 1], "stop") == 0) || (strcmp(argv[i + 1], "exit") == 0))) {
+            options->log_cap_exit = (strcmp(argv[++i], "exit") == 0);
+        }
+        else if ((strcmp(arg, "--log-rotate-lines") == 0) && has_value) {
+            options->log_rotate_lines = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--log-rotate-bytes") == 0) && has_value) {
+            options->log_rotate_bytes = strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(arg, "--log-timestamps") == 0) && has_value && ((strcmp(argv[i + 1], "ns") == 0) || (strcmp(argv[i + 1], "ms") == 0))) {
+            options->log_ms_timestamps = (strcmp(argv[++i], "ms") == 0);
+        }
+        else if ((strcmp(arg, "--verbosity") == 0) && has_value && log_parse_verbosity(argv[i + 1], &(options->verbosity))) {
+            i++;
+        }
+        else if ((strcmp(arg, "--hunters") == 0) && has_value) {
+            options->hunter_count = atoi(argv[++i]);
+        }
+        else if ((strcmp(arg, "--rooms") == 0) && has_value) {
+            options->room_count = atoi(argv[++i]);
+        }
+        else if ((strcmp(arg, "--threads") == 0) && has_value) {
+            options->worker_count = atoi(argv[++i]);
+        }
+        else if ((strcmp(arg, "--flight-records") == 0) && has_value) {
+            options->flight_records = atoi(argv[++i]);
+        }
+        else if ((strcmp(arg, "--flight-dump") == 0) && has_value) {
+            options->flight_dump_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--watchdog-ms") == 0) && has_value) {
+            options->watchdog_ms = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--stats") == 0) {
+            options->stats = true;
+        }
+        else if (strcmp(arg, "--latency") == 0) {
+            options->latency = true;
+        }
+        else if ((strcmp(arg, "--trace-events") == 0) && has_value) {
+            options->trace_events_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--metrics-socket") == 0) && has_value) {
+            options->metrics_socket = argv[++i];
+        }
+        else if ((strcmp(arg, "--results") == 0) && has_value) {
+            options->results_path = argv[++i];
+        }
+        else if ((strcmp(arg, "--results-format") == 0) && has_value && ((strcmp(argv[i + 1], "json") == 0) || (strcmp(argv[i + 1], "csv") == 0))) {
+            options->results_format = (strcmp(argv[++i], "csv") == 0) ? RESULTS_CSV : RESULTS_JSON;
+            results_format_set = true;
+        }
+        else {
+            printf("Usage: %s [--seed N] [--single-thread] [--checkpoint FILE] [--checkpoint-every ROUNDS] [--resume FILE]\n"
+                   "          [--record TRACE] [--replay TRACE] [--no-log] [--log-buffered] [--log-writer stdio|writev|io_uring] [--no-log-pause]\n"
+                   "          [--log-compress] [--log-compress-level 1-9] [--log-index N]\n"
+                   "          [--log-mmap] [--log-mmap-segment-mb MB] [--timeline] [--timeline-only] [--log-filter SPEC]\n"
+                   "          [--output-dir DIR] [--run-id ID] [--log-timestamps ns|ms] [--verbosity silent|summary|full]\n"
+                   "          [--log-max-lines N] [--log-max-total N] [--log-cap-policy stop|exit] [--log-rotate-lines N] [--log-rotate-bytes N]\n"
+                   "          [--hunters N] [--rooms N] [--threads N] [--stats] [--latency]\n"
+                   "          [--trace-events FILE] [--metrics-socket PATH] [--results FILE] [--results-format json|csv]\n"
+                   "          [--flight-records N] [--flight-dump FILE] [--watchdog-ms MS]\n"
+                   "Log timestamps are nanoseconds by default, without the 2 ms pause after each record that --log-timestamps ms keeps.\n", argv[0]);
+            return C_ERR;
+        }
+    }
+
+    // Checkpointing mid-run needs every entity paused between turns, which only the single-threaded engine guarantees
+    if ((options->checkpoint_every > 0) && !options->single_thread) {
+        printf("ERROR: --checkpoint-every requires --single-thread\n");
+        return C_ERR;
+    }
+
+    // Threaded outcomes depend on how the threads interleave, which the trace does not record
+    if ((options->record_path != NULL) && !options->single_thread) {
+        printf("ERROR: --record requires --single-thread\n");
+        return C_ERR;
+    }
+
+    if ((options->replay_path != NULL) && ((options->record_path != NULL) || (options->resume_path != NULL))) {
+        printf("ERROR: --replay cannot be combined with --record or --resume\n");
+        return C_ERR;
+    }
+
+    if ((options->hunter_count < 0) || (options->room_count < 0) || (options->worker_count < 0)) {
+        printf("ERROR: --hunters, --rooms and --threads cannot be negative\n");
+        return C_ERR;
+    }
+
+    // Run IDs name a single directory
+    if ((options->run_id != NULL) && ((options->run_id[0] == '\0') || (strchr(options->run_id, '/') != NULL) ||
+                                      (strcmp(options->run_id, ".") == 0) || (strcmp(options->run_id, "..") == 0))) {
+        printf("ERROR: --run-id must be a plain name without '/'\n");
+        return C_ERR;
+    }
+
+    if ((options->log_max_lines < 0) || (options->log_max_total < 0) || (options->log_rotate_lines < 0) || (options->log_rotate_bytes < 0) ||
+        (options->log_index < 0)) {
+        printf("ERROR: log caps, rotation sizes and the index interval cannot be negative\n");
+        return C_ERR;
+    }
+
+    // Compression runs on the writer thread, so it needs buffered logging and a writer
+    if ((options->log_compress_level < 0) || (options->log_compress_level > 9)) {
+        printf("ERROR: --log-compress-level must be 1 to 9\n");
+        return C_ERR;
+    }
+
+    if (options->log_compress_level > 0) {
+
+        if (!log_writer_set_compression(options->log_compress_level)) {
+            printf("ERROR: --log-compress needs a build with zlib\n");
+            return C_ERR;
+        }
+
+        if ((options->log_mmap_mb > 0) || !options->entity_logs) {
+            printf("ERROR: --log-compress cannot be combined with --log-mmap or --timeline-only\n");
+            return C_ERR;
+        }
+
+        options->log_buffered = true;
+        if (options->log_writer == LOG_WRITER_STDIO) {
+            options->log_writer = LOG_WRITER_WRITEV;
+        }
+    }
+
+    if ((options->log_filter != NULL) && !log_set_filter(options->log_filter)) {
+        return C_ERR;
+    }
+
+    if ((options->log_mmap_mb < 0) || (options->log_mmap_mb > 4096)) {
+        printf("ERROR: --log-mmap-segment-mb must be 1 to 4096\n");
+        return C_ERR;
+    }
+
+    // Rings are sized up front, a huge ring per thread would multiply into gigabytes
+    if ((options->flight_records < 0) || (options->flight_records > (1 << 20)) || (options->watchdog_ms < 0)) {
+        printf("ERROR: --flight-records must be 0 to 1048576 and --watchdog-ms cannot be negative\n");
+        return C_ERR;
+    }
+
+    // Replay recreates the recorded hunters, a resumed run already has its hunters
+    if ((options->hunter_count > 0) && ((options->replay_path != NULL) || (options->resume_path != NULL))) {
+        printf("ERROR: --hunters cannot be combined with --replay or --resume\n");
+        return C_ERR;
+    }
+
+    if ((options->worker_count > 0) && options->single_thread) {
+        printf("ERROR: --threads cannot be combined with --single-thread\n");
+        return C_ERR;
+    }
+
+    // Results files ending in .csv are CSV unless a format was given
+    if (!results_format_set && (options->results_path != NULL)) {
+
+        size_t length = strlen(options->results_path);
+
+        if ((length >= 4) && (strcmp(options->results_path + length - 4, ".csv") == 0)) {
+            options->results_format = RESULTS_CSV;
+        }
+    }
+
+    // Nanosecond timestamps are distinct without pausing, the pause only keeps millisecond timestamps apart
+    if (!options->log_ms_timestamps) {
+        options->log_pause = false;
+    }
+
+    // Replay runs on the single-threaded engine and skips the logging pause, since timestamps no longer order anything
+    if (options->replay_path != NULL) {
+        options->single_thread = true;
+        options->log_pause = false;
+    }
+
+    return C_OK;
+}
+
+// Creates a directory and any missing parents, like mkdir -p
+static int make_directories(const char *path) {
+
+    char partial[512];
+
+    if (strlen(path) >= sizeof(partial)) {
+        return C_ERR;
+    }
+
+    strcpy(partial, path);
+
+    for (char *c = partial + 1; ; c++) {
+
+        if ((*c == '/') || (*c == '\0')) {
+
+            char saved = *c;
+            *c = '\0';
+
+            if ((mkdir(partial, 0755) != 0) && (errno != EEXIST)) {
+                return C_ERR;
+            }
+
+            *c = saved;
+        }
+
+        if (*c == '\0') {
+            break;
+        }
+    }
+
+    return C_OK;
+}
+
+// Creates <output dir>/<run id> for the run's log files and points logging at it, generating the run ID if none was given
+int create_run_directory(const RunOptions *options, char *run_id, size_t run_id_size) {
+
+    // Generated IDs are unique per host: start time to the second plus the process ID
+    if (options->run_id != NULL) {
+        snprintf(run_id, run_id_size, "%s", options->run_id);
+    }
+    else {
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+        snprintf(run_id, run_id_size, "run-%s-%ld", stamp, (long)getpid());
+    }
+
+    const char *output_dir = (options->output_dir != NULL) ? options->output_dir : ".";
+    char run_dir[512];
+
+    snprintf(run_dir, sizeof(run_dir), "%s/%s", output_dir, run_id);
+
+    if (!make_directories(output_dir)) {
+        printf("ERROR: Output directory %s could not be created\n", output_dir);
+        return C_ERR;
+    }
+
+    // An existing run directory would mix two runs' logs, the collision this option exists to avoid
+    if (mkdir(run_dir, 0755) != 0) {
+        printf("ERROR: Run directory %s could not be created%s\n", run_dir, (errno == EEXIST) ? " (it already exists)" : "");
+        return C_ERR;
+    }
+
+    if (!log_set_directory(run_dir)) {
+        printf("ERROR: Run directory path %s is too long\n", run_dir);
+        return C_ERR;
+    }
+
+    printf("Run %s: logging to %s\n", run_id, run_dir);
+
+    return C_OK;
+}
+
+// Runs one thread per entity and waits for all of them to complete
+void run_threads(House *house) {
+
+    // Creates ghost thread
+    pthread_create(&(house->ghost.thread), NULL, ghost_thread, &(house->ghost));     
+
+    // Creates hunter threads
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+
+        Hunter *hunter = house->hunter_arr.hunters[i];       // gets hunter pointer
+
+        pthread_create(&(hunter->thread), NULL, hunter_thread, hunter);
+    }
+
+    // Waits for ghost thread to complete
+    pthread_join(house->ghost.thread, NULL);
+
+    // Waits for all hunter threads to complete
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+
+        Hunter *hunter = house->hunter_arr.hunters[i];       // gets hunter pointer
+
+        pthread_join(hunter->thread, NULL);
+    }
+}
+
 // Gets hunter info from users
 int get_hunters(House *house) {
 
+    log_console_flush();                    // shows the ghost's initialization before the prompts
+
     printf("\n===================== WILLOW HOUSE INVESTIGATION =====================\n");
 
     printf("\nPlease enter hunters one at a time.\n");
@@ -104,6 +725,37 @@ int get_hunters(House *house) {
     return c;
 }
 
+// Creates hunters without prompting, with generated names, sequential IDs and random devices
+int create_hunters(House *house, int hunter_count) {
+
+    int id = 1;
+
+    for (int i = 0; i < hunter_count; i++) {
+
+        // Skips the ghost's ID so every log file belongs to one entity
+        if (id == DEFAULT_GHOST_ID) {
+            id++;
+        }
+
+        char name[MAX_HUNTER_NAME];
+        snprintf(name, sizeof(name), "Hunter%d", id);
+
+        Hunter *hunter;
+
+        if (!hunter_init(&hunter, name, id, false, -1)) {
+            return C_ERR;
+        }
+
+        if (!house_add_hunter(house, hunter)) {
+            return C_ERR;
+        }
+
+        id++;
+    }
+
+    return C_OK;
+}
+
 // Prints results screen
 void results_print(House *house) {
 
@@ -115,19 +767,11 @@ void results_print(House *house) {
     // Prints shared case file checklist
     casefile_results_print(&(house->case_file));
 
-    bool hunters_win;       // tracks which entity won the game
-
     // Stores actual ghost type and hunter's guess ghost type
     enum GhostType ghost_actual = house->ghost.type;
     enum GhostType ghost_guess = (enum GhostType)house->case_file.collected;
 
-    // Determines which entity won the game
-    if (ghost_actual == ghost_guess) {
-        hunters_win = true;
-    }
-    else {
-        hunters_win = false;
-    }
+    bool hunters_win = house_hunters_win(house);       // tracks which entity won the game
 
     // Prints victory results
     printf("\nVictory Results: \n");
@@ -145,6 +789,15 @@ void results_print(House *house) {
 
     printf("    - Actual Ghost Type: %s \n", ghost_to_string(ghost_actual));
 
+    // Reports log records dropped at the log caps, the simulation itself ran to completion
+    if (log_dropped_line_count() > 0) {
+        printf("\nLogging: \n");
+        printf("--------------------------------------------------------------------\n");
+        printf("    - Log records dropped at caps: %ld \n", log_dropped_line_count());
+        printf("    - Entities at the per-entity cap: %d \n", log_capped_entity_count());
+        printf("    - Total cap reached: %s \n", log_total_cap_reached() ? "yes" : "no");
+    }
+
     // Prints overall results
     printf("\nOverall Results: ");
     if (hunters_win) {
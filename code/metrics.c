@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Live metrics server (--metrics-socket PATH), for watching long runs before the results screen.
+// Every connection to the Unix socket gets one text snapshot, one "key value" pair per line, and is closed,
+// so `socat - UNIX-CONNECT:PATH` or `nc -U PATH` prints the current state.
+// Snapshots never take a room or case file lock: the fields read here are stored with relaxed atomic stores by the
+// threads that own them and read with relaxed atomic loads, so a snapshot can be a turn behind but never stalls the simulation.
+
+#define METRICS_POLL_MS 100
+
+static const House *metrics_house = NULL;
+static char metrics_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static int metrics_listen_fd = -1;
+static bool metrics_stop = false;
+static pthread_t metrics_thread;
+
+// Start of the run, and the previous snapshot for the turn rate between snapshots
+static long long metrics_start_ns = 0;
+static long long metrics_last_ns = 0;
+static long metrics_last_turns = 0;
+
+static long long metrics_now_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Writes one snapshot of the running house
+static void metrics_snapshot(FILE *out) {
+
+    const House *house = metrics_house;
+    const DynamicHunterArray *hunters = &(house->hunter_arr);
+
+    long long now = metrics_now_ns();
+    long turns = __atomic_load_n(&(house->ghost.turn_count), __ATOMIC_RELAXED);
+    int active = 0;
+    int exited[LR_AFRAID + 1] = {0};
+
+    for (int i = 0; i < hunters->hunter_count; i++) {
+
+        const Hunter *hunter = hunters->hunters[i];
+
+        turns += __atomic_load_n(&(hunter->turn_count), __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(&(hunter->running), __ATOMIC_RELAXED)) {
+            active++;
+        }
+        else if (__atomic_load_n(&(hunter->exited), __ATOMIC_RELAXED)) {
+
+            int reason = (int)__atomic_load_n(&(hunter->exited_reason), __ATOMIC_RELAXED);
+
+            if ((reason >= LR_EVIDENCE) && (reason <= LR_AFRAID)) {
+                exited[reason]++;
+            }
+        }
+    }
+
+    double uptime_s = (double)(now - metrics_start_ns) / 1e9;
+    double interval_s = (double)(now - metrics_last_ns) / 1e9;
+
+    fprintf(out, "uptime_s %.3f\n", uptime_s);
+    fprintf(out, "turns %ld\n", turns);
+    fprintf(out, "turns_per_s %.1f\n", (interval_s > 0) ? (double)(turns - metrics_last_turns) / interval_s : 0.0);
+    fprintf(out, "turns_per_s_avg %.1f\n", (uptime_s > 0) ? (double)turns / uptime_s : 0.0);
+
+    metrics_last_ns = now;
+    metrics_last_turns = turns;
+
+    fprintf(out, "hunters %d\n", hunters->hunter_count);
+    fprintf(out, "hunters_active %d\n", active);
+
+    for (int reason = LR_EVIDENCE; reason <= LR_AFRAID; reason++) {
+        fprintf(out, "hunters_exited_%s %d\n", exit_reason_to_string((enum LogReason)reason), exited[reason]);
+    }
+
+    // Case file bits, with the evidence names
+    EvidenceByte collected = __atomic_load_n(&(house->case_file.collected), __ATOMIC_RELAXED);
+
+    fprintf(out, "case_file_bits 0x%02x", (unsigned)collected);
+
+    const enum EvidenceType *evidence_types = NULL;
+    int evidence_count = get_all_evidence_types(&evidence_types);
+
+    for (int i = 0; i < evidence_count; i++) {
+        if (collected & evidence_types[i]) {
+            fprintf(out, " %s", evidence_to_string(evidence_types[i]));
+        }
+    }
+
+    fprintf(out, "\n");
+    fprintf(out, "case_file_solved %d\n", __atomic_load_n(&(house->case_file.solved), __ATOMIC_RELAXED) ? 1 : 0);
+
+    const Room *ghost_room = __atomic_load_n(&(house->ghost.room), __ATOMIC_RELAXED);
+    bool ghost_running = __atomic_load_n(&(house->ghost.running), __ATOMIC_RELAXED);
+
+    fprintf(out, "ghost_room %s\n", (ghost_running && (ghost_room != NULL)) ? ghost_room->name : "-");
+
+#ifdef SIM_LOCK_STATS
+    fprintf(out, "lock_wait_ns %lld\n", lockstats_total_wait_ns());
+#else
+    fprintf(out, "lock_wait_ns -\n");
+#endif
+
+    fprintf(out, "log_queue_depth %ld\n", log_queue_depth());
+
+    // Room names can hold spaces, so they come last on their lines
+    for (int i = 0; i < house->room_count; i++) {
+
+        const Room *room = house->rooms + i;
+
+        fprintf(out, "room_hunters %d %s\n", __atomic_load_n(&(room->hunter_arr.hunter_count), __ATOMIC_RELAXED), room->name);
+    }
+}
+
+// Sends a snapshot to one client, MSG_NOSIGNAL keeps a client that hangs up early from raising SIGPIPE
+static void metrics_serve(int client_fd) {
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&text, &length);
+
+    if (out == NULL) {
+        return;
+    }
+
+    metrics_snapshot(out);
+    fclose(out);
+
+    size_t sent = 0;
+
+    while (sent < length) {
+
+        ssize_t result = send(client_fd, text + sent, length - sent, MSG_NOSIGNAL);
+
+        if (result <= 0) {
+            break;
+        }
+
+        sent += (size_t)result;
+    }
+
+    free(text);
+}
+
+// Accepts connections until metrics_server_stop, polling so it notices the stop flag
+static void *metrics_server_thread(void *arg) {
+
+    (void)arg;
+
+    struct pollfd listener = {metrics_listen_fd, POLLIN, 0};
+
+    while (!__atomic_load_n(&metrics_stop, __ATOMIC_ACQUIRE)) {
+
+        if (poll(&listener, 1, METRICS_POLL_MS) <= 0) {
+            continue;
+        }
+
+        int client_fd = accept(metrics_listen_fd, NULL, NULL);
+
+        if (client_fd >= 0) {
+            metrics_serve(client_fd);
+            close(client_fd);
+        }
+    }
+
+    return 0;
+}
+
+/*
+    Purpose:
+        Starts the live metrics server thread on a Unix domain socket, replacing any stale socket file at the path.
+    Parameters:
+        - path (in): socket file path
+        - house (in): house to report on, must outlive metrics_server_stop
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int metrics_server_start(const char *path, const House *house) {
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("\nERROR: Metrics socket path %s is too long...\n", path);
+        return C_ERR;
+    }
+
+    strcpy(address.sun_path, path);
+    strcpy(metrics_path, path);
+
+    metrics_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (metrics_listen_fd < 0) {
+        printf("\nERROR: Metrics socket could not be created...\n");
+        return C_ERR;
+    }
+
+    unlink(path);
+
+    if ((bind(metrics_listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0) || (listen(metrics_listen_fd, 8) != 0)) {
+        printf("\nERROR: Metrics socket %s could not be opened...\n", path);
+        close(metrics_listen_fd);
+        metrics_listen_fd = -1;
+        return C_ERR;
+    }
+
+    metrics_house = house;
+    metrics_start_ns = metrics_now_ns();
+    metrics_last_ns = metrics_start_ns;
+    metrics_last_turns = 0;
+    metrics_stop = false;
+
+    if (pthread_create(&metrics_thread, NULL, metrics_server_thread, NULL) != 0) {
+        printf("\nERROR: Metrics server thread could not be started...\n");
+        close(metrics_listen_fd);
+        unlink(path);
+        metrics_listen_fd = -1;
+        return C_ERR;
+    }
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Stops the live metrics server thread and removes its socket file. Does nothing if the server is not running.
+*/
+void metrics_server_stop(void) {
+
+    if (metrics_listen_fd < 0) {
+        return;
+    }
+
+    __atomic_store_n(&metrics_stop, true, __ATOMIC_RELEASE);
+    pthread_join(metrics_thread, NULL);
+
+    close(metrics_listen_fd);
+    unlink(metrics_path);
+
+    metrics_listen_fd = -1;
+    metrics_house = NULL;
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Memory-mapped log (--log-mmap): every entity's records go into shared, preallocated events_<n>.csv segments
+// instead of log_<id>.csv files. A segment is mapped once; logging threads reserve room for a line with one atomic
+// fetch-add on the segment's tail and copy the line into the mapping, so logging makes no system calls and the
+// page cache writes the data back. The thread whose reservation runs past the end of a segment maps the next one.
+// Closing the log truncates each segment to the bytes used. A segment that was never closed (crash) ends in zero bytes,
+// which readers treat as the end of the data.
+// Lines are in reservation order, which can differ slightly from timestamp order between threads.
+// With --log-index each segment's lines are indexed into events_<n>.csv.idx when it is closed, while it is still mapped.
+
+#define MMAP_LOG_SEGMENTS_MAX 4096
+#define MMAP_LOG_PATH_MAX 512
+
+struct MmapSegment {
+    int fd;
+    char *base;
+    size_t size;                    // preallocated and mapped bytes
+    size_t tail;                    // bytes reserved, can run past size once the segment is full
+    size_t used;                    // bytes of complete lines, set when the segment fills up or is closed
+};
+
+bool mmap_log_enabled = false;
+
+static struct MmapSegment mmap_segments[MMAP_LOG_SEGMENTS_MAX];
+static int mmap_segment_count = 0;
+static struct MmapSegment *mmap_current = NULL;
+static size_t mmap_segment_bytes = 0;
+static char mmap_header[128];
+static size_t mmap_header_length = 0;
+
+// Creates, preallocates and maps segment number index, its tail starts after the header
+static bool mmap_segment_create(int index) {
+
+    struct MmapSegment *segment = mmap_segments + index;
+    const char *directory = log_get_directory();
+    char path[MMAP_LOG_PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s%sevents_%d.csv", directory, (directory[0] != '\0') ? "/" : "", index);
+
+    segment->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (segment->fd < 0) {
+        return false;
+    }
+
+    // Reserves the blocks up front so page faults never hit a full disk, filesystems without fallocate get a sparse file
+    int result = posix_fallocate(segment->fd, 0, (off_t)mmap_segment_bytes);
+
+    if ((result != 0) && (ftruncate(segment->fd, (off_t)mmap_segment_bytes) != 0)) {
+        close(segment->fd);
+        return false;
+    }
+
+    segment->base = (char*)mmap(NULL, mmap_segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+
+    if (segment->base == MAP_FAILED) {
+        segment->base = NULL;
+        close(segment->fd);
+        return false;
+    }
+
+    memcpy(segment->base, mmap_header, mmap_header_length);
+
+    segment->size = mmap_segment_bytes;
+    segment->used = 0;
+    segment->tail = mmap_header_length;
+
+    return true;
+}
+
+// Writes the index of a segment's lines, every Nth line with the latest timestamp up to it
+static void mmap_segment_index(int number, const char *base, size_t used) {
+
+    const char *directory = log_get_directory();
+    char path[MMAP_LOG_PATH_MAX];
+    snprintf(path, sizeof(path), "%s%sevents_%d.csv", directory, (directory[0] != '\0') ? "/" : "", number);
+
+    FILE *index = log_index_open(path);
+
+    if (index == NULL) {
+        return;
+    }
+
+    long every = log_index_interval();
+    long record = 0;
+    long long latest = 0;
+    size_t offset = mmap_header_length;
+
+    while (offset < used) {
+
+        const char *end = (const char*)memchr(base + offset, '\n', used - offset);
+
+        if (end == NULL) {
+            break;
+        }
+
+        long long timestamp = strtoll(base + offset, NULL, 10);
+        if (timestamp > latest) {
+            latest = timestamp;
+        }
+
+        if ((record > 0) && ((record % every) == 0)) {
+            fprintf(index, "%ld,%lld,%zu\n", record, latest, offset);
+        }
+
+        record++;
+        offset = (size_t)(end - base) + 1;
+    }
+
+    fclose(index);
+}
+
+// Unmaps a segment and truncates its file to the bytes used
+static void mmap_segment_close(struct MmapSegment *segment) {
+
+    size_t used = (segment->used > 0) ? segment->used : segment->tail;
+
+    if (used > segment->size) {
+        used = segment->size;
+    }
+
+    if (log_index_interval() > 0) {
+        mmap_segment_index((int)(segment - mmap_segments), segment->base, used);
+    }
+
+    munmap(segment->base, segment->size);
+
+    if (ftruncate(segment->fd, (off_t)used) != 0) {
+        printf("\nERROR: Log segment could not be truncated...\n");
+    }
+
+    close(segment->fd);
+    segment->base = NULL;
+}
+
+/*
+    Purpose:
+        Switches logging to memory-mapped segments in the log directory, creating and mapping events_0.csv.
+        Must be called after the log directory and timestamp mode are set and before any thread logs.
+    Parameters:
+        - segment_bytes (in): size each segment is preallocated to
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int mmap_log_open(size_t segment_bytes) {
+
+    int header_length = log_file_header(mmap_header, sizeof(mmap_header));
+    mmap_header_length = (header_length > 0) ? (size_t)header_length : 0;
+    mmap_segment_bytes = segment_bytes;
+
+    if (!mmap_segment_create(0)) {
+        printf("\nERROR: Log segment events_0.csv could not be created (%s)...\n", strerror(errno));
+        return C_ERR;
+    }
+
+    mmap_segment_count = 1;
+    __atomic_store_n(&mmap_current, mmap_segments, __ATOMIC_RELEASE);
+
+    // Segments are not truncated by exit handlers: other threads may still be copying into them, and a store past
+    // a truncated end would raise SIGBUS. An early exit leaves the zero-filled preallocation, like a crash.
+    mmap_log_enabled = true;
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Copies a formatted log line into the current segment, mapping the next segment when the current one is full.
+        If the next segment cannot be created, memory-mapped logging is turned off and the line is not copied.
+    Parameters:
+        - line (in): formatted line, newline included
+        - length (in): line length in bytes
+    Returns:
+        C_OK if the line is in a segment, C_ERR if the caller has to write it to the per-entity log files.
+*/
+int mmap_log_append(const char *line, size_t length) {
+
+    while (true) {
+
+        struct MmapSegment *segment = __atomic_load_n(&mmap_current, __ATOMIC_ACQUIRE);
+        size_t offset = __atomic_fetch_add(&(segment->tail), length, __ATOMIC_RELAXED);
+
+        if (offset + length <= segment->size) {
+            memcpy(segment->base + offset, line, length);
+            return C_OK;
+        }
+
+        // Only the reservation that crosses the end maps the next segment, later ones wait for it
+        if (offset <= segment->size) {
+
+            segment->used = offset;
+            int next = mmap_segment_count;
+
+            if ((next >= MMAP_LOG_SEGMENTS_MAX) || !mmap_segment_create(next)) {
+                fprintf(stderr, "Log segment events_%d.csv could not be created, logging this line and later ones to log_<id>.csv files\n", next);
+                __atomic_store_n(&mmap_log_enabled, false, __ATOMIC_RELEASE);
+                return C_ERR;
+            }
+
+            mmap_segment_count = next + 1;
+            __atomic_store_n(&mmap_current, mmap_segments + next, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        while ((__atomic_load_n(&mmap_current, __ATOMIC_ACQUIRE) == segment) && __atomic_load_n(&mmap_log_enabled, __ATOMIC_ACQUIRE)) {
+            sched_yield();
+        }
+
+        // Lines waiting on a rotation that failed go to the per-entity files like every later one
+        if (!__atomic_load_n(&mmap_log_enabled, __ATOMIC_ACQUIRE)) {
+            return C_ERR;
+        }
+    }
+}
+
+/*
+    Purpose:
+        Unmaps every segment and truncates each one to the bytes used. Called once every logging thread is done.
+*/
+void mmap_log_close(void) {
+
+    if (mmap_segment_count == 0) {
+        return;
+    }
+
+    mmap_log_enabled = false;
+
+    for (int i = 0; i < mmap_segment_count; i++) {
+        mmap_segment_close(mmap_segments + i);
+    }
+
+    mmap_segment_count = 0;
+    mmap_current = NULL;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "defs.h" 
+#include "helpers.h"
 
 // ROOM STACK FUNCTIONS
 
@@ -44,6 +45,7 @@ int roomstack_push(RoomStack *room_stack, Room *room) {
     }
     
     RoomNode *new_node = (RoomNode*) malloc(sizeof(RoomNode));     // dynamically allocated a room node
+    alloc_count_add();
 
     if (new_node == NULL) {
         printf("\nERROR: Memory allocation error... \n");
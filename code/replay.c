@@ -0,0 +1,450 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Decision trace file layout (text, one record per line):
+//   # ghost hunt decision trace v2
+//   seed,<base seed>
+//   hunter,<id>,<name>,<device index|->   hunter roster in creation order, with the device the user picked (- for random)
+//   d,<entity id>,<decision type>,<value>
+// Decisions made on a thread with no bound entity (ghost type, start room, initial devices) use entity id -1.
+// Traces are recorded on the single-threaded engine only: threaded outcomes (moves into full rooms, return rolls)
+// depend on how the threads interleave, which the trace does not record.
+
+#define TRACE_HEADER "# ghost hunt decision trace v2"
+#define TRACE_LINE_MAX 256
+
+// Decisions recorded for a single entity during replay
+typedef struct DecisionStream {
+    int entity_id;
+    int count;
+    int capacity;
+    int next;                   // index of next decision to hand back
+    unsigned char *types;
+    int *values;
+} DecisionStream;
+
+static enum DecisionMode trace_mode = DECISION_OFF;
+static FILE *trace_file = NULL;
+static sem_t trace_mutex;                   // serializes recorded lines from entity threads
+
+// Replay data, read-only once loaded
+static DecisionStream *trace_streams = NULL;
+static int trace_stream_count = 0;
+static int trace_stream_capacity = 0;
+static int *trace_stream_index = NULL;          // open addressing table of stream index + 1 by entity ID, 0 for empty
+static int trace_index_capacity = 0;            // power of two
+static int *trace_roster_ids = NULL;
+static char (*trace_roster_names)[MAX_HUNTER_NAME] = NULL;
+static int *trace_roster_devices = NULL;       // device index the user picked, -1 for a random device
+static int trace_roster_count = 0;
+static bool trace_diverged = false;
+
+static _Thread_local int bound_entity_id = DECISION_NO_ENTITY;
+static _Thread_local DecisionStream *bound_stream = NULL;
+
+// Slot of entity in the stream index, either the slot holding it or the empty slot it belongs in
+static int trace_index_slot(int entity_id) {
+
+    unsigned mask = (unsigned)trace_index_capacity - 1;
+    unsigned slot = ((unsigned)entity_id * 2654435761u) & mask;
+
+    while ((trace_stream_index[slot] != 0) && (trace_streams[trace_stream_index[slot] - 1].entity_id != entity_id)) {
+        slot = (slot + 1) & mask;
+    }
+
+    return (int)slot;
+}
+
+// Gets decision stream for entity, creates it when create is true, NULL if not found
+static DecisionStream* trace_find_stream(int entity_id, bool create) {
+
+    if (trace_index_capacity > 0) {
+
+        int slot = trace_index_slot(entity_id);
+
+        if (trace_stream_index[slot] != 0) {
+            return trace_streams + trace_stream_index[slot] - 1;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    if (trace_stream_count == trace_stream_capacity) {
+
+        int new_capacity = trace_stream_capacity ? trace_stream_capacity * 2 : 8;
+        DecisionStream *grown = (DecisionStream*)realloc(trace_streams, (size_t)new_capacity * sizeof(DecisionStream));
+        // Index keeps twice as many slots as streams so probes stay short
+        int *index = (int*)calloc((size_t)new_capacity * 2, sizeof(int));
+
+        if (grown != NULL) {
+            trace_streams = grown;
+        }
+        if ((grown == NULL) || (index == NULL)) {
+            printf("\nERROR: Memory allocation error... \n");
+            free(index);
+            return NULL;
+        }
+
+        free(trace_stream_index);
+        trace_stream_index = index;
+        trace_index_capacity = new_capacity * 2;
+        trace_stream_capacity = new_capacity;
+
+        for (int i = 0; i < trace_stream_count; i++) {
+            trace_stream_index[trace_index_slot(trace_streams[i].entity_id)] = i + 1;
+        }
+    }
+
+    DecisionStream *stream = trace_streams + trace_stream_count;
+    memset(stream, 0, sizeof(*stream));
+    stream->entity_id = entity_id;
+    trace_stream_count++;
+    trace_stream_index[trace_index_slot(entity_id)] = trace_stream_count;
+
+    return stream;
+}
+
+// Appends decision to the end of a stream
+static int trace_stream_append(DecisionStream *stream, int type, int value) {
+
+    if (stream->count == stream->capacity) {
+
+        int new_capacity = stream->capacity ? stream->capacity * 2 : 64;
+        unsigned char *types = (unsigned char*)realloc(stream->types, (size_t)new_capacity);
+        int *values = (int*)realloc(stream->values, (size_t)new_capacity * sizeof(int));
+
+        if (types != NULL) {
+            stream->types = types;
+        }
+        if (values != NULL) {
+            stream->values = values;
+        }
+        if ((types == NULL) || (values == NULL)) {
+            printf("\nERROR: Memory allocation error... \n");
+            return C_ERR;
+        }
+
+        stream->capacity = new_capacity;
+    }
+
+    stream->types[stream->count] = (unsigned char)type;
+    stream->values[stream->count] = value;
+    (stream->count)++;
+
+    return C_OK;
+}
+
+// Appends hunter to the replay roster
+static int trace_roster_append(int id, const char *name, int device_index) {
+
+    int *ids = (int*)realloc(trace_roster_ids, (size_t)(trace_roster_count + 1) * sizeof(int));
+    char (*names)[MAX_HUNTER_NAME] = realloc(trace_roster_names, (size_t)(trace_roster_count + 1) * MAX_HUNTER_NAME);
+    int *devices = (int*)realloc(trace_roster_devices, (size_t)(trace_roster_count + 1) * sizeof(int));
+
+    if (ids != NULL) {
+        trace_roster_ids = ids;
+    }
+    if (names != NULL) {
+        trace_roster_names = names;
+    }
+    if (devices != NULL) {
+        trace_roster_devices = devices;
+    }
+    if ((ids == NULL) || (names == NULL) || (devices == NULL)) {
+        printf("\nERROR: Memory allocation error... \n");
+        return C_ERR;
+    }
+
+    trace_roster_ids[trace_roster_count] = id;
+    snprintf(trace_roster_names[trace_roster_count], MAX_HUNTER_NAME, "%s", name);
+    trace_roster_devices[trace_roster_count] = device_index;
+    trace_roster_count++;
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Starts recording every random decision of the run to a decision trace file.
+    Parameters:
+        - path (in): trace file path
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int decision_trace_record(const char *path) {
+
+    trace_file = fopen(path, "w");
+
+    if (trace_file == NULL) {
+        printf("\nERROR: Decision trace %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    if (sem_init(&trace_mutex, 0, 1) < 0) {
+        printf("\nERROR: On semaphore init...\n");
+        exit(1);
+    }
+
+    fprintf(trace_file, "%s\nseed,%u\n", TRACE_HEADER, rand_get_base_seed());
+
+    trace_mode = DECISION_RECORD;
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Loads a decision trace so that every random decision of the run is taken from it instead of the PRNG.
+        Also restores the base seed the trace was recorded with.
+    Parameters:
+        - path (in): trace file path
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int decision_trace_replay(const char *path) {
+
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        printf("\nERROR: Decision trace %s could not be opened...\n", path);
+        return C_ERR;
+    }
+
+    char line[TRACE_LINE_MAX];
+
+    if ((fgets(line, sizeof(line), file) == NULL) || (strncmp(line, TRACE_HEADER, strlen(TRACE_HEADER)) != 0)) {
+        printf("\nERROR: %s is not a decision trace of this version...\n", path);
+        fclose(file);
+        return C_ERR;
+    }
+
+    int success = C_OK;
+    int line_number = 1;
+
+    while (success && (fgets(line, sizeof(line), file) != NULL)) {
+
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        int entity_id, type, value, name_offset;
+        unsigned seed;
+
+        if (sscanf(line, "d,%d,%d,%d", &entity_id, &type, &value) == 3) {
+
+            DecisionStream *stream = trace_find_stream(entity_id, true);
+            success = (stream != NULL) && trace_stream_append(stream, type, value);
+        }
+        else if (sscanf(line, "hunter,%d,%n", &entity_id, &name_offset) == 1) {
+
+            // The device comes last since names may hold commas
+            char *device = strrchr(line + name_offset, ',');
+
+            if (device == NULL) {
+                printf("\nERROR: Decision trace %s line %d is malformed...\n", path, line_number);
+                success = C_ERR;
+            }
+            else {
+                *device = '\0';
+                success = trace_roster_append(entity_id, line + name_offset, (device[1] == '-') ? -1 : atoi(device + 1));
+            }
+        }
+        else if (sscanf(line, "seed,%u", &seed) == 1) {
+            rand_set_base_seed(seed);
+        }
+        else if (line[0] != '\0') {
+            printf("\nERROR: Decision trace %s line %d is malformed...\n", path, line_number);
+            success = C_ERR;
+        }
+    }
+
+    fclose(file);
+
+    if (success) {
+        trace_mode = DECISION_REPLAY;
+    }
+
+    return success;
+}
+
+/*
+    Purpose:
+        Gets the decision trace mode the run is using.
+    Returns:
+        DECISION_OFF, DECISION_RECORD or DECISION_REPLAY.
+*/
+enum DecisionMode decision_trace_mode(void) {
+
+    return trace_mode;
+}
+
+/*
+    Purpose:
+        Marks which entity the calling thread is making decisions for.
+    Parameters:
+        - entity_id (in): hunter or ghost ID, DECISION_NO_ENTITY for decisions not owned by an entity
+*/
+void decision_bind_entity(int entity_id) {
+
+    // The single-threaded engines rebind every turn, the stream of an already bound entity is kept
+    if ((entity_id == bound_entity_id) && (bound_stream != NULL)) {
+        return;
+    }
+
+    bound_entity_id = entity_id;
+
+    if (trace_mode == DECISION_REPLAY) {
+        bound_stream = trace_find_stream(entity_id, false);
+    }
+}
+
+/*
+    Purpose:
+        Gets the entity the calling thread is making decisions for.
+    Returns:
+        Hunter or ghost ID, DECISION_NO_ENTITY when no entity is bound.
+*/
+int decision_bound_entity(void) {
+
+    return bound_entity_id;
+}
+
+/*
+    Purpose:
+        Makes a random decision for the bound entity.
+        Records it when recording, or hands back the recorded decision when replaying.
+        If a replayed run asks for a decision the trace does not hold, reports the divergence once and falls back to the PRNG.
+    Parameters:
+        - type (in): kind of decision being made
+        - lower_inclusive (in): minimum value (inclusive)
+        - upper_exclusive (in): maximum value (exclusive)
+    Returns:
+        Decision value in [lower_inclusive, upper_exclusive).
+*/
+int decision_rand(enum DecisionType type, int lower_inclusive, int upper_exclusive) {
+
+    if (trace_mode == DECISION_REPLAY) {
+
+        DecisionStream *stream = bound_stream;
+
+        // Main thread binds nothing, its stream is looked up on demand
+        if ((stream == NULL) && (bound_entity_id == DECISION_NO_ENTITY)) {
+            stream = bound_stream = trace_find_stream(DECISION_NO_ENTITY, false);
+        }
+
+        if ((stream != NULL) && (stream->next < stream->count) && (stream->types[stream->next] == type)) {
+
+            int value = stream->values[stream->next];
+            (stream->next)++;
+
+            if ((value >= lower_inclusive) && (value < upper_exclusive)) {
+                return value;
+            }
+        }
+
+        if (!trace_diverged) {
+            trace_diverged = true;
+            fprintf(stderr, "Replay diverged from trace at entity %d decision %d, continuing with random decisions.\n", bound_entity_id, (int)type);
+        }
+    }
+
+    int value = rand_int_threadsafe(lower_inclusive, upper_exclusive);
+
+    if (trace_mode == DECISION_RECORD) {
+
+        sem_wait(&trace_mutex);
+        fprintf(trace_file, "d,%d,%d,%d\n", bound_entity_id, (int)type, value);
+        sem_post(&trace_mutex);
+    }
+
+    return value;
+}
+
+/*
+    Purpose:
+        Adds a hunter to the recorded roster so that replay can recreate it.
+    Parameters:
+        - hunter (in): hunter structure, just added to the house
+*/
+void decision_trace_add_hunter(const Hunter *hunter) {
+
+    if (trace_mode != DECISION_RECORD) {
+        return;
+    }
+
+    sem_wait(&trace_mutex);
+    if (hunter->chosen_device >= 0) {
+        fprintf(trace_file, "hunter,%d,%s,%d\n", hunter->id, hunter->name, hunter->chosen_device);
+    }
+    else {
+        fprintf(trace_file, "hunter,%d,%s,-\n", hunter->id, hunter->name);
+    }
+    sem_post(&trace_mutex);
+}
+
+/*
+    Purpose:
+        Recreates the recorded hunter roster in the house, in the order the hunters were created.
+    Parameters:
+        - house (in/out): house structure
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int decision_trace_create_hunters(House *house) {
+
+    for (int i = 0; i < trace_roster_count; i++) {
+
+        Hunter *hunter;
+
+        // A device the user picked is part of the roster, a random one is a recorded decision
+        int device_index = trace_roster_devices[i];
+
+        if (!hunter_init(&hunter, trace_roster_names[i], trace_roster_ids[i], device_index >= 0, device_index)) {
+            return C_ERR;
+        }
+
+        if (!house_add_hunter(house, hunter)) {
+            return C_ERR;
+        }
+    }
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Flushes and closes a recorded trace, frees a replayed one.
+*/
+void decision_trace_close(void) {
+
+    if (trace_mode == DECISION_RECORD) {
+        fclose(trace_file);
+        trace_file = NULL;
+        sem_destroy(&trace_mutex);
+    }
+
+    for (int i = 0; i < trace_stream_count; i++) {
+        free(trace_streams[i].types);
+        free(trace_streams[i].values);
+    }
+
+    free(trace_streams);
+    free(trace_stream_index);
+    free(trace_roster_ids);
+    free(trace_roster_names);
+    free(trace_roster_devices);
+
+    trace_streams = NULL;
+    trace_stream_count = 0;
+    trace_stream_capacity = 0;
+    trace_stream_index = NULL;
+    trace_index_capacity = 0;
+    trace_roster_ids = NULL;
+    trace_roster_names = NULL;
+    trace_roster_devices = NULL;
+    trace_roster_count = 0;
+    trace_mode = DECISION_OFF;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Machine-readable results export (--results FILE), the structured counterpart of the results screen.
+// Records are appended, so a batch of runs can share one results file:
+// - JSON: one object per run per line (JSON Lines), hunters in a nested array
+// - CSV: one row per hunter with the run's columns repeated, header written when the file is empty
+
+#define RESULTS_CSV_HEADER "run_id,finished_at,seed,ghost_type,ghost_guess,hunters_win,case_file,hunters_identified,hunter_count," \
+                           "turns,rounds,run_ns,log_lines_dropped,hunter_id,hunter_name,device,exit_reason,boredom,fear,evidence_found,hunter_turns\n"
+
+/*
+    Purpose:
+        Checks if the hunters identified the ghost, the case file's evidence matches the ghost's type exactly.
+    Parameters:
+        - house (in): house structure
+    Returns:
+        true if the hunters win, false if the ghost wins.
+*/
+bool house_hunters_win(const House *house) {
+
+    return house->ghost.type == (enum GhostType)house->case_file.collected;
+}
+
+// Writes text as a JSON string (quotes included)
+static void results_json_string(FILE *file, const char *text) {
+
+    fputc('"', file);
+
+    for (const char *c = text; *c != '\0'; c++) {
+
+        if ((*c == '"') || (*c == '\\')) {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned)(unsigned char)*c);
+        }
+        else {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+// Writes text as a CSV field, quoted only when it holds a comma, quote or line break
+static void results_csv_field(FILE *file, const char *text) {
+
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+        fputs(text, file);
+        return;
+    }
+
+    fputc('"', file);
+
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"') {
+            fputc('"', file);
+        }
+        fputc(*c, file);
+    }
+
+    fputc('"', file);
+}
+
+// Names of the case file's collected evidence, separated by sep
+static void results_case_file(FILE *file, const CaseFile *case_file, const char *sep, bool quoted) {
+
+    const enum EvidenceType *evidence_types = NULL;
+    int evidence_count = get_all_evidence_types(&evidence_types);
+    bool first = true;
+
+    for (int i = 0; i < evidence_count; i++) {
+
+        if (case_file->collected & evidence_types[i]) {
+            fprintf(file, quoted ? "%s\"%s\"" : "%s%s", first ? "" : sep, evidence_to_string(evidence_types[i]));
+            first = false;
+        }
+    }
+}
+
+static void results_write_json(FILE *file, const House *house, long long run_ns, const char *run_id, long long finished_at) {
+
+    bool hunters_win = house_hunters_win(house);
+    const DynamicHunterArray *hunters = &(house->hunter_arr);
+
+    fprintf(file, "{\"run_id\":");
+    results_json_string(file, run_id);
+    fprintf(file, ",\"finished_at\":%lld,\"seed\":%u,\"ghost_type\":\"%s\",\"ghost_guess\":",
+            finished_at, rand_get_base_seed(), ghost_to_string(house->ghost.type));
+
+    // Like the results screen, a guess only counts when it is right
+    if (hunters_win) {
+        fprintf(file, "\"%s\"", ghost_to_string((enum GhostType)house->case_file.collected));
+    }
+    else {
+        fprintf(file, "null");
+    }
+
+    fprintf(file, ",\"hunters_win\":%s,\"case_file\":[", hunters_win ? "true" : "false");
+    results_case_file(file, &(house->case_file), ",", true);
+
+    fprintf(file, "],\"hunters_identified\":%d,\"hunter_count\":%d,\"turns\":%ld,\"rounds\":%ld,\"run_ns\":%lld,\"log_lines_dropped\":%ld,\"ghost_turns\":%ld,\"hunters\":[",
+            hunters_win_count(hunters), hunters->hunter_count, house_turn_count(house), house->round_count, run_ns, log_dropped_line_count(),
+            house->ghost.turn_count);
+
+    for (int i = 0; i < hunters->hunter_count; i++) {
+
+        const Hunter *hunter = hunters->hunters[i];
+
+        fprintf(file, "%s{\"id\":%d,\"name\":", (i > 0) ? "," : "", hunter->id);
+        results_json_string(file, hunter->name);
+        fprintf(file, ",\"device\":\"%s\",\"exit_reason\":\"%s\",\"boredom\":%d,\"fear\":%d,\"evidence_found\":%d,\"turns\":%ld}",
+                evidence_to_string(hunter->device_type),
+                exit_reason_to_string(hunter->exited_reason),
+                hunter->boredom,
+                hunter->fear,
+                hunter->evidence_found,
+                hunter->turn_count);
+    }
+
+    fprintf(file, "]}\n");
+}
+
+static void results_write_csv(FILE *file, const House *house, long long run_ns, const char *run_id, long long finished_at) {
+
+    bool hunters_win = house_hunters_win(house);
+    const DynamicHunterArray *hunters = &(house->hunter_arr);
+
+    // Appending to an empty (or new) file starts it with the header
+    if (ftell(file) == 0) {
+        fputs(RESULTS_CSV_HEADER, file);
+    }
+
+    for (int i = 0; i < hunters->hunter_count; i++) {
+
+        const Hunter *hunter = hunters->hunters[i];
+
+        results_csv_field(file, run_id);
+        fprintf(file, ",%lld,%u,%s,%s,%d,", finished_at, rand_get_base_seed(), ghost_to_string(house->ghost.type),
+                hunters_win ? ghost_to_string((enum GhostType)house->case_file.collected) : "",
+                hunters_win ? 1 : 0);
+        results_case_file(file, &(house->case_file), "|", false);
+
+        fprintf(file, ",%d,%d,%ld,%ld,%lld,%ld,%d,", hunters_win_count(hunters), hunters->hunter_count,
+                house_turn_count(house), house->round_count, run_ns, log_dropped_line_count(), hunter->id);
+        results_csv_field(file, hunter->name);
+
+        fprintf(file, ",%s,%s,%d,%d,%d,%ld\n",
+                evidence_to_string(hunter->device_type),
+                exit_reason_to_string(hunter->exited_reason),
+                hunter->boredom,
+                hunter->fear,
+                hunter->evidence_found,
+                hunter->turn_count);
+    }
+}
+
+/*
+    Purpose:
+        Appends the run's results to a results file: ghost type, guess and winner, the case file,
+        each hunter's exit reason, final boredom and fear, evidence found and turns, the run's timing and log records dropped at caps.
+    Parameters:
+        - path (in): results file, created if it does not exist
+        - format (in): RESULTS_JSON or RESULTS_CSV
+        - house (in): house structure after the simulation ended
+        - run_ns (in): simulation time in nanoseconds
+        - run_id (in): run identifier (--run-id or generated), "" for runs without one
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int results_write(const char *path, enum ResultsFormat format, const House *house, long long run_ns, const char *run_id) {
+
+    FILE *file = fopen(path, "a");
+
+    if (file == NULL) {
+        printf("\nERROR: Results file %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    long long finished_at = (long long)time(NULL);
+
+    if (format == RESULTS_CSV) {
+        results_write_csv(file, house, run_ns, run_id, finished_at);
+    }
+    else {
+        results_write_json(file, house, run_ns, run_id, finished_at);
+    }
+
+    if (fclose(file) != 0) {
+        printf("\nERROR: Results file %s could not be written...\n", path);
+        return C_ERR;
+    }
+
+    return C_OK;
+}
@@ -45,6 +45,11 @@ int room_init(Room* room, const char* name, bool is_exit) {
         exit(1);
     }
 
+    // Starts contention counters for the room's locks (make LOCKSTATS=1 only)
+    LOCK_REGISTER(&(room->ghost_presence_lock));
+    LOCK_REGISTER(&(room->hunter_occupancy_lock));
+    LOCK_REGISTER(&(room->evidence_lock));
+
     // Initialize other fields of room to simulation starting values
     room->evidence = 0;             
     room->connect_count = 0;
@@ -98,7 +103,7 @@ int room_connect(Room* a, Room* b) {
 */
 Room* room_choose_rand_start(House *house) {
 
-    int rand_index = rand_int_threadsafe(0, house->room_count);     // get random index by generating random integer 
+    int rand_index = decision_rand(DEC_START_ROOM, 0, house->room_count);     // get random index by generating random integer 
     
     return house->rooms + rand_index;       
 }
@@ -113,7 +118,7 @@ Room* room_choose_rand_start(House *house) {
 */
 Room* room_choose_rand_connection(Room *room) {
 
-    int rand_index = rand_int_threadsafe(0, room->connect_count);    // get random index by generating random integer 
+    int rand_index = decision_rand(DEC_MOVE_TARGET, 0, room->connect_count);    // get random index by generating random integer 
     
     return room->rooms_connected[rand_index];       
 }
@@ -127,7 +132,7 @@ Room* room_choose_rand_connection(Room *room) {
 */
 void room_add_ghost(Room *room, Ghost *ghost) {
 
-    ghost->room = room;
+    __atomic_store_n(&(ghost->room), room, __ATOMIC_RELAXED);       // read by the metrics thread
     room->ghost = ghost;
 }
 
@@ -140,7 +145,7 @@ void room_add_ghost(Room *room, Ghost *ghost) {
 */
 void room_remove_ghost(Room *room, Ghost *ghost) {
 
-    ghost->room = NULL;
+    __atomic_store_n(&(ghost->room), NULL, __ATOMIC_RELAXED);
     room->ghost = NULL;
 }
 
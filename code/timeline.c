@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Merged timeline (--timeline): one timeline.csv holding every entity's records in a single global order.
+// Every record takes the next global sequence number as it is logged and is copied into the slot of a ring indexed
+// by that number. A writer thread walks the ring in sequence order, writing each record once its slot is filled,
+// so the file comes out ordered without sorting; a thread that is slow to fill its slot only holds back later records.
+// Lines are the per-entity log columns with the sequence number in front: seq,timestamp,type,id,room,device,boredom,fear,action,extra
+// With --log-index the writer also indexes every Nth sequence number in timeline.csv.idx.
+
+#define TIMELINE_SLOTS 8192                     // power of two, loggers wait when the writer is this far behind
+#define TIMELINE_LINE_MAX 512
+#define TIMELINE_OUTPUT_BYTES (256 * 1024)
+
+struct TimelineSlot {
+    unsigned long ready;            // sequence number + 1 once the slot holds that record
+    unsigned length;                // 0 for a record that was given a number but could not be formatted
+    char line[TIMELINE_LINE_MAX];
+};
+
+bool timeline_enabled = false;
+
+static struct TimelineSlot *timeline_slots = NULL;
+static char *timeline_output = NULL;                // writer's output buffer, allocated up front so the writer cannot fail
+static unsigned long timeline_next_seq = 0;         // next number handed out
+static unsigned long timeline_written = 0;          // records the writer has taken out of the ring
+static bool timeline_stopping = false;
+static FILE *timeline_file = NULL;
+static FILE *timeline_index = NULL;                 // timeline.csv.idx, NULL without --log-index
+static size_t timeline_header_length = 0;
+static pthread_t timeline_thread;
+
+// Appends the ready records in sequence order and writes them out whenever the ring runs dry
+static void *timeline_writer(void *arg) {
+
+    (void)arg;
+
+    char *output = timeline_output;
+    size_t used = 0;
+    size_t flushed = timeline_header_length;        // bytes of the file before the output buffer
+    long long latest = 0;                           // latest timestamp so far, for the index
+    long every = log_index_interval();
+
+    while (true) {
+
+        unsigned long seq = timeline_written;
+        struct TimelineSlot *slot = timeline_slots + (seq & (TIMELINE_SLOTS - 1));
+
+        if (__atomic_load_n(&(slot->ready), __ATOMIC_ACQUIRE) == seq + 1) {
+
+            // Sequence number, then the record's line as it is written to the per-entity files
+            if (slot->length > 0) {
+
+                if (used + TIMELINE_LINE_MAX + 24 > TIMELINE_OUTPUT_BYTES) {
+                    fwrite(output, 1, used, timeline_file);
+                    flushed += used;
+                    used = 0;
+                }
+
+                long long timestamp = strtoll(slot->line, NULL, 10);
+                if (timestamp > latest) {
+                    latest = timestamp;
+                }
+
+                // Records racing for numbers can be slightly out of timestamp order, the entry holds the latest so far
+                if ((timeline_index != NULL) && (seq > 0) && ((seq % (unsigned long)every) == 0)) {
+                    fprintf(timeline_index, "%lu,%lld,%zu\n", seq, latest, flushed + used);
+                }
+
+                used += (size_t)sprintf(output + used, "%lu,", seq);
+                memcpy(output + used, slot->line, slot->length);
+                used += slot->length;
+            }
+
+            __atomic_store_n(&timeline_written, seq + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        if (used > 0) {
+            fwrite(output, 1, used, timeline_file);
+            fflush(timeline_file);
+            flushed += used;
+            used = 0;
+        }
+
+        // Stops once every number handed out has been written (loggers are done by then)
+        if (__atomic_load_n(&timeline_stopping, __ATOMIC_ACQUIRE) && (seq == __atomic_load_n(&timeline_next_seq, __ATOMIC_ACQUIRE))) {
+            break;
+        }
+
+        struct timespec pause = {0, 100 * 1000};    // 100 us
+        nanosleep(&pause, NULL);
+    }
+
+    return 0;
+}
+
+/*
+    Purpose:
+        Starts the merged timeline: creates timeline.csv in the log directory and its writer thread.
+        Must be called after the log directory and timestamp mode are set and before any thread logs.
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int timeline_open(void) {
+
+    const char *directory = log_get_directory();
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s%stimeline.csv", directory, (directory[0] != '\0') ? "/" : "");
+
+    timeline_file = fopen(path, "w");
+
+    if (timeline_file == NULL) {
+        printf("\nERROR: Timeline file %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    timeline_slots = (struct TimelineSlot*)calloc(TIMELINE_SLOTS, sizeof(struct TimelineSlot));
+    timeline_output = (char*)malloc(TIMELINE_OUTPUT_BYTES);
+    alloc_count_add();
+    alloc_count_add();
+
+    // Loggers wait on the writer, so the run cannot start without everything the writer needs
+    if ((timeline_slots == NULL) || (timeline_output == NULL)) {
+        printf("\nERROR: Memory allocation error... \n");
+        free(timeline_slots);
+        free(timeline_output);
+        timeline_slots = NULL;
+        timeline_output = NULL;
+        fclose(timeline_file);
+        return C_ERR;
+    }
+
+    char header[128];
+    int header_length = log_file_header(header, sizeof(header));
+    if (header_length > 0) {
+        fputs(header, timeline_file);
+    }
+    timeline_header_length = (header_length > 0) ? (size_t)header_length : 0;
+
+    timeline_index = (log_index_interval() > 0) ? log_index_open(path) : NULL;
+
+    timeline_next_seq = 0;
+    timeline_written = 0;
+    timeline_stopping = false;
+
+    if (pthread_create(&timeline_thread, NULL, timeline_writer, NULL) != 0) {
+        printf("\nERROR: Timeline writer thread could not be started...\n");
+        free(timeline_slots);
+        free(timeline_output);
+        timeline_slots = NULL;
+        timeline_output = NULL;
+        fclose(timeline_file);
+        if (timeline_index != NULL) {
+            fclose(timeline_index);
+            timeline_index = NULL;
+        }
+        return C_ERR;
+    }
+
+    timeline_enabled = true;
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Hands out the next global sequence number, every number must be passed to timeline_publish.
+    Returns:
+        Sequence number of the record being logged.
+*/
+unsigned long timeline_reserve(void) {
+
+    return __atomic_fetch_add(&timeline_next_seq, 1, __ATOMIC_RELAXED);
+}
+
+/*
+    Purpose:
+        Puts a record into its slot, waiting while the writer is a full ring behind.
+    Parameters:
+        - seq (in): number from timeline_reserve
+        - line (in): formatted line, newline included, NULL when the record could not be formatted
+        - length (in): line length in bytes
+*/
+void timeline_publish(unsigned long seq, const char *line, size_t length) {
+
+    while (seq - __atomic_load_n(&timeline_written, __ATOMIC_ACQUIRE) >= TIMELINE_SLOTS) {
+        sched_yield();
+    }
+
+    struct TimelineSlot *slot = timeline_slots + (seq & (TIMELINE_SLOTS - 1));
+
+    if ((line == NULL) || (length > TIMELINE_LINE_MAX)) {
+        length = 0;
+    }
+
+    if (length > 0) {
+        memcpy(slot->line, line, length);
+    }
+    slot->length = (unsigned)length;
+
+    __atomic_store_n(&(slot->ready), seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+    Purpose:
+        Writes out the remaining records and closes timeline.csv. Called once every logging thread is done.
+*/
+void timeline_close(void) {
+
+    if (!timeline_enabled) {
+        return;
+    }
+
+    __atomic_store_n(&timeline_stopping, true, __ATOMIC_RELEASE);
+    pthread_join(timeline_thread, NULL);
+
+    timeline_enabled = false;
+
+    fclose(timeline_file);
+    if (timeline_index != NULL) {
+        fclose(timeline_index);
+    }
+    free(timeline_slots);
+    free(timeline_output);
+
+    timeline_file = NULL;
+    timeline_index = NULL;
+    timeline_slots = NULL;
+    timeline_output = NULL;
+}
@@ -0,0 +1,347 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "defs.h"
+#include "helpers.h"
+
+// Trace Event Format export (--trace-events FILE), opens in chrome://tracing or ui.perfetto.dev.
+// Every entity gets its own track (tid = entity id, main thread work is on tid 0).
+// Turns, contended lock waits, log writes and moves are complete ("X") duration events with room names as arguments.
+// Each thread formats events into its own buffer and appends the buffer to the file under a mutex when it fills up.
+
+#define TRACE_BUFFER_BYTES (64 * 1024)
+#define TRACE_EVENT_MAX 512
+#define TRACE_MAIN_TID 0
+
+bool trace_events_enabled = false;
+
+static FILE *trace_events_file = NULL;
+static const House *trace_house = NULL;
+static long long trace_start_ns = 0;
+static pthread_mutex_t trace_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local char *trace_buffer = NULL;
+static _Thread_local size_t trace_buffer_used = 0;
+
+static long long trace_now_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Track of the entity the calling thread is running a turn for
+static int trace_current_tid(void) {
+
+    int entity_id = decision_bound_entity();
+
+    return (entity_id == DECISION_NO_ENTITY) ? TRACE_MAIN_TID : entity_id;
+}
+
+// Appends the calling thread's buffer to the trace file
+static void trace_buffer_write_out(void) {
+
+    if (trace_buffer_used == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&trace_file_mutex);
+    fwrite(trace_buffer, 1, trace_buffer_used, trace_events_file);
+    pthread_mutex_unlock(&trace_file_mutex);
+
+    trace_buffer_used = 0;
+}
+
+// Adds one formatted event to the calling thread's buffer
+static void trace_append(const char *event, int length) {
+
+    if ((length <= 0) || (length >= TRACE_EVENT_MAX)) {
+        return;
+    }
+
+    if (trace_buffer == NULL) {
+
+        trace_buffer = (char*)malloc(TRACE_BUFFER_BYTES);
+        alloc_count_add();
+
+        if (trace_buffer == NULL) {
+            printf("\nERROR: Memory allocation error... \n");
+            return;
+        }
+    }
+
+    if (trace_buffer_used + (size_t)length > TRACE_BUFFER_BYTES) {
+        trace_buffer_write_out();
+    }
+
+    memcpy(trace_buffer + trace_buffer_used, event, (size_t)length);
+    trace_buffer_used += (size_t)length;
+}
+
+// Appends a complete event, args is the inside of the args object (may be empty)
+static void trace_complete(const char *name, const char *category, int tid, long long start_ns, long long end_ns, const char *args) {
+
+    char event[TRACE_EVENT_MAX];
+
+    int length = snprintf(event, sizeof(event),
+                          ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+                          name,
+                          category,
+                          tid,
+                          (double)(start_ns - trace_start_ns) / 1000.0,
+                          (double)(end_ns - start_ns) / 1000.0,
+                          args);
+
+    trace_append(event, length);
+}
+
+// Copies text into a JSON string body, escaping quotes, backslashes and control characters
+static void trace_json_escape(char *output, size_t size, const char *text) {
+
+    size_t used = 0;
+
+    for (const char *c = text; (*c != '\0') && (used + 2 < size); c++) {
+
+        if ((*c == '"') || (*c == '\\')) {
+            output[used++] = '\\';
+            output[used++] = *c;
+        }
+        else if ((unsigned char)*c >= 0x20) {
+            output[used++] = *c;
+        }
+    }
+
+    output[used] = '\0';
+}
+
+// Names a room or case file lock from its address, locks live inside the house's rooms and case file
+static void trace_lock_name(const sem_t *sem, char *output, size_t size) {
+
+    const House *house = trace_house;
+    ptrdiff_t offset = (const char*)sem - (const char*)house->rooms;
+
+    if ((offset >= 0) && (offset < (ptrdiff_t)(house->room_count * sizeof(Room)))) {
+
+        const Room *room = house->rooms + (offset / (ptrdiff_t)sizeof(Room));
+        const char *kind = (sem == &(room->ghost_presence_lock)) ? "ghost presence" :
+                           (sem == &(room->hunter_occupancy_lock)) ? "occupancy" : "evidence";
+
+        snprintf(output, size, "%s %s lock", room->name, kind);
+    }
+    else if (sem == &(house->case_file.mutex)) {
+        snprintf(output, size, "Case file mutex");
+    }
+    else {
+        snprintf(output, size, "unknown lock");
+    }
+}
+
+/*
+    Purpose:
+        Starts writing a Trace Event Format JSON file for the run.
+    Parameters:
+        - path (in): trace file path
+        - house (in): house the run simulates, used to name rooms and tracks
+    Returns:
+        C_OK if successful, C_ERR otherwise.
+*/
+int trace_events_open(const char *path, const House *house) {
+
+    trace_events_file = fopen(path, "w");
+
+    if (trace_events_file == NULL) {
+        printf("\nERROR: Trace event file %s could not be opened for writing...\n", path);
+        return C_ERR;
+    }
+
+    trace_house = house;
+    trace_start_ns = trace_now_ns();
+
+    // First element, every later event starts with a comma
+    fprintf(trace_events_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"ghost hunt\"}}", TRACE_MAIN_TID);
+
+    trace_events_enabled = true;
+    log_set_write_hook(trace_log_write);
+
+    return C_OK;
+}
+
+/*
+    Purpose:
+        Starts timing a turn or move.
+    Returns:
+        Start time to pass to trace_turn or trace_move, 0 when tracing is off.
+*/
+long long trace_begin(void) {
+
+    return trace_events_enabled ? trace_now_ns() : 0;
+}
+
+/*
+    Purpose:
+        Adds a turn event to the entity's track, named after the turn's action.
+    Parameters:
+        - entity_id (in): hunter or ghost ID
+        - room (in): room the entity started the turn in
+        - start_ns (in): value returned by trace_begin
+*/
+void trace_turn(int entity_id, const char *room, long long start_ns) {
+
+    if (!trace_events_enabled) {
+        return;
+    }
+
+    char escaped[2 * MAX_ROOM_NAME];
+    char args[2 * MAX_ROOM_NAME + 64];
+
+    trace_json_escape(escaped, sizeof(escaped), room);
+    snprintf(args, sizeof(args), "\"room\":\"%s\",\"action\":\"%s\"", escaped, latency_action_to_string(latency_turn_action()));
+
+    trace_complete("turn", "turn", entity_id, start_ns, trace_now_ns(), args);
+}
+
+/*
+    Purpose:
+        Adds a move event to the entity's track, from the start of the move to the release of both rooms' locks.
+    Parameters:
+        - entity_id (in): hunter or ghost ID
+        - from (in): room left
+        - to (in): room entered
+        - start_ns (in): value returned by trace_begin
+*/
+void trace_move(int entity_id, const char *from, const char *to, long long start_ns) {
+
+    if (!trace_events_enabled) {
+        return;
+    }
+
+    char escaped_from[2 * MAX_ROOM_NAME];
+    char escaped_to[2 * MAX_ROOM_NAME];
+    char args[4 * MAX_ROOM_NAME + 32];
+
+    trace_json_escape(escaped_from, sizeof(escaped_from), from);
+    trace_json_escape(escaped_to, sizeof(escaped_to), to);
+    snprintf(args, sizeof(args), "\"from\":\"%s\",\"to\":\"%s\"", escaped_from, escaped_to);
+
+    trace_complete("move", "move", entity_id, start_ns, trace_now_ns(), args);
+}
+
+/*
+    Purpose:
+        Adds a log write event to the track of the entity the record belongs to.
+        Installed as the log write hook while tracing, so it is only called when tracing is on.
+    Parameters:
+        - entity_id (in): hunter or ghost ID of the record
+        - room (in): room in the record, may be empty
+        - start_ns (in): write start time (CLOCK_MONOTONIC)
+        - end_ns (in): write end time (CLOCK_MONOTONIC)
+*/
+void trace_log_write(int entity_id, const char *room, long long start_ns, long long end_ns) {
+
+    char escaped[2 * MAX_ROOM_NAME];
+    char args[2 * MAX_ROOM_NAME + 16];
+
+    trace_json_escape(escaped, sizeof(escaped), room);
+    snprintf(args, sizeof(args), "\"room\":\"%s\"", escaped);
+
+    trace_complete("log write", "log", entity_id, start_ns, end_ns, args);
+}
+
+/*
+    Purpose:
+        Adds a lock wait event to the calling thread's current track.
+    Parameters:
+        - sem (in): lock waited for
+        - start_ns (in): wait start time
+        - end_ns (in): time the lock was acquired
+*/
+void trace_lock_event(const sem_t *sem, long long start_ns, long long end_ns) {
+
+    char name[MAX_ROOM_NAME + 32];
+    char escaped[2 * (MAX_ROOM_NAME + 32)];
+    char args[2 * (MAX_ROOM_NAME + 32) + 16];
+
+    trace_lock_name(sem, name, sizeof(name));
+    trace_json_escape(escaped, sizeof(escaped), name);
+    snprintf(args, sizeof(args), "\"lock\":\"%s\"", escaped);
+
+    trace_complete("lock wait", "lock", trace_current_tid(), start_ns, end_ns, args);
+}
+
+/*
+    Purpose:
+        Acquires a lock like sem_wait, adding a lock wait event when another thread held it.
+    Parameters:
+        - sem (in/out): room or case file semaphore
+    Returns:
+        Return value of sem_wait (0 on success).
+*/
+int trace_lock_wait(sem_t *sem) {
+
+    if (sem_trywait(sem) == 0) {
+        return 0;
+    }
+
+    long long start = trace_now_ns();
+    int result = sem_wait(sem);
+
+    trace_lock_event(sem, start, trace_now_ns());
+
+    return result;
+}
+
+/*
+    Purpose:
+        Writes out the calling thread's buffered events and frees the buffer.
+        Every thread that adds events calls this once it is done.
+*/
+void trace_thread_flush(void) {
+
+    if (!trace_events_enabled) {
+        return;
+    }
+
+    trace_buffer_write_out();
+
+    free(trace_buffer);
+    trace_buffer = NULL;
+}
+
+/*
+    Purpose:
+        Names every entity's track and finishes the trace file. Called after all entity threads are joined.
+*/
+void trace_events_close(void) {
+
+    if (!trace_events_enabled) {
+        return;
+    }
+
+    trace_thread_flush();
+    trace_events_enabled = false;
+    log_set_write_hook(NULL);
+
+    const House *house = trace_house;
+    char name[2 * MAX_HUNTER_NAME];
+
+    fprintf(trace_events_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"main\"}}", TRACE_MAIN_TID);
+    fprintf(trace_events_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Ghost %d\"}}", house->ghost.id, house->ghost.id);
+
+    for (int i = 0; i < house->hunter_arr.hunter_count; i++) {
+
+        const Hunter *hunter = house->hunter_arr.hunters[i];
+
+        trace_json_escape(name, sizeof(name), hunter->name);
+        fprintf(trace_events_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s (%d)\"}}", hunter->id, name, hunter->id);
+    }
+
+    fprintf(trace_events_file, "\n]}\n");
+    fclose(trace_events_file);
+
+    trace_events_file = NULL;
+    trace_house = NULL;
+}
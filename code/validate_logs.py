@@ -2,13 +2,41 @@
 Lightweight Willow House log validator.
 
 Usage:
-- Run in the same directory that the project was executed in
+- Run in the same directory that the project was executed in, or pass the run's log directory
+  (python3 validate_logs.py runs/<run id>) for runs made with --output-dir or --run-id
 - Make sure that you are logging every major event required
 - The script will search for all log files in the directory
 
 Command Line Arguments:
-- --limit <number> limits the number of logs that it looks at for quick tests
+- <directory> directory holding the log_*.csv files (log_*.csv.gz for runs made with --log-compress),
+  or the events_<n>.csv segments of runs made with --log-mmap
+  (default: the current directory)
+- --limit <number> limits the number of logs that it looks at for quick tests (from the start of the window with --from)
 - --export <filename> exports a combined log, sorted by timestamp
+- --stream merges the per-entity logs as they are read instead of loading and sorting them,
+  memory stays constant regardless of log size
+- --per-entity reads the per-entity logs even when the run also wrote timeline.csv
+- --from <timestamp> / --to <timestamp> validates a time window; runs made with --log-index have a sidecar index
+  (<log>.idx: every Nth record's number, timestamp and byte offset) and are entered there instead of read from the start.
+  Checks that need the history before the window are skipped
+- --entity <id> validates one entity's records
+- --follow validates a run that is still going: new lines are read as the logs grow (inotify wake-ups, and a rescan
+  every --poll-interval seconds), merged in timestamp order through a bounded reorder buffer (--reorder-window records)
+  and checked as they come, with each issue printed as soon as it is found. The directory may be created after it
+  starts. It stops once every entity has logged EXIT, or on Ctrl-C, and prints the usual summary
+
+Moves are checked against the room graph the run wrote to rooms.csv (generated layouts of --rooms N included),
+or against Willow House for runs without one.
+
+Runs made with --log-filter leave out or sample some actions and entities and write log_filter.txt saying which.
+Checks that need every record of a missing action (or every entity) are skipped instead of reporting false gaps.
+
+Runs made with --timeline or --timeline-only also write timeline.csv, every record in one global order with a
+sequence number in front. It is read instead of the per-entity logs, with no merging, and missing sequence numbers
+are reported.
+
+Timestamps are CLOCK_MONOTONIC nanoseconds (files start with a "# clock=monotonic_ns epoch_offset_ns=N" header line),
+or wall-clock milliseconds for runs made with --log-timestamps ms. Either orders the entries the same way.
 
 Note: This code might be updated throughout the project to modify or add additional verifications.
 """
@@ -16,11 +44,23 @@ Note: This code might be updated throughout the project to modify or add additio
 from __future__ import annotations
 
 import argparse
+import bisect
 import csv
+import ctypes
 import glob
+import gzip
+import os
+import heapq
+import itertools
+import mmap
+import re
+import select
+import struct
+import time
+import zlib
 from collections import defaultdict
 from dataclasses import dataclass, field
-from typing import Dict, List, Optional, Set, Tuple
+from typing import Callable, Dict, Iterable, Iterator, List, Optional, Set, Tuple
 
 
 # Willow house layout
@@ -40,6 +80,22 @@ WILLOW_ROOMS: Dict[str, List[str]] = {
     "Utility Room": ["Garage"],
 }
 
+# Room graph the run moved through, one line per room: name, then its connected rooms
+ROOMS_FILE = "rooms.csv"
+
+
+def read_layout(directory: str) -> Dict[str, List[str]]:
+    # Runs made before rooms.csv was written all used Willow House
+    path = os.path.join(directory, ROOMS_FILE)
+    if not os.path.isfile(path):
+        return WILLOW_ROOMS
+    layout: Dict[str, List[str]] = {}
+    with open(path, "r", encoding="utf-8", newline="") as handle:
+        for row in csv.reader(handle):
+            if row and not row[0].startswith("#"):
+                layout[row[0]] = row[1:]
+    return layout
+
 
 @dataclass
 class LogEntry:
@@ -122,41 +178,156 @@ def compute_pending_evidence(entries: List[LogEntry]) -> Dict[Tuple[int, str, st
     return pending
 
 
-def parse_logs(limit: Optional[int] = None) -> List[LogEntry]:
+def parse_rows(rows: Iterable[List[str]], path: str, first_line: int = 1) -> Iterator[LogEntry]:
+    for line_number, row in enumerate(rows, start=first_line):
+        # Skips empty lines and the "# clock=..." header of nanosecond logs
+        if not row or row[0].startswith("#"):
+            continue
+
+        yield LogEntry(
+            timestamp=int(row[0]),
+            entity_type=row[1].strip(),
+            entity_id=int(row[2]),
+            room=row[3].strip(),
+            device=row[4].strip(),
+            boredom=int(row[5]),
+            fear=int(row[6]),
+            action=row[7].strip(),
+            extra=row[8].strip(),
+            source=path,
+            line=line_number,
+        )
+
+
+def read_log_file(path: str) -> Iterator[LogEntry]:
+    if is_segment(path):
+        yield from read_segment(path)
+        return
+
+    if path.endswith(".gz"):
+        yield from parse_rows(csv.reader(gzip_lines(path)), path)
+        return
+
+    with open(path, "r", encoding="utf-8", newline="") as handle:
+        yield from parse_rows(csv.reader(handle), path)
+
+
+def gzip_lines(path: str) -> Iterator[str]:
+    # Complete lines only; a file whose run was killed ends without its gzip trailer, and its last line may be cut short
+    with gzip.open(path, "rt", encoding="utf-8", newline="") as handle:
+        try:
+            for line in handle:
+                if line.endswith("\n"):
+                    yield line
+        except (EOFError, zlib.error):
+            return
+
+
+SEGMENT_PATTERN = re.compile(r"events_(\d+)\.csv$")
+
+# Lines of different threads land in a memory-mapped segment in reservation order, a few positions from timestamp order
+SEGMENT_REORDER_WINDOW = 4096
+
+
+def is_segment(path: str) -> bool:
+    return SEGMENT_PATTERN.search(os.path.basename(path)) is not None
+
+
+def read_segment(path: str) -> Iterator[LogEntry]:
+    # Maps the segment like the simulation does; data ends at the first zero byte when the run did not truncate it
+    with open(path, "rb") as handle:
+        if os.fstat(handle.fileno()).st_size == 0:
+            return
+        with mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+            end = mapped.find(b"\0")
+            end = len(mapped) if end < 0 else end
+            yield from parse_rows(csv.reader(segment_lines(mapped, end)), path)
+
+
+def segment_lines(mapped: mmap.mmap, end: int, position: int = 0) -> Iterator[str]:
+    # Complete lines only, a line cut short by a crash has no newline yet
+    while position < end:
+        newline = mapped.find(b"\n", position, end)
+        if newline < 0:
+            return
+        yield mapped[position:newline + 1].decode("utf-8")
+        position = newline + 1
+
+
+def reorder(entries: Iterable[LogEntry], window: int, path: str) -> Iterator[LogEntry]:
+    # Bounded reorder buffer: holds the last window entries and releases the oldest timestamp first
+    heap: List[Tuple[int, int, LogEntry]] = []
+    previous = None
+    for position, entry in enumerate(entries):
+        heapq.heappush(heap, (entry.timestamp, position, entry))
+        if len(heap) > window:
+            released = heapq.heappop(heap)[2]
+            if previous is not None and released.timestamp < previous:
+                raise ValueError(f"{path}:{released.line} is out of order by more than {window} lines, validate without --stream")
+            previous = released.timestamp
+            yield released
+    while heap:
+        yield heapq.heappop(heap)[2]
+
+
+def read_log_file_ordered(path: str) -> Iterator[LogEntry]:
+    # Streaming relies on every per-entity file already being in timestamp order, segments almost are
+    if is_segment(path):
+        yield from reorder(read_segment(path), SEGMENT_REORDER_WINDOW, path)
+        return
+
+    previous = None
+    for entry in read_log_file(path):
+        if previous is not None and entry.timestamp < previous:
+            raise ValueError(f"{path}:{entry.line} timestamp goes backwards, validate without --stream")
+        previous = entry.timestamp
+        yield entry
+
+
+TIMELINE_FILE = "timeline.csv"
+
+
+def timeline_path(directory: str) -> Optional[str]:
+    path = os.path.join(directory, TIMELINE_FILE)
+    return path if os.path.isfile(path) else None
+
+
+def read_timeline(path: str, gaps: List[int]) -> Iterator[LogEntry]:
+    # Drops the sequence column; appends each number that is missing (a record that could not be formatted) to gaps
+    expected = 0
+
+    def rows(reader: Iterable[List[str]]) -> Iterator[List[str]]:
+        nonlocal expected
+        for row in reader:
+            if not row or row[0].startswith("#"):
+                yield row
+                continue
+            seq = int(row[0])
+            gaps.extend(range(expected, seq))
+            expected = seq + 1
+            yield row[1:]
+
+    with open(path, "r", encoding="utf-8", newline="") as handle:
+        yield from parse_rows(rows(csv.reader(handle)), path)
+
+
+def log_paths(directory: str) -> List[str]:
+    segments = sorted(glob.glob(os.path.join(directory, "events_*.csv")),
+                      key=lambda path: int(SEGMENT_PATTERN.search(path).group(1)) if SEGMENT_PATTERN.search(path) else -1)
+    entity_logs = glob.glob(os.path.join(directory, "log_*.csv")) + glob.glob(os.path.join(directory, "log_*.csv.gz"))
+    return sorted(entity_logs) + [path for path in segments if is_segment(path)]
+
+
+def parse_logs(directory: str, limit: Optional[int] = None, timeline: Optional[str] = None,
+               gaps: Optional[List[int]] = None) -> List[LogEntry]:
     entries: List[LogEntry] = []
     try:
-        for path in sorted(glob.glob("log_*.csv")):
-            with open(path, "r", encoding="utf-8", newline="") as handle:
-                reader = csv.reader(handle)
-                for line_number, row in enumerate(reader, start=1):
-                    if not row:
-                        continue
-
-                    timestamp = int(row[0])
-                    entity_type = row[1].strip()
-                    entity_id = int(row[2])
-                    room = row[3].strip()
-                    device = row[4].strip()
-                    boredom = int(row[5])
-                    fear = int(row[6])
-                    action = row[7].strip()
-                    extra = row[8].strip()
-
-                    entries.append(
-                        LogEntry(
-                            timestamp=timestamp,
-                            entity_type=entity_type,
-                            entity_id=entity_id,
-                            room=room,
-                            device=device,
-                            boredom=boredom,
-                            fear=fear,
-                            action=action,
-                            extra=extra,
-                            source=path,
-                            line=line_number,
-                        )
-                    )
+        if timeline is not None:
+            # Already in global order, the sort below only moves the few records whose threads raced for a number
+            entries.extend(read_timeline(timeline, gaps if gaps is not None else []))
+        else:
+            for path in log_paths(directory):
+                entries.extend(read_log_file(path))
     except Exception:
         print("Something was wrong while parsing.")
         raise
@@ -167,243 +338,722 @@ def parse_logs(limit: Optional[int] = None) -> List[LogEntry]:
     return entries
 
 
-def simulate(
-    entries: List[LogEntry],
-    change_timestamps: Set[int],
-    pending_evidence: Dict[Tuple[int, str, str], int],
-) -> (Dict[str, int], Dict[str, List[str]]): # type: ignore (careful, quick fix only)
-    rooms = {name: RoomState(name=name, neighbors=neighbors) for name, neighbors in WILLOW_ROOMS.items()}
-    hunters: Dict[int, HunterState] = {}
-    ghosts: Dict[int, GhostState] = {}
-
-    stats = defaultdict(int)
-    samples: Dict[str, List[str]] = defaultdict(list)
+def stream_logs(directory: str, limit: Optional[int] = None, timeline: Optional[str] = None,
+                gaps: Optional[List[int]] = None) -> Iterator[LogEntry]:
+    if timeline is not None:
+        entries = read_timeline(timeline, gaps if gaps is not None else [])
+        return itertools.islice(reorder(entries, SEGMENT_REORDER_WINDOW, timeline), limit)
 
-    def report(issue: str, entry: LogEntry, detail: str) -> None:
-        stats[issue] += 1
-        if len(samples[issue]) < 5:
-            samples[issue].append(f"{entry.timestamp} | {detail}")
-        entry.issues.add(issue)
+    # k-way merge of the per-entity files; ties keep file order, matching the stable sort in parse_logs
+    streams = [read_log_file_ordered(path) for path in log_paths(directory)]
+    merged = heapq.merge(*streams, key=lambda entry: entry.timestamp)
+    return itertools.islice(merged, limit)
 
-    for index, entry in enumerate(entries):
-        if entry.entity_type == "hunter":
-            state = hunters.get(entry.entity_id)
-
-            if entry.action == "INIT":
-                state = HunterState(
-                    hunter_id=entry.entity_id,
-                    name=entry.extra,
-                    room=entry.room,
-                    device=entry.device,
-                    boredom=entry.boredom,
-                    fear=entry.fear,
-                    returning=False,
-                )
-                hunters[entry.entity_id] = state
-                if entry.room in rooms:
-                    rooms[entry.room].hunters.add(entry.entity_id)
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} unknown room '{entry.room}' during INIT")
-                continue
 
-            if state is None:
-                report("missing_init", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} seen before INIT")
-                continue
+# ---- Sparse index (--log-index) and time windows ----
 
-            state.boredom = entry.boredom
-            state.fear = entry.fear
+INDEX_SUFFIX = ".idx"
 
-            if entry.action == "MOVE":
-                from_room = entry.room
-                to_room = entry.extra
 
-                if state.room != from_room:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected in {state.room}, log shows {from_room}")
+def read_index(path: str) -> List[Tuple[int, int, int]]:
+    # (record, timestamp, offset) entries of a log segment's index, no record before offset is later than timestamp
+    entries: List[Tuple[int, int, int]] = []
+    try:
+        with open(path + INDEX_SUFFIX, "r", encoding="utf-8") as handle:
+            for line in handle:
+                if line.startswith("#") or not line.strip():
+                    continue
+                record, timestamp, offset = (int(value) for value in line.split(","))
+                entries.append((record, timestamp, offset))
+    except (OSError, ValueError):
+        return []
+    return entries
 
-                if from_room not in rooms or to_room not in rooms:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} unknown room in move {from_room}->{to_room}")
-                else:
-                    if to_room not in rooms[from_room].neighbors:
-                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} invalid edge {from_room}->{to_room}")
 
-                    if entry.entity_id in rooms[from_room].hunters:
-                        rooms[from_room].hunters.remove(entry.entity_id)
-                    else:
-                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} not recorded in {from_room} before move")
+def seek_position(path: str, start: Optional[int]) -> Tuple[int, int]:
+    # Offset and record number of the last indexed record before which every record is earlier than start
+    entries = read_index(path) if start is not None else []
+    position = bisect.bisect_left([timestamp for _, timestamp, _ in entries], start) - 1 if entries else -1
+    if position < 0:
+        return 0, 0
+    record, _, offset = entries[position]
+    return offset, record
+
+
+def lines_from(path: str, offset: int) -> Iterator[str]:
+    # Complete lines from offset on; gzip logs have no index and are read from the start
+    if path.endswith(".gz"):
+        yield from gzip_lines(path)
+        return
+
+    with open(path, "rb") as handle:
+        if os.fstat(handle.fileno()).st_size == 0:
+            return
+        with mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+            end = mapped.find(b"\0") if is_segment(path) else -1
+            end = len(mapped) if end < 0 else end
+            # An index that does not match the file (a log appended to by an earlier run) is ignored
+            if offset > 0 and (offset >= end or mapped[offset - 1:offset] != b"\n" or not mapped[offset:offset + 1].isdigit()):
+                offset = 0
+            yield from segment_lines(mapped, end, offset)
+
+
+def read_log_window(path: str, start: Optional[int] = None, end: Optional[int] = None) -> Iterator[LogEntry]:
+    # Entries of one log segment with start <= timestamp <= end, skipping the earlier records with the segment's index.
+    # Per-entity logs are in timestamp order and stop at the first later entry; shared segments and the timeline
+    # only stop once a reorder window of entries in a row are past end.
+    timeline = os.path.basename(path) == TIMELINE_FILE
+    shared = timeline or is_segment(path)
+    offset, record = seek_position(path, start)
+
+    with open(path, "rb") as handle:
+        header_lines = 1 if handle.read(1) == b"#" else 0
+
+    rows = csv.reader(lines_from(path, offset))
+    if timeline:
+        rows = (row if not row or row[0].startswith("#") else row[1:] for row in rows)
+
+    past_end = 0
+    for entry in parse_rows(rows, path, first_line=record + header_lines + 1 if offset > 0 else 1):
+        if end is not None and entry.timestamp > end:
+            past_end += 1
+            if not shared or past_end >= SEGMENT_REORDER_WINDOW:
+                return
+            continue
+        past_end = 0
+        if start is None or entry.timestamp >= start:
+            yield entry
+
+
+def entity_log_paths(directory: str, entity_id: int) -> List[str]:
+    # log_<id>.csv and its rotated segments log_<id>.<n>.csv, plain or compressed
+    pattern = re.compile(rf"log_{entity_id}(\.\d+)?\.csv(\.gz)?$")
+    return [path for path in log_paths(directory) if pattern.search(os.path.basename(path))]
+
+
+def window_logs(directory: str, start: Optional[int] = None, end: Optional[int] = None,
+                entity_id: Optional[int] = None, timeline: Optional[str] = None) -> Iterator[LogEntry]:
+    """
+    Reader API: the entries with start <= timestamp <= end (either bound optional) in timestamp order,
+    of one entity or of every entity. Each log segment is entered at its index instead of read from the start,
+    so a window late in a long run costs about the size of the window.
+    """
+    paths = entity_log_paths(directory, entity_id) if entity_id is not None else []
+    if not paths:
+        paths = [timeline] if timeline is not None else log_paths(directory)
+
+    streams = []
+    for path in paths:
+        entries = read_log_window(path, start, end)
+        # Shared segments and the timeline hold every entity, a few positions from timestamp order
+        if is_segment(path) or path == timeline:
+            if entity_id is not None:
+                entries = (entry for entry in entries if entry.entity_id == entity_id)
+            entries = reorder(entries, SEGMENT_REORDER_WINDOW, path)
+        streams.append(entries)
+    return heapq.merge(*streams, key=lambda entry: entry.timestamp)
+
+
+FILTER_FILE = "log_filter.txt"
+
+# Actions each check needs every record of; evidence and boredom also need every entity
+CHECK_ACTIONS: Dict[str, Set[str]] = {
+    "movement": {"INIT", "MOVE", "EXIT"},
+    "return": {"INIT", "MOVE", "EVIDENCE", "RETURN_START", "RETURN_COMPLETE"},
+    "evidence": {"INIT", "EVIDENCE", "SWAP"},
+    "boredom": {"INIT", "MOVE", "EXIT"},
+    "missing_init": {"INIT"},
+}
+CHECKS_NEEDING_EVERY_ENTITY = {"evidence", "boredom"}
+
+# Checks that need the records before a --from window: evidence counts, return paths and INIT entries
+WINDOW_SKIPPED_CHECKS = {"evidence", "return", "missing_init"}
+
+
+def read_filter(directory: str) -> Tuple[Set[str], bool]:
+    # Actions with records missing (filtered or sampled) and whether only some entities were logged
+    path = os.path.join(directory, FILTER_FILE)
+    if not os.path.isfile(path):
+        return set(), False
+    incomplete: Set[str] = set()
+    entities_filtered = False
+    with open(path, "r", encoding="utf-8") as handle:
+        for line in handle:
+            key, _, value = line.strip().partition("=")
+            values = [item for item in value.split(",") if item]
+            if key == "filtered_actions":
+                incomplete.update(values)
+            elif key == "sampled_actions":
+                incomplete.update(item.split(":", 1)[0] for item in values)
+            elif key == "entities":
+                entities_filtered = set(values) != {"hunter", "ghost"}
+    return incomplete, entities_filtered
+
+
+def skipped_checks(incomplete: Set[str], entities_filtered: bool) -> Set[str]:
+    return {
+        check for check, actions in CHECK_ACTIONS.items()
+        if actions & incomplete or (entities_filtered and check in CHECKS_NEEDING_EVERY_ENTITY)
+    }
+
+
+# ---- Follow mode (--follow): validating while the run is still logging ----
+
+# Files that grow while the run logs; compressed logs only become readable once their writer closes them
+FOLLOW_PATTERN = re.compile(r"log_\d+(\.\d+)?\.csv|events_\d+\.csv|timeline\.csv")
+FOLLOW_READ_BYTES = 1 << 16
+
+# Records are appended within this long of being logged, so a timestamp read this long ago is complete in every file
+FOLLOW_LAG_SECONDS = 0.5
+
+# Buffered records of all entities are released once no log has grown for this long
+FOLLOW_SETTLE_SECONDS = 1.0
+
+# inotify(7) event masks
+IN_MODIFY = 0x002
+IN_CLOSE_WRITE = 0x008
+IN_MOVED_TO = 0x080
+IN_CREATE = 0x100
+IN_Q_OVERFLOW = 0x4000
+INOTIFY_EVENT = struct.Struct("iIII")        # wd, mask, cookie, len, then len bytes of name
+
+
+def inotify_watch(directory: str) -> Optional[int]:
+    # inotify descriptor watching the files of directory, None where inotify is unavailable (polling only)
+    try:
+        libc = ctypes.CDLL(None, use_errno=True)
+        descriptor = libc.inotify_init1(os.O_NONBLOCK | os.O_CLOEXEC)
+    except (OSError, AttributeError):
+        return None
+    if descriptor < 0:
+        return None
+    if libc.inotify_add_watch(descriptor, os.fsencode(directory), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0:
+        os.close(descriptor)
+        return None
+    return descriptor
+
+
+def inotify_changes(descriptor: int, timeout: float) -> Optional[Set[str]]:
+    # Names of the files written within timeout, None to rescan every file (nothing came or the event queue overflowed)
+    readable, _, _ = select.select([descriptor], [], [], timeout)
+    if not readable:
+        return None
+    names: Set[str] = set()
+    while True:
+        try:
+            data = os.read(descriptor, 65536)
+        except BlockingIOError:
+            return names
+        position = 0
+        while position + 16 <= len(data):
+            _, mask, _, length = INOTIFY_EVENT.unpack_from(data, position)
+            if mask & IN_Q_OVERFLOW:
+                return None
+            names.add(data[position + 16:position + 16 + length].split(b"\0", 1)[0].decode("utf-8", "replace"))
+            position += 16 + length
+
+
+class LogTail:
+    # Reads the complete lines appended to one growing log file since the previous read
+    def __init__(self, path: str, gaps: List[int]) -> None:
+        self.path = path
+        self.timeline = os.path.basename(path) == TIMELINE_FILE
+        self.segment = is_segment(path)
+        self.offset = 0
+        self.line = 0
+        self.pending = b""
+        self.gaps = gaps
+        self.expected = 0
+
+    def read(self) -> List[LogEntry]:
+        chunks: List[bytes] = []
+        try:
+            with open(self.path, "rb") as handle:
+                handle.seek(self.offset)
+                while True:
+                    chunk = handle.read(FOLLOW_READ_BYTES)
+                    # Memory-mapped segments are zero-filled past the last line copied in so far
+                    zero = chunk.find(b"\0") if self.segment else -1
+                    chunks.append(chunk if zero < 0 else chunk[:zero])
+                    if len(chunk) < FOLLOW_READ_BYTES or zero >= 0:
+                        break
+        except OSError:
+            return []
+
+        data = b"".join(chunks)
+        self.offset += len(data)
+        lines = (self.pending + data).split(b"\n")
+        self.pending = lines.pop()
+        first_line = self.line + 1
+        self.line += len(lines)
+
+        rows = csv.reader([line.decode("utf-8") for line in lines])
+        return list(parse_rows(self.timeline_rows(rows) if self.timeline else rows, self.path, first_line))
+
+    def timeline_rows(self, rows: Iterable[List[str]]) -> Iterator[List[str]]:
+        # Drops the sequence column like read_timeline, keeping track of missing numbers across reads
+        for row in rows:
+            if not row or row[0].startswith("#"):
+                yield row
+                continue
+            seq = int(row[0])
+            self.gaps.extend(range(self.expected, seq))
+            self.expected = seq + 1
+            yield row[1:]
+
+
+class LogFollower:
+    """
+    Follow mode: tails the log files of a run that is still going, merges the new records in timestamp order through
+    a bounded reorder buffer and yields them as they come. The directory may not exist yet. Stops once every entity
+    seen has logged EXIT and the logs have been quiet for FOLLOW_SETTLE_SECONDS, or on Ctrl-C.
+    Checks skipped because of the run's log filter are added to skipped once log_filter.txt shows up.
+    """
+
+    def __init__(self, directory: str, window: int, poll: float, per_entity: bool, skipped: Set[str]) -> None:
+        self.directory = directory
+        self.window = window
+        self.poll = poll
+        self.per_entity = per_entity
+        self.skipped = skipped
+        self.tails: Dict[str, LogTail] = {}
+        self.timeline: Optional[bool] = None        # decided when the first log file shows up
+        self.gaps: List[int] = []
+        self.late = 0
+        self.seen: Set[Tuple[str, int]] = set()
+        self.exited: Set[Tuple[str, int]] = set()
+        self.exit_logged = True
+        self.filter_size = -1
+        self.compressed = False
+        self.interrupted = False
+
+    def read_filter_note(self) -> None:
+        incomplete, entities_filtered = read_filter(self.directory)
+        self.skipped |= skipped_checks(incomplete, entities_filtered)
+        if incomplete or entities_filtered:
+            dropped = ", ".join(sorted(incomplete)) or "none"
+            print(f"Log filter: incomplete actions {dropped}{', some entities only' if entities_filtered else ''}", flush=True)
+        if "EXIT" in incomplete and self.exit_logged:
+            self.exit_logged = False
+            print("EXIT records are filtered out, following until interrupted (Ctrl-C)", flush=True)
+
+    def accept(self, name: str) -> bool:
+        if self.timeline is None:
+            # The simulation creates timeline.csv before any record is logged
+            self.timeline = not self.per_entity and os.path.isfile(os.path.join(self.directory, TIMELINE_FILE))
+            if self.timeline:
+                print(f"Reading the merged timeline {os.path.join(self.directory, TIMELINE_FILE)}", flush=True)
+        return (name == TIMELINE_FILE) == self.timeline
+
+    def scan(self, changed: Optional[Set[str]]) -> List[LogEntry]:
+        # New records of the files in changed, or of every file that grew when changed is None
+        entries: List[LogEntry] = []
+        try:
+            found = list(os.scandir(self.directory))
+        except OSError:
+            return entries
+
+        for item in found:
+            name = item.name
+            if changed is not None and name not in changed:
+                continue
+            try:
+                size = item.stat().st_size
+            except OSError:
+                continue
 
-                    rooms[to_room].hunters.add(entry.entity_id)
+            if name == FILTER_FILE:
+                if size != self.filter_size:
+                    self.filter_size = size
+                    self.read_filter_note()
+                continue
+            if name.endswith(".csv.gz"):
+                if not self.compressed:
+                    self.compressed = True
+                    print("Compressed logs (--log-compress) cannot be followed, validate them once the run is done", flush=True)
+                continue
+            if not FOLLOW_PATTERN.fullmatch(name):
+                continue
 
-                if state.returning:
-                    if state.return_stack:
-                        expected = state.return_stack.pop()
-                        if expected != to_room:
-                            report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected {expected} on return, got {to_room}")
+            tail = self.tails.get(name)
+            if tail is None:
+                if not self.accept(name):
+                    continue
+                tail = self.tails[name] = LogTail(item.path, self.gaps)
+            elif not tail.segment and size == tail.offset:
+                continue
+            entries.extend(tail.read())
+        return entries
+
+    def finished(self) -> bool:
+        return self.exit_logged and bool(self.seen) and self.exited >= self.seen
+
+    def entries(self) -> Iterator[LogEntry]:
+        heap: List[Tuple[int, int, LogEntry]] = []
+        position = itertools.count()
+        released: Optional[int] = None
+        watch: Optional[int] = None
+        quiet_since = time.monotonic()
+        latest: Optional[int] = None
+        marks: List[Tuple[float, int]] = []            # (read time, latest timestamp read by then)
+        watermark: Optional[int] = None
+
+        try:
+            while True:
+                try:
+                    # inotify wakes up on appended lines; writes through a memory map raise no events, so every file
+                    # is still rescanned each poll interval
+                    if watch is None and os.path.isdir(self.directory):
+                        watch = inotify_watch(self.directory)
+                        if watch is None:
+                            watch = -1
+                    if watch is not None and watch >= 0:
+                        changed = inotify_changes(watch, self.poll)
                     else:
-                        if to_room != "Van":
-                            report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack empty but moved to {to_room}")
-                else:
-                    if from_room:
-                        state.return_stack.append(from_room)
-
-                state.room = to_room
-                if to_room == "Van":
-                    state.return_stack.clear()
+                        time.sleep(self.poll)
+                        changed = None
+                    new_entries = self.scan(changed)
+                except KeyboardInterrupt:
+                    self.interrupted = True
+                    new_entries = []
+
+                now = time.monotonic()
+                if new_entries:
+                    quiet_since = now
+                for entry in new_entries:
+                    key = (entry.entity_type, entry.entity_id)
+                    self.seen.add(key)
+                    if entry.action == "EXIT":
+                        self.exited.add(key)
+                    heapq.heappush(heap, (entry.timestamp, next(position), entry))
+                    latest = entry.timestamp if latest is None else max(latest, entry.timestamp)
+                if new_entries:
+                    marks.append((now, latest))
+                while marks and now - marks[0][0] >= FOLLOW_LAG_SECONDS:
+                    watermark = marks.pop(0)[1]
+
+                # Holds records back for records of other files still on their way: up to the watermark once they have
+                # had the lag to arrive, at most window of them, all of them once the logs are quiet.
+                # A record older than one already released is passed on late.
+                quiet = self.interrupted or now - quiet_since >= FOLLOW_SETTLE_SECONDS
+                while heap and (quiet or len(heap) > self.window or (watermark is not None and heap[0][0] <= watermark)):
+                    entry = heapq.heappop(heap)[2]
+                    if released is not None and entry.timestamp < released:
+                        self.late += 1
+                    else:
+                        released = entry.timestamp
+                    yield entry
 
-            elif entry.action == "EVIDENCE":
-                room = entry.room
-                device = entry.device
+                if self.interrupted or (quiet and self.finished()):
+                    return
+        finally:
+            if watch is not None and watch >= 0:
+                os.close(watch)
 
-                if device and device != state.device:
-                    report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} logged device {device} but state has {state.device}")
 
-                if room != "Van":
-                    state.returning = True
+def timestamp_windows(entries: Iterable[LogEntry]) -> Iterator[List[LogEntry]]:
+    # Room change and pending evidence lookups only ever match entries sharing a timestamp,
+    # so one window of equal timestamps is all the state they need
+    for _, window in itertools.groupby(entries, key=lambda entry: entry.timestamp):
+        yield list(window)
 
-                if room in rooms:
-                    if rooms[room].evidence[device] > 0:
-                        rooms[room].evidence[device] -= 1
-                    else:
-                        key = (entry.timestamp, room, device)
-                        if pending_evidence.get(key, 0) > 0:
-                            pending_evidence[key] -= 1
-                        else:
-                            report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} collected {device} but room missing evidence")
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} evidence in unknown room {room}")
 
-            elif entry.action == "SWAP":
-                if "->" in entry.extra:
-                    _, to_device = entry.extra.split("->", 1)
-                    state.device = to_device.strip()
+def simulate(
+    entries: Iterable[LogEntry],
+    on_entry: Optional[Callable[[LogEntry], None]] = None,
+    skipped: Optional[Set[str]] = None,
+    on_issue: Optional[Callable[[str, str], None]] = None,
+    layout: Optional[Dict[str, List[str]]] = None,
+) -> (Dict[str, int], Dict[str, List[str]]): # type: ignore (careful, quick fix only)
+    layout = layout if layout is not None else WILLOW_ROOMS
+    rooms = {name: RoomState(name=name, neighbors=neighbors) for name, neighbors in layout.items()}
+    hunters: Dict[int, HunterState] = {}
+    ghosts: Dict[int, GhostState] = {}
 
-            elif entry.action == "RETURN_START":
-                if state.room != "Van":
-                    state.returning = True
+    stats = defaultdict(int)
+    samples: Dict[str, List[str]] = defaultdict(list)
 
-            elif entry.action == "RETURN_COMPLETE":
-                if state.room != "Van":
-                    report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} completed return outside van in {state.room}")
-                if state.return_stack:
-                    report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack not empty on completion")
-                state.return_stack.clear()
-                state.returning = False
+    # Kept as the caller's set, follow mode adds checks once it has read the run's log filter
+    skipped = skipped if skipped is not None else set()
 
-            elif entry.action == "EXIT":
-                room = entry.room
-                if room in rooms and entry.entity_id in rooms[room].hunters:
-                    rooms[room].hunters.remove(entry.entity_id)
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} exit from room without occupancy ({room})")
-                state.room = None
-                state.return_stack.clear()
-                state.returning = False
-
-            # Boredom reset check
-            ghost_state = next(iter(ghosts.values()), None)
-            if (
-                ghost_state
-                and ghost_state.room
-                and state.room == ghost_state.room
-                and state.boredom != 0
-                and entry.timestamp not in change_timestamps
-            ):
-                report("boredom", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} boredom {state.boredom} with ghost in {state.room}")
-
-        elif entry.entity_type == "ghost":
-            state = ghosts.get(entry.entity_id)
-
-            if entry.action == "INIT":
-                state = GhostState(
-                    ghost_id=entry.entity_id,
-                    ghost_type=entry.extra,
-                    room=entry.room,
-                    boredom=entry.boredom,
-                )
-                ghosts[entry.entity_id] = state
-                if entry.room in rooms:
-                    rooms[entry.room].ghost_present = True
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} init unknown room {entry.room}")
-                continue
+    def report(issue: str, entry: LogEntry, detail: str) -> None:
+        if issue in skipped:
+            return
+        stats[issue] += 1
+        if len(samples[issue]) < 5:
+            samples[issue].append(f"{entry.timestamp} | {detail}")
+        if on_issue is not None:
+            on_issue(issue, f"{entry.timestamp} | {detail}")
+        entry.issues.add(issue)
 
-            if state is None:
-                report("missing_init", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} seen before INIT")
-                continue
+    entry_count = 0
+    for window in timestamp_windows(entries):
+        change_timestamps = compute_room_change_timestamps(window)
+        pending_evidence = compute_pending_evidence(window)
+        for entry in window:
+            simulate_entry(entry, rooms, hunters, ghosts, change_timestamps, pending_evidence, report,
+                           create_missing="missing_init" in skipped)
+            if on_entry is not None:
+                on_entry(entry)
+        entry_count += len(window)
+
+    stats["entries"] = entry_count
+    return stats, samples
 
-            state.boredom = entry.boredom
 
-            if entry.action == "MOVE":
-                from_room = entry.room
-                to_room = entry.extra
+def simulate_entry(
+    entry: LogEntry,
+    rooms: Dict[str, RoomState],
+    hunters: Dict[int, HunterState],
+    ghosts: Dict[int, GhostState],
+    change_timestamps: Set[int],
+    pending_evidence: Dict[Tuple[int, str, str], int],
+    report: Callable[[str, LogEntry, str], None],
+    create_missing: bool = False,
+) -> None:
+    if entry.entity_type == "hunter":
+        state = hunters.get(entry.entity_id)
+
+        if entry.action == "INIT":
+            state = HunterState(
+                hunter_id=entry.entity_id,
+                name=entry.extra,
+                room=entry.room,
+                device=entry.device,
+                boredom=entry.boredom,
+                fear=entry.fear,
+                returning=False,
+            )
+            hunters[entry.entity_id] = state
+            if entry.room in rooms:
+                rooms[entry.room].hunters.add(entry.entity_id)
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} unknown room '{entry.room}' during INIT")
+            return
+
+        if state is None and create_missing:
+            # INIT was filtered out or precedes the window, the hunter starts where it is first seen
+            state = hunters[entry.entity_id] = HunterState(hunter_id=entry.entity_id, room=entry.room, device=entry.device)
+            if entry.room in rooms:
+                rooms[entry.room].hunters.add(entry.entity_id)
+
+        if state is None:
+            report("missing_init", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} seen before INIT")
+            return
+
+        state.boredom = entry.boredom
+        state.fear = entry.fear
+
+        if entry.action == "MOVE":
+            from_room = entry.room
+            to_room = entry.extra
+
+            if state.room != from_room:
+                report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected in {state.room}, log shows {from_room}")
+
+            if from_room not in rooms or to_room not in rooms:
+                report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} unknown room in move {from_room}->{to_room}")
+            else:
+                if to_room not in rooms[from_room].neighbors:
+                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} invalid edge {from_room}->{to_room}")
+
+                if entry.entity_id in rooms[from_room].hunters:
+                    rooms[from_room].hunters.remove(entry.entity_id)
+                else:
+                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} not recorded in {from_room} before move")
 
-                if state.room != from_room:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} expected in {state.room}, log shows {from_room}")
+                rooms[to_room].hunters.add(entry.entity_id)
 
-                if from_room in rooms:
-                    rooms[from_room].ghost_present = False
+            if state.returning:
+                if state.return_stack:
+                    expected = state.return_stack.pop()
+                    if expected != to_room:
+                        report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected {expected} on return, got {to_room}")
                 else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} left unknown room {from_room}")
+                    if to_room != "Van":
+                        report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack empty but moved to {to_room}")
+            else:
+                if from_room:
+                    state.return_stack.append(from_room)
+
+            state.room = to_room
+            if to_room == "Van":
+                state.return_stack.clear()
 
-                if to_room in rooms:
-                    rooms[to_room].ghost_present = True
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} entered unknown room {to_room}")
+        elif entry.action == "EVIDENCE":
+            room = entry.room
+            device = entry.device
 
-                if from_room not in rooms or to_room not in rooms or to_room not in rooms[from_room].neighbors:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} invalid edge {from_room}->{to_room}")
+            if device and device != state.device:
+                report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} logged device {device} but state has {state.device}")
 
-                state.room = to_room
+            if room != "Van":
+                state.returning = True
 
-            elif entry.action == "EVIDENCE":
-                room = entry.room
-                device = entry.extra
-                if room in rooms:
-                    rooms[room].evidence[device] += 1
+            if room in rooms:
+                if rooms[room].evidence[device] > 0:
+                    rooms[room].evidence[device] -= 1
+                else:
                     key = (entry.timestamp, room, device)
                     if pending_evidence.get(key, 0) > 0:
                         pending_evidence[key] -= 1
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} dropped evidence in unknown room {room}")
-
-            elif entry.action == "EXIT":
-                room = entry.room
-                if room in rooms:
-                    rooms[room].ghost_present = False
-                state.room = None
-
-            if state.room and state.room in rooms:
-                hunters_here = rooms[state.room].hunters
-                if hunters_here and state.boredom != 0 and entry.timestamp not in change_timestamps:
-                    report("boredom", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} boredom {state.boredom} with hunters in {state.room}")
-
-        else:
-            report("unknown_entity", entry, f"{entry.source}:{entry.line} unknown entity type '{entry.entity_type}'")
-
-    stats["entries"] = len(entries)
-    return stats, samples
-
-
-def export_entries(entries: List[LogEntry], path: str) -> None:
+                    else:
+                        report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} collected {device} but room missing evidence")
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} evidence in unknown room {room}")
+
+        elif entry.action == "SWAP":
+            if "->" in entry.extra:
+                _, to_device = entry.extra.split("->", 1)
+                state.device = to_device.strip()
+
+        elif entry.action == "RETURN_START":
+            if state.room != "Van":
+                state.returning = True
+
+        elif entry.action == "RETURN_COMPLETE":
+            if state.room != "Van":
+                report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} completed return outside van in {state.room}")
+            if state.return_stack:
+                report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack not empty on completion")
+            state.return_stack.clear()
+            state.returning = False
+
+        elif entry.action == "EXIT":
+            room = entry.room
+            if room in rooms and entry.entity_id in rooms[room].hunters:
+                rooms[room].hunters.remove(entry.entity_id)
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} exit from room without occupancy ({room})")
+            state.room = None
+            state.return_stack.clear()
+            state.returning = False
+
+        # Boredom reset check
+        ghost_state = next(iter(ghosts.values()), None)
+        if (
+            ghost_state
+            and ghost_state.room
+            and state.room == ghost_state.room
+            and state.boredom != 0
+            and entry.timestamp not in change_timestamps
+        ):
+            report("boredom", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} boredom {state.boredom} with ghost in {state.room}")
+
+    elif entry.entity_type == "ghost":
+        state = ghosts.get(entry.entity_id)
+
+        if entry.action == "INIT":
+            state = GhostState(
+                ghost_id=entry.entity_id,
+                ghost_type=entry.extra,
+                room=entry.room,
+                boredom=entry.boredom,
+            )
+            ghosts[entry.entity_id] = state
+            if entry.room in rooms:
+                rooms[entry.room].ghost_present = True
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} init unknown room {entry.room}")
+            return
+
+        if state is None and create_missing:
+            state = ghosts[entry.entity_id] = GhostState(ghost_id=entry.entity_id, room=entry.room)
+            if entry.room in rooms:
+                rooms[entry.room].ghost_present = True
+
+        if state is None:
+            report("missing_init", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} seen before INIT")
+            return
+
+        state.boredom = entry.boredom
+
+        if entry.action == "MOVE":
+            from_room = entry.room
+            to_room = entry.extra
+
+            if state.room != from_room:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} expected in {state.room}, log shows {from_room}")
+
+            if from_room in rooms:
+                rooms[from_room].ghost_present = False
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} left unknown room {from_room}")
+
+            if to_room in rooms:
+                rooms[to_room].ghost_present = True
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} entered unknown room {to_room}")
+
+            if from_room not in rooms or to_room not in rooms or to_room not in rooms[from_room].neighbors:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} invalid edge {from_room}->{to_room}")
+
+            state.room = to_room
+
+        elif entry.action == "EVIDENCE":
+            room = entry.room
+            device = entry.extra
+            if room in rooms:
+                rooms[room].evidence[device] += 1
+                key = (entry.timestamp, room, device)
+                if pending_evidence.get(key, 0) > 0:
+                    pending_evidence[key] -= 1
+            else:
+                report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} dropped evidence in unknown room {room}")
+
+        elif entry.action == "EXIT":
+            room = entry.room
+            if room in rooms:
+                rooms[room].ghost_present = False
+            state.room = None
+
+        if state.room and state.room in rooms:
+            hunters_here = rooms[state.room].hunters
+            if hunters_here and state.boredom != 0 and entry.timestamp not in change_timestamps:
+                report("boredom", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} boredom {state.boredom} with hunters in {state.room}")
+
+    else:
+        report("unknown_entity", entry, f"{entry.source}:{entry.line} unknown entity type '{entry.entity_type}'")
+
+
+EXPORT_HEADER = [
+    "timestamp",
+    "entity_type",
+    "entity_id",
+    "room",
+    "device",
+    "boredom",
+    "fear",
+    "action",
+    "extra",
+    "issues",
+]
+
+
+def export_entries(entries: Iterable[LogEntry], path: str) -> None:
     with open(path, "w", encoding="utf-8", newline="") as handle:
         writer = csv.writer(handle)
-        writer.writerow([
-            "timestamp",
-            "entity_type",
-            "entity_id",
-            "room",
-            "device",
-            "boredom",
-            "fear",
-            "action",
-            "extra",
-            "issues",
-        ])
+        writer.writerow(EXPORT_HEADER)
         for entry in entries:
             writer.writerow(entry.to_row(include_issues=True))
 
 
+def open_export(path: str) -> Tuple[object, Callable[[LogEntry], None]]:
+    # Export file written one validated entry at a time, for the modes that never hold every entry
+    handle = open(path, "w", encoding="utf-8", newline="")
+    writer = csv.writer(handle)
+    writer.writerow(EXPORT_HEADER)
+    return handle, lambda entry: writer.writerow(entry.to_row(include_issues=True))
+
+
 def main() -> None:
     parser = argparse.ArgumentParser(description="Validate Willow House log files.")
+    parser.add_argument(
+        "directory",
+        nargs="?",
+        default=".",
+        help="Directory holding the run's log_*.csv files (default: current directory).",
+    )
     parser.add_argument(
         "--limit",
         type=int,
@@ -416,15 +1066,128 @@ def main() -> None:
         default=None,
         help="Optional output CSV path containing the combined, ordered logs.",
     )
+    parser.add_argument(
+        "--stream",
+        action="store_true",
+        help="Merge the per-entity logs while reading them instead of loading and sorting everything (constant memory).",
+    )
+    parser.add_argument(
+        "--per-entity",
+        action="store_true",
+        help="Read the per-entity logs even when the run also wrote timeline.csv.",
+    )
+    parser.add_argument(
+        "--from",
+        dest="start",
+        type=int,
+        default=None,
+        help="Start at this timestamp, seeking into the logs with their --log-index sidecars.",
+    )
+    parser.add_argument(
+        "--to",
+        dest="end",
+        type=int,
+        default=None,
+        help="Stop after this timestamp.",
+    )
+    parser.add_argument(
+        "--entity",
+        type=int,
+        default=None,
+        help="Only validate this entity's records.",
+    )
+    parser.add_argument(
+        "--follow",
+        action="store_true",
+        help="Validate while the run is still logging, reporting issues as they are found, until every entity has logged EXIT.",
+    )
+    parser.add_argument(
+        "--poll-interval",
+        type=float,
+        default=0.2,
+        help="Seconds between rescans of the log directory with --follow (default: 0.2).",
+    )
+    parser.add_argument(
+        "--reorder-window",
+        type=int,
+        default=SEGMENT_REORDER_WINDOW,
+        help=f"Records held back with --follow to put the files' records in timestamp order (default: {SEGMENT_REORDER_WINDOW}).",
+    )
 
     args = parser.parse_args()
 
-    entries = parse_logs(limit=args.limit)
-    change_timestamps = compute_room_change_timestamps(entries)
-    pending_evidence = compute_pending_evidence(entries)
-    stats, samples = simulate(entries, change_timestamps, pending_evidence)
+    if args.follow:
+        if args.start is not None or args.end is not None or args.entity is not None:
+            parser.error("--follow validates the whole run, it cannot be combined with --from, --to or --entity")
+        if args.poll_interval <= 0 or args.reorder_window < 1:
+            parser.error("--poll-interval must be positive and --reorder-window at least 1")
+        follow(args)
+        return
+
+    if not os.path.isdir(args.directory):
+        parser.error(f"{args.directory} is not a directory")
+
+    incomplete, entities_filtered = read_filter(args.directory)
+    skipped = skipped_checks(incomplete, entities_filtered or args.entity is not None)
+    windowed = args.start is not None or args.end is not None or args.entity is not None
+    if args.start is not None:
+        # Entities are picked up where the window first sees them, without the history before it
+        skipped |= WINDOW_SKIPPED_CHECKS
+    if incomplete or entities_filtered:
+        dropped = ", ".join(sorted(incomplete)) or "none"
+        print(f"Log filter: incomplete actions {dropped}{', some entities only' if entities_filtered else ''}")
+
+    layout = read_layout(args.directory)
+    if layout != WILLOW_ROOMS:
+        print(f"Room layout from {ROOMS_FILE}: {len(layout)} rooms")
+
+    timeline = None if args.per_entity else timeline_path(args.directory)
+    gaps: List[int] = []
+    if timeline is not None:
+        print(f"Reading the merged timeline {timeline}")
+
+    if windowed:
+        # Already in timestamp order, whether streamed or not
+        window = itertools.islice(window_logs(args.directory, args.start, args.end, args.entity, timeline), args.limit)
+        entries = window if args.stream else list(window)
+        on_entry = None
+        if args.stream and args.export:
+            export_handle, on_entry = open_export(args.export)
+        stats, samples = simulate(entries, on_entry, skipped, layout=layout)
+        if on_entry is not None:
+            export_handle.close()
+    elif args.stream:
+        # Exported rows are written as soon as each entry has been validated
+        export_handle, on_entry = open_export(args.export) if args.export else (None, None)
+        try:
+            stats, samples = simulate(stream_logs(args.directory, limit=args.limit, timeline=timeline, gaps=gaps), on_entry, skipped, layout=layout)
+        finally:
+            if export_handle is not None:
+                export_handle.close()
+    else:
+        entries = parse_logs(args.directory, limit=args.limit, timeline=timeline, gaps=gaps)
+        stats, samples = simulate(entries, skipped=skipped, layout=layout)
 
     print(f"Processed entries: {stats['entries']}")
+    if skipped:
+        print(f"Skipped checks (records filtered out or before the window): {', '.join(sorted(skipped))}")
+    if timeline is not None and not windowed:
+        print_gaps(gaps)
+    print_issues(stats, samples)
+
+    if args.export:
+        if not args.stream:
+            export_entries(entries, args.export)
+        print(f"Combined timeline exported to {args.export}")
+
+
+def print_gaps(gaps: List[int]) -> None:
+    print(f"Timeline sequence gaps: {len(gaps)}")
+    for seq in gaps[:10]:
+        print(f"  - sequence number {seq} is missing")
+
+
+def print_issues(stats: Dict[str, int], samples: Dict[str, List[str]]) -> None:
     print(f"Movement issues: {stats['movement']}")
     if samples["movement"]:
         for sample in samples["movement"]:
@@ -450,8 +1213,39 @@ def main() -> None:
         for sample in samples["unknown_entity"]:
             print(f"  - {sample}")
 
+
+def follow(args: argparse.Namespace) -> None:
+    # Issues are printed as they are found, the usual summary once every entity has logged EXIT
+    skipped: Set[str] = set()
+    follower = LogFollower(args.directory, args.reorder_window, args.poll_interval, args.per_entity, skipped)
+    print(f"Following {args.directory}, stops once every entity has logged EXIT (Ctrl-C to stop early)", flush=True)
+
+    export_handle, on_entry = open_export(args.export) if args.export else (None, None)
+    live = lambda issue, sample: print(f"[{issue}] {sample}", flush=True)
+
+    # The run writes rooms.csv before logging anything, so it is there once the first record is
+    entries = follower.entries()
+    first = list(itertools.islice(entries, 1))
+    layout = read_layout(args.directory)
+    if layout != WILLOW_ROOMS:
+        print(f"Room layout from {ROOMS_FILE}: {len(layout)} rooms", flush=True)
+
+    try:
+        stats, samples = simulate(itertools.islice(itertools.chain(first, entries), args.limit), on_entry, skipped, live, layout)
+    finally:
+        if export_handle is not None:
+            export_handle.close()
+
+    print(f"Processed entries: {stats['entries']}")
+    if follower.interrupted:
+        print(f"Stopped early: {len(follower.exited)} of {len(follower.seen)} entities had logged EXIT")
+    if skipped:
+        print(f"Skipped checks (records filtered out): {', '.join(sorted(skipped))}")
+    print(f"Late entries (arrived after the reorder window had passed their timestamp): {follower.late}")
+    if follower.timeline:
+        print_gaps(follower.gaps)
+    print_issues(stats, samples)
     if args.export:
-        export_entries(entries, args.export)
         print(f"Combined timeline exported to {args.export}")
 
 